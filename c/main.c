@@ -1,15 +1,204 @@
 #include "mastermind.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// prints the command line options
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --threads N               threads of the COMSOLVER (0 = all cores, 1 = single-threaded)\n"
+        "  --solver-millis MS        time per guess of the COMSOLVER beyond 8 pegs or 2^24 codes (default: 500)\n"
+        "  --strategy NAME           guesses of the COMSOLVER: minimax (default, uses the book), entropy\n"
+        "                            or propagate (position based hints only)\n"
+        "  --consistent-only 0|1     the COMSOLVER only guesses codes which may be the secret code (faster)\n"
+        "  --code-length N           preferences of the game (also editable in the settings)\n"
+        "  --color-count N\n"
+        "  --attempt-count N\n"
+        "  --multiple-colors 0|1\n"
+        "  --hints-position-based 0|1\n"
+        "  --assist 0|1              show the codes left, the colors left per peg and a code to try after every guess\n"
+        "  --simulate N              play N games with the COMSOLVER without UI and print stats\n"
+        "  --seed N                  seed of the secret codes, the same seed gives the same games (default: time)\n"
+        "  --book FILE               opening book of the COMSOLVER (default: " MMBOOK_DEFAULT_PATH ")\n"
+        "  --ttable FILE             guesses of the COMSOLVER for candidate sets seen before, kept in FILE between runs\n"
+        "  --ttable-entries N        size of the transposition table (default: 1048576, 24 bytes each)\n"
+        "  --log FILE                append every game to the game log FILE (read it with mmlogstat)\n"
+        "  --terminal NAME           terminal backend: curses, ansi or virtual (Linux), console (Windows)\n"
+        "  --capture FILE            copy everything written to the terminal into FILE (ansi and virtual only)\n"
+        "  --script FILE             replay the keys of FILE instead of reading the keyboard\n"
+        "  --script-delay MS         milliseconds between two keys of the script (default: 0)\n"
+        "  --bench-ui 0|1            print key-to-frame latency and bytes written after the script\n", name);
+    return 1;
+}
+
+// prints the measurements of a scripted run
+static void print_uireport(const MASTERMIND_UIREPORT *report) {
+    printf("keys:          %llu in %.3f s, %llu frames\n", (unsigned long long)report->keys, report->seconds,
+        (unsigned long long)report->frames);
+    printf("latency:       mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (key to frame written)\n",
+        report->latency_mean, report->latency_p50, report->latency_p99, report->latency_max);
+    printf("bytes:         %llu, %.1f per frame\n", (unsigned long long)report->bytes,
+        report->frames ? (double)report->bytes / report->frames : 0.0);
+    printf("games:         %llu, %.1f bytes per game\n", (unsigned long long)report->games,
+        report->games ? (double)report->bytes / report->games : 0.0);
+}
+
+// prints the results of a simulation
+static void print_simreport(const MASTERMIND_PREFERENCES *prefs, const MASTERMIND_SIMREPORT *report) {
+    unsigned int n;
+    uint64_t guesses = 0;
+    for (n = 1; n <= prefs->attempt_count; n++)
+        guesses += n * report->guesses[n];
+    printf("preferences:   %u pegs, %u colors, %u attempts, multiple colors %d, position based hints %d\n",
+        prefs->code_length, prefs->color_count, prefs->attempt_count,
+        prefs->multiple_colors, prefs->hints_position_based);
+    printf("strategy:      %s%s\n", mastermind_solver_name(prefs),
+        prefs->consistent_only ? ", consistent guesses only" : "");
+    printf("games:         %llu on %u threads in %.3f s\n",
+        (unsigned long long)report->games, report->threads, report->seconds);
+    printf("games/s:       %.1f\n", report->seconds > 0 ? report->games / report->seconds : 0.0);
+    printf("win rate:      %.4f %%\n", report->games ? 100.0 * report->won / report->games : 0.0);
+    printf("avg. guesses:  %.4f (won games)\n", report->won ? (double)guesses / report->won : 0.0);
+    printf("guesses:");
+    for (n = 1; n <= prefs->attempt_count; n++) {
+        if (report->guesses[n])
+            printf(" %u:%llu", n, (unsigned long long)report->guesses[n]);
+    }
+    printf(" lost:%llu\n", (unsigned long long)report->failed);
+    if (prefs->ttable) {
+        uint64_t lookups, hits;
+        mastermind_ttable_counts(prefs->ttable, &lookups, &hits);
+        printf("ttable:        %llu of %llu lookups hit (%.1f %%)\n", (unsigned long long)hits,
+            (unsigned long long)lookups, lookups ? 100.0 * hits / lookups : 0.0);
+    }
+}
+
 // start code
-int main(void) {
+int main(int argc, char *argv[]) {
     MASTERMIND_PREFERENCES myprefs = {
         .code_length = 4,
         .color_count = 6,
         .attempt_count = 7,
         .multiple_colors = false,
-        .hints_position_based = true
+        .hints_position_based = true,
+        .thread_count = 0
     };
-    mastermind(myprefs, false);
+    unsigned long long simulate = 0, seed = (unsigned long long)time(NULL);
+    const char *book_path = MMBOOK_DEFAULT_PATH, *log_path = NULL, *terminal = NULL, *capture = NULL,
+        *ttable_path = NULL, *script_path = NULL;
+    unsigned int script_delay = 0;
+    bool bench_ui = false;
+    size_t ttable_entries = MMTTABLE_DEFAULT_ENTRIES;
+    MASTERMIND_BOOK *book;
+    int n;
+    for (n = 1; n < argc; n++) {
+        const char *value = n + 1 < argc ? argv[n + 1] : NULL;
+        if (!value)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--threads") == 0)
+            myprefs.thread_count = atoi(value);
+        else if (strcmp(argv[n], "--solver-millis") == 0)
+            myprefs.solver_millis = atoi(value);
+        else if (strcmp(argv[n], "--strategy") == 0 && strcmp(value, "minimax") == 0)
+            myprefs.strategy = MMSTRATEGY_MINIMAX;
+        else if (strcmp(argv[n], "--strategy") == 0 && strcmp(value, "entropy") == 0)
+            myprefs.strategy = MMSTRATEGY_ENTROPY;
+        else if (strcmp(argv[n], "--strategy") == 0 && strcmp(value, "propagate") == 0)
+            myprefs.strategy = MMSTRATEGY_PROPAGATE;
+        else if (strcmp(argv[n], "--consistent-only") == 0)
+            myprefs.consistent_only = atoi(value) != 0;
+        else if (strcmp(argv[n], "--assist") == 0)
+            myprefs.assist = atoi(value) != 0;
+        else if (strcmp(argv[n], "--code-length") == 0)
+            myprefs.code_length = atoi(value);
+        else if (strcmp(argv[n], "--color-count") == 0)
+            myprefs.color_count = atoi(value);
+        else if (strcmp(argv[n], "--attempt-count") == 0)
+            myprefs.attempt_count = atoi(value);
+        else if (strcmp(argv[n], "--multiple-colors") == 0)
+            myprefs.multiple_colors = atoi(value) != 0;
+        else if (strcmp(argv[n], "--hints-position-based") == 0)
+            myprefs.hints_position_based = atoi(value) != 0;
+        else if (strcmp(argv[n], "--simulate") == 0)
+            simulate = strtoull(value, NULL, 10);
+        else if (strcmp(argv[n], "--seed") == 0)
+            seed = myprefs.seed = strtoull(value, NULL, 10);
+        else if (strcmp(argv[n], "--book") == 0)
+            book_path = value;
+        else if (strcmp(argv[n], "--log") == 0)
+            log_path = value;
+        else if (strcmp(argv[n], "--ttable") == 0)
+            ttable_path = value;
+        else if (strcmp(argv[n], "--ttable-entries") == 0)
+            ttable_entries = strtoull(value, NULL, 10);
+        else if (strcmp(argv[n], "--terminal") == 0)
+            terminal = value;
+        else if (strcmp(argv[n], "--capture") == 0)
+            capture = value;
+        else if (strcmp(argv[n], "--script") == 0)
+            script_path = value;
+        else if (strcmp(argv[n], "--script-delay") == 0)
+            script_delay = (unsigned int)strtoul(value, NULL, 10);
+        else if (strcmp(argv[n], "--bench-ui") == 0)
+            bench_ui = atoi(value) != 0;
+        else
+            return usage(argv[0]);
+        n++;
+    }
+    if (myprefs.strategy == MMSTRATEGY_PROPAGATE && !myprefs.hints_position_based) {
+        fprintf(stderr, "--strategy propagate needs position based hints\n");
+        return 1;
+    }
+    if (!mastermind_terminal(terminal, capture)) {
+        fprintf(stderr, "unknown terminal '%s' or it cannot capture\n", terminal ? terminal : "default");
+        return 1;
+    }
+    if (script_path && !mastermind_script(script_path, script_delay)) {
+        fprintf(stderr, "cannot read the script '%s' or it has an unknown <KEY>\n", script_path);
+        return 1;
+    }
+    if (log_path && !(myprefs.log = mastermind_log_open(log_path))) {
+        fprintf(stderr, "cannot append to the game log '%s'\n", log_path);
+        return 1;
+    }
+    // a missing or stale book is no error, the COMSOLVER computes every guess then
+    myprefs.book = book = mastermind_book_open(book_path);
+    // a missing or stale table file is no error either, it is written when the games are done
+    if (ttable_path && !(myprefs.ttable = mastermind_ttable_create(ttable_entries))) {
+        fprintf(stderr, "out of memory for the transposition table\n");
+        return 1;
+    }
+    if (ttable_path)
+        mastermind_ttable_load(myprefs.ttable, ttable_path);
+    if (simulate) { // headless: no curses at all
+        MASTERMIND_SIMREPORT report;
+        bool ok = mastermind_simulate(&myprefs, simulate, seed, &report);
+        if (ok)
+            print_simreport(&myprefs, &report);
+        else
+            fprintf(stderr, "simulation failed (invalid preferences or out of memory)\n");
+        n = ok ? 0 : 1;
+    }
+    else {
+        MASTERMIND_UIREPORT uireport;
+        n = mastermind(myprefs, false);
+        if (bench_ui && mastermind_uireport(&uireport)) // the terminal is restored by now
+            print_uireport(&uireport);
+        mastermind_script(NULL, 0);
+    }
+    mastermind_book_close(book);
+    if (ttable_path && !mastermind_ttable_save(myprefs.ttable, ttable_path)) {
+        fprintf(stderr, "cannot write the transposition table '%s'\n", ttable_path);
+        n = 1;
+    }
+    mastermind_ttable_destroy(myprefs.ttable);
+    if (!mastermind_log_close(myprefs.log)) {
+        fprintf(stderr, "cannot write the game log '%s'\n", log_path);
+        n = 1;
+    }
 
-    return 0;
+    return n;
 }
@@ -5,6 +5,11 @@
  */
 
 #include "mastermind.h"
+#include "mmassist.h"
+#include "mmhint.h"
+#include "mmscreen.h"
+#include "mmscript.h"
+#include "mmthread.h"
 
 // Windows systems
 #if defined(__usingwindows__)
@@ -14,22 +19,26 @@
     #include <Windows.h>
 // Linux systems
 #elif defined(__usinglinux__)
-    // sudo apt-get install libncurses5-dev libncursesw5-dev
-    // gcc ... -lcurses
-    // Note: curses.h auto-includes stdio.h !!
-    #include <curses.h>
-    // macro definitions for compatibility between stdio.h and curses.h
-    #define putchar(c) addch(c)
-    #define printf(f, ...) printw(f, ## __VA_ARGS__)
-    #define getch() wgetch(stdscr)
+    // the terminal is driven by mmterminal.c (curses or ANSI)
+    #include <stdio.h>
 #else
     #error "The OS-type could not be determined or is not supported..."
 #endif
 
+// everything is drawn into the frame buffer (mmscreen.h), which is presented before waiting for a key
+#define putchar(c) mmscreen_putchar(c)
+#define printf(f, ...) mmscreen_printf(f, ## __VA_ARGS__)
+#define getch() mmscreen_getkey()
+
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+// milliseconds between two redraws of the hint state while the background COMSOLVER thinks
+#define MMHINT_POLL_MS 100
+// seconds the typed guess is scored for the assist panel between two checks for a key
+#define MMASSIST_STEP_SECONDS 0.01
+
 // defines the variables for the width and height of the console
 // also defines the variables for the initial x and y position of the cursor
 struct mmwidgetinfo {
@@ -42,6 +51,16 @@ struct mmwidgetinfo {
 enum mmaction {
     MMACT_QUIT, MMACT_OPENSETTINGS, MMACT_STARTGAME
 };
+// console color of every peg color: 8 colors as always, then the bright ones, black and black on gray
+static const unsigned char peg_colors[MMPREFS_MAX_COLOR_COUNT] = {
+    0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xF0, 0x70
+};
+// terminal backend selected with mastermind_terminal() and keys of mastermind_script()
+static struct {
+    const char *name,
+        *capture;
+    struct mmscript *script; // NULL = keyboard
+} terminal;
 
 
 
@@ -51,35 +70,15 @@ enum mmaction {
 
 // gets actual console cursor position
 void nex_getcursorpos(int *x, int *y) {
-    #if defined(__usingwindows__)
-    HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
-    CONSOLE_SCREEN_BUFFER_INFO info;
-    GetConsoleScreenBufferInfo(hout, &info);
-    *x = info.dwCursorPosition.X;
-    *y = info.dwCursorPosition.Y;
-    #elif defined(__usinglinux__)
-    *x = 0;
-    *y = 0;
-    #endif
+    mmscreen_getcursor(x, y);
 }
 // sets console cursor to column (x value) and row (y value)
 void nex_setcursorpos(unsigned int column, unsigned int row) {
-    #if defined(__usingwindows__)
-    HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
-    COORD size = { .X = column,.Y = row };
-    SetConsoleCursorPosition(hout, size);
-    #elif defined(__usinglinux__)
-    move(row, column);
-    refresh();
-    #endif
+    mmscreen_move(column, row);
 }
 // sets the console text color
 void nex_setcolor(int value) {
-    #if defined(__usingwindows__)
-    HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
-    SetConsoleTextAttribute(hout, value);
-    #elif defined(__usinglinux__)
-    #endif
+    mmscreen_setcolor(value);
 }
 // draws the frame for the game
 void nex_drawframe(unsigned int width, unsigned int height, char *title) {
@@ -143,8 +142,8 @@ void nex_help(unsigned int width, unsigned int height) {
     echo MasterMind v0.5.1.1246 (beta) & \
     echo (c) 2018 Patrick Goldinger and Matthias Gehwolf & \
     echo. & \
-    echo CODE-LENGTH:           2- 8  ! can be from 2 to 8 characters & \
-    echo COLOR-COUNT:           4- 8  ! can be from 4 to 8 colors in range of a-h & \
+    echo CODE-LENGTH:           2-16  ! can be from 2 to 16 characters & \
+    echo COLOR-COUNT:           4-16  ! can be from 4 to 16 colors in range of a-p & \
     echo ATTEMPT-COUNT:         3-12  ! characters & \
     echo MULTIPLE-COLORS:       0- 1  ! if 1 colors can appear more than once & \
     echo HINTS-POSITION-BASED:  0- 1  ! if 1 hints are for each position & \
@@ -157,20 +156,160 @@ void nex_help(unsigned int width, unsigned int height) {
 }
 // checks if the preferences are in the minimum and maximum range
 bool nex_parametercheck(MASTERMIND_PREFERENCES prefs) {
-    return 
-        !(prefs.code_length < MMPREFS_MIN_CODE_LENGTH || prefs.code_length > MMPREFS_MAX_CODE_LENGTH ||
-        prefs.color_count < MMPREFS_MIN_COLOR_COUNT || prefs.color_count > MMPREFS_MAX_COLOR_COUNT ||
-        prefs.attempt_count < MMPREFS_MIN_ATTEMPT_COUNT || prefs.attempt_count > MMPREFS_MAX_ATTEMPT_COUNT ||
-        (prefs.color_count < prefs.code_length && !prefs.multiple_colors));
+    return mastermind_prefs_valid(&prefs);
+}
+// checks if two preferences describe the same game (COMSOLVER and table can be reused)
+bool nex_sameprefs(MASTERMIND_PREFERENCES a, MASTERMIND_PREFERENCES b) {
+    return a.code_length == b.code_length && a.color_count == b.color_count &&
+        a.attempt_count == b.attempt_count && a.multiple_colors == b.multiple_colors &&
+        a.hints_position_based == b.hints_position_based && a.scoretable_limit == b.scoretable_limit &&
+        a.thread_count == b.thread_count && a.solver_millis == b.solver_millis && a.strategy == b.strategy &&
+        a.consistent_only == b.consistent_only && a.book == b.book && a.ttable == b.ttable;
+}
+// sets the console text color of a peg color ('a', 'b', ...)
+void nex_setpegcolor(char color) {
+    nex_setcolor(peg_colors[(color - 'a') & MMCODE_PEG_MASK]);
+}
+// the board of the longest code has to fit the screen, the assist panel is checked at run time
+#if 4 * MMPREFS_MAX_CODE_LENGTH + 6 > MMSCREEN_WIDTH
+    #error "The board of the longest code is wider than the screen..."
+#endif
+// gets the width of the board: 50, or wider for the guesses and hints of long codes
+int nex_boardwidth(MASTERMIND_PREFERENCES prefs) {
+    int needed = 4 * prefs.code_length + 6; // frame, margin, code, "| " and hints
+    return needed > 50 ? needed : 50;
+}
+// gets the width of the assist panel: "Try: " and code or "12 " and colors, spaced or condensed to one char each
+int nex_assistwidth(MASTERMIND_PREFERENCES prefs, bool spaced) {
+    int needed = (spaced ? 2 : 1) * (prefs.code_length > prefs.color_count ? prefs.code_length : prefs.color_count) + 8;
+    return needed > 24 ? needed : 24;
 }
-// checks if a given character (to_search) exists in an array (*base_array)
-bool nex_isinarray(char to_search, char *base_array, int base_array_length) {
-    int i;
-    for (i = 0; i < base_array_length; i++) {
-        if (*(base_array + i) == to_search)
-            return true;
+// checks if the pegs and colors of the assist panel are spaced, they are condensed if it would not fit the screen
+bool nex_assistspaced(MASTERMIND_PREFERENCES prefs) {
+    return nex_boardwidth(prefs) + nex_assistwidth(prefs, true) <= MMSCREEN_WIDTH;
+}
+// checks if the assist panel is shown right of the board, never if even the condensed one does not fit the screen
+bool nex_assistshown(MASTERMIND_PREFERENCES prefs) {
+    return prefs.assist && mastermind_prefs_enumerable(&prefs) &&
+        nex_boardwidth(prefs) + nex_assistwidth(prefs, false) <= MMSCREEN_WIDTH;
+}
+// gets the width of the game widget: the board and the assist panel if shown, never wider than the screen
+int nex_gamewidth(MASTERMIND_PREFERENCES prefs) {
+    if (!nex_assistshown(prefs))
+        return nex_boardwidth(prefs);
+    return nex_boardwidth(prefs) + nex_assistwidth(prefs, nex_assistspaced(prefs));
+}
+// write the state of the background COMSOLVER (row below the interactive phrases)
+void nex_writestatus(MASTERMIND_PREFERENCES x, struct mmwidgetinfo w, char *text) {
+    nex_setcursorpos(2, w.initc_y + x.attempt_count + 6);
+    printf("%-*s", nex_boardwidth(x) - 4, text);
+}
+// gets the height of the game widget: attempts + 9, or higher for the colors of every peg in the assist panel
+int nex_gameheight(MASTERMIND_PREFERENCES prefs) {
+    int needed = prefs.code_length + 7;
+    if (!nex_assistshown(prefs) || needed < (int)prefs.attempt_count + 9)
+        return prefs.attempt_count + 9;
+    return needed;
+}
+// gets a seed which differs between two starts, even within the same second
+uint64_t nex_clockseed(void) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+// converts seconds into microseconds for the game log, at most UINT32_MAX (71 minutes)
+uint32_t nex_micros(double seconds) {
+    return seconds * 1e6 < UINT32_MAX ? (uint32_t)(seconds * 1e6) : UINT32_MAX;
+}
+// shows the hint keys, or the hint itself if show is set and it is ready
+void nex_hintstatus(MASTERMIND_PREFERENCES prefs, struct mmwidgetinfo w, struct mmhint *hint, bool show) {
+    char code[MMPREFS_MAX_CODE_LENGTH];
+    size_t remaining;
+    int n;
+    if (!mmhint_ready(hint))
+        nex_writestatus(prefs, w, "Hint <H>       COMSOLVER <C>       (thinking)");
+    else if (!show)
+        nex_writestatus(prefs, w, "Hint <H>       COMSOLVER <C>");
+    else {
+        mastermind_code_unpack(&prefs, mmhint_guess(hint, &remaining), code);
+        nex_writestatus(prefs, w, "");
+        nex_setcursorpos(2, w.initc_y + prefs.attempt_count + 6);
+        printf("Hint: ");
+        for (n = 0; n < prefs.code_length; n++) {
+            nex_setpegcolor(code[n]);
+            putchar(code[n]);
+            nex_setcolor(MM_COLOR_BGFG);
+            putchar(' ');
+        }
+        if (remaining) // not known beyond enumeration
+            printf("(%zu left)", remaining);
+    }
+}
+// draws the code to try of the assist panel: the guess of the hint once it is ready, a code which is left before
+void nex_assisttry(MASTERMIND_PREFERENCES prefs, struct mmwidgetinfo w, struct mmhint *hint, const struct mmassist *assist) {
+    int n, x = nex_boardwidth(prefs) + 1;
+    bool spaced = nex_assistspaced(prefs);
+    char code[MMPREFS_MAX_CODE_LENGTH];
+    nex_setcursorpos(x, w.initc_y + 4);
+    printf("%-*s", w.width - x - 2, "Try:");
+    // the secret code is always left, mmhint_guess() does not wait once the hint is ready
+    mastermind_code_unpack(&prefs, hint && mmhint_ready(hint) ? mmhint_guess(hint, NULL) : mmassist_code(assist), code);
+    nex_setcursorpos(x + 5, w.initc_y + 4);
+    for (n = 0; n < prefs.code_length; n++) {
+        nex_setpegcolor(code[n]);
+        putchar(code[n]);
+        nex_setcolor(MM_COLOR_BGFG);
+        if (spaced)
+            putchar(' ');
+    }
+}
+// waits for a key, meanwhile the hint state is kept up to date and the typed guess is scored (both may be NULL)
+int nex_waitkey(MASTERMIND_PREFERENCES prefs, struct mmwidgetinfo w, struct mmhint *hint, struct mmassist *assist, bool show) {
+    int rt = MMKEY_NONE, x, y; // rt means return value
+    bool tried = false; // the code to try is the guess of the hint
+    if (!hint && !assist)
+        return getch();
+    while (rt == MMKEY_NONE) {
+        bool ready = !hint || mmhint_ready(hint), // the guess stays ready until the next input
+            busy = assist && mmassist_step(assist, MMASSIST_STEP_SECONDS);
+        if (hint) {
+            nex_getcursorpos(&x, &y);
+            nex_hintstatus(prefs, w, hint, show);
+            if (assist && ready && !tried) {
+                nex_assisttry(prefs, w, hint, assist);
+                tried = true;
+            }
+            nex_setcursorpos(x, y);
+        }
+        rt = mmscreen_waitkey(busy ? 0 : ready ? -1 : MMHINT_POLL_MS);
+    }
+    return rt;
+}
+// draws the assist panel: codes left, a code to try and colors left at every peg
+void nex_assist(MASTERMIND_PREFERENCES prefs, struct mmwidgetinfo w, struct mmhint *hint, const struct mmassist *assist) {
+    int n, m, x = nex_boardwidth(prefs) + 1, width = w.width - x - 2;
+    bool spaced = nex_assistspaced(prefs);
+    const uint32_t *colors = mmassist_colors(assist);
+    nex_setcursorpos(x, w.initc_y + 2);
+    printf("%-*s", width, "");
+    nex_setcursorpos(x, w.initc_y + 2);
+    printf("%zu %s left", mmassist_remaining(assist), mmassist_remaining(assist) == 1 ? "code" : "codes");
+    nex_assisttry(prefs, w, hint, assist);
+    for (n = 0; n < prefs.code_length; n++) { // one row per peg, '.' for colors which are not possible anymore
+        nex_setcursorpos(x, w.initc_y + n + 6);
+        printf("%2d ", n + 1);
+        for (m = 0; m < prefs.color_count; m++) {
+            if (colors[n] >> m & 1) {
+                nex_setpegcolor('a' + m);
+                putchar('a' + m);
+                nex_setcolor(MM_COLOR_BGFG);
+            }
+            else
+                putchar('.');
+            if (spaced)
+                putchar(' ');
+        }
     }
-    return false;
 }
 // draws spaces over the game and resets cursor to initial position
 enum mmaction nex_clearandexit(struct mmwidgetinfo w, enum mmaction r) {
@@ -186,12 +325,14 @@ enum mmaction nex_clearandexit(struct mmwidgetinfo w, enum mmaction r) {
 }
 // set the message, which will be shown at the end of the game
 // after that the game waits for the anwser of the player
-enum mmaction nex_gamecomplete(MASTERMIND_PREFERENCES prefs, struct mmwidgetinfo w, char *code_secret, bool victory) {
-    char tmp;
+enum mmaction nex_gamecomplete(MASTERMIND_PREFERENCES prefs, struct mmwidgetinfo w, MMCODE secret, bool victory) {
+    char tmp, code_secret[MMPREFS_MAX_CODE_LENGTH];
     int n;
+    mastermind_code_unpack(&prefs, secret, code_secret);
+    nex_writestatus(prefs, w, ""); // no hints anymore
     nex_setcursorpos(2, w.initc_y + 2);
     for (n = 0; n < prefs.code_length; n++) { // show initial code
-        nex_setcolor(0xF1 + (code_secret[n] - 'a'));
+        nex_setpegcolor(code_secret[n]);
         putchar(code_secret[n]);
         nex_setcolor(MM_COLOR_BGFG);
         putchar(32);
@@ -229,8 +370,14 @@ enum mmaction nex_gamecomplete(MASTERMIND_PREFERENCES prefs, struct mmwidgetinfo
 
 /// <summary>Main game function which displays UI and handles the behind.</summary>
 /// <param name='prefs'>Preferences of game.</param>
+/// <param name='solver'>COMSOLVER for prefs, only used if the game starts with prefs.__comsolve__ set.</param>
+/// <param name='hint'>Background COMSOLVER for hints and takeover, NULL if not available.</param>
+/// <param name='assist'>Codes left for the assist panel, NULL if it is not shown.</param>
+/// <param name='session'>The game itself, NULL if prefs are invalid.</param>
+/// <param name='record'>Destination for the player and the time of every guess (for the game log).</param>
 /// <returns>An action to do after the game is done.</returns>
-enum mmaction mastermind_game(MASTERMIND_PREFERENCES prefs) {
+enum mmaction mastermind_game(MASTERMIND_PREFERENCES prefs, MASTERMIND_SOLVER *solver, struct mmhint *hint,
+    struct mmassist *assist, MASTERMIND_SESSION *session, MASTERMIND_GAMELOG *record) {
 
     // --< counter variables >--
     int n, m;
@@ -238,14 +385,14 @@ enum mmaction mastermind_game(MASTERMIND_PREFERENCES prefs) {
     // --< widget user interface setup >--
     // draws the frame of the game
     putchar('\r'); // reset x coordinate
-    struct mmwidgetinfo widget = { 50, prefs.attempt_count + 9, 0, 0 }; // width: 50; height: attemps + 9
+    struct mmwidgetinfo widget = { nex_gamewidth(prefs), nex_gameheight(prefs), 0, 0 }; // width: 50+; height: attemps + 9+
     nex_getcursorpos(&widget.initc_x, &widget.initc_y); // get init cursor position
     nex_setcolor(MM_COLOR_BGFG); // set color defined in mastermind.h
     nex_drawframe(widget.width, widget.height, "MasterMind"); // draw frame with width and height attributes
 
     // --< parameter check >--
     // checks if the preferences are in the maximum and minimum range
-    if (!nex_parametercheck(prefs)) {
+    if (!nex_parametercheck(prefs) || !session) {
         nex_setcursorpos(2, widget.initc_y + 2);
         printf("Got incorrect parameters.");
         nex_setcursorpos(2, widget.initc_y + 4);
@@ -264,7 +411,7 @@ enum mmaction mastermind_game(MASTERMIND_PREFERENCES prefs) {
     printf("|"); // after this position the attempt counter will be written
     // row 4 : layout spacier (_____)
     nex_setcursorpos(1, widget.initc_y + 3);
-    for (n = 0; n < widget.width - 2; n++)
+    for (n = 0; n < nex_boardwidth(prefs) - 2; n++)
         printf("_");
     // row 5+ : attempt input and output structure
     for (n = 0; n < prefs.attempt_count; n++) {
@@ -277,125 +424,138 @@ enum mmaction mastermind_game(MASTERMIND_PREFERENCES prefs) {
     }
     // row -5 : layout spacier (_____)
     nex_setcursorpos(1, widget.initc_y + prefs.attempt_count + 4);
-	for (n = 0; n < widget.width - 2; n++)
+	for (n = 0; n < nex_boardwidth(prefs) - 2; n++)
         printf("_");
     // row -2 : List commands available and their char trigger
     nex_setcursorpos(2, widget.initc_y + prefs.attempt_count + 7);
     printf("Quit <q>       Help <?>       Settings <ESC>");
+    // column -x : assist panel, separated from the board by a line
+    for (n = 1; assist && n < widget.height - 1; n++) {
+        nex_setcursorpos(nex_boardwidth(prefs) - 1, widget.initc_y + n);
+        putchar(MMFRAME_LINE_VERTICALLY);
+    }
 
     // --< setup game variables >--
-    // sets the secret code
-    srand(time(NULL)); // generate new seed for rand()
-    char code_secret[MMPREFS_MAX_CODE_LENGTH], // holds the random generated secret code
-        code_in[MMPREFS_MAX_CODE_LENGTH], // holds the code input
-		code_comsol[MMPREFS_MAX_CODE_LENGTH], // holds the computer solved code
-		solution_out[MMPREFS_MAX_CODE_LENGTH]; // 
+    // secret code, guesses and feedbacks are kept by the session
+    MASTERMIND_STATE state;
+    char code_in[MMPREFS_MAX_CODE_LENGTH]; // holds the code input
     int tmp; // temporary character storage
-    for (n = 0; n < prefs.code_length; n++) {
-        do code_secret[n] = 'a' + rand() % prefs.color_count;
-        while (nex_isinarray(code_secret[n], code_secret, n) && !prefs.multiple_colors);
+    if (prefs.__comsolve__ && !(solver && mastermind_solver_reset(solver)))
+        prefs.__comsolve__ = false; // out of memory, let the player solve
+    if (prefs.__comsolve__)
+        hint = NULL; // the game is not played by the player
+    else if (hint)
+        mmhint_reset(hint);
+    record->comsolver = prefs.__comsolve__;
+    mastermind_session_state(session, &state);
+    if (assist) { // all codes are left
+        mmassist_reset(assist);
+        nex_assist(prefs, widget, hint, assist);
     }
 
     // --< main game loop >--
     // this is the main game
-    int cattp; // current attempt position
-    for (cattp = 0; cattp < prefs.attempt_count; cattp++) {
-        int marker = 0; // marker for char input count
+    while (state.status == MMSESSION_PLAYING) {
+        int cattp = state.attempt, // current attempt position
+            marker = 0; // marker for char input count
+        bool hint_shown = false; // the hint for this attempt was asked for
+        double started = mmtime_now(); // the time of a guess includes the COMSOLVER or the thinking of the player
         nex_setcursorpos(2 * prefs.code_length + 4, widget.initc_y + 2); // set cursor to position beside ? ? ? ? |
         printf("Attempt %d/%d", cattp + 1, prefs.attempt_count); // write attempt count
 		// COMSOLVER begin
-		if (prefs.__comsolve__) {
-			int cc;
-			char code_next[MMPREFS_MAX_CODE_LENGTH];
-			if (cattp < 6) {
-				for (cc = 0; cc < prefs.code_length; cc++)
-					code_next[cc] = 'a' + cattp;
-			}
-			if (cattp > 0) {
-				for (cc = 0; cc < prefs.code_length; cc++) {
-					if (solution_out[cc] == 'X')
-						code_comsol[cc] = code_in[cc];
-				}
-			}
-			if (cattp == prefs.attempt_count - 1) { // when all try attempts have been done
-				for (cc = 0; cc < prefs.code_length; cc++)
-					code_next[cc] = code_comsol[cc];
-			}
-			strncpy(code_in, code_next, prefs.code_length);
-		}
+		if (prefs.__comsolve__)
+			mastermind_code_unpack(&prefs, solver ? mastermind_solver_guess(solver) : mmhint_guess(hint, NULL), code_in);
 		// COMSOLVER end
         while (1) { // inner attempt loop
             if (marker == prefs.code_length) // input is complete and ready to be confirmed by user
                 nex_writephrase(prefs, widget, "Input ok? <ENTER>");
             else // input is not ready to be confirmed - delete input ok phrase
                 nex_setcursorpos(2 * marker + 2, widget.initc_y + prefs.attempt_count - cattp + 3);
-			tmp = prefs.__comsolve__ ? code_in[marker] : getch(); // wait for user input
+			tmp = prefs.__comsolve__ ? code_in[marker] : nex_waitkey(prefs, widget, hint, assist, hint_shown); // wait for user input
             if (tmp == 'q') // q -> quit the game directly
                 return nex_clearandexit(widget, MMACT_QUIT);
-            else if (tmp >= 'a' && tmp <= ('a' + prefs.color_count - 1) && marker < prefs.code_length) { // a - h -> char input
+            else if (tmp >= 'a' && tmp <= ('a' + prefs.color_count - 1) && marker < prefs.code_length) { // a - p -> char input
                 code_in[marker++] = tmp;
-                nex_setcolor(0xF1 + (tmp - 'a'));
+                nex_setpegcolor(tmp);
                 putchar(tmp);
                 nex_setcolor(MM_COLOR_BGFG);
+                if (hint && !prefs.__comsolve__)
+                    mmhint_input(hint, code_in, marker); // solve ahead for the typed guess
+                if (assist && !prefs.__comsolve__)
+                    mmassist_input(assist, code_in, marker);
             }
-            else if ((tmp == MMKEY_BACKSPACE || tmp == '*' || tmp == KEY_BACKSPACE) && marker > 0) { // \b -> backspace
+            else if ((tmp == MMKEY_BACKSPACE || tmp == '*') && marker > 0) { // \b -> backspace
                 code_in[--marker] = tmp;
                 nex_setcursorpos(2 * marker + 2, widget.initc_y + prefs.attempt_count - cattp + 3);
                 putchar('.');
                 nex_writephrase(prefs, widget, "                    ");
+                if (hint)
+                    mmhint_input(hint, code_in, marker);
+                if (assist)
+                    mmassist_input(assist, code_in, marker);
             }
-            else if ((tmp == MMKEY_ENTER || tmp == '\'' || tmp == KEY_ENTER || prefs.__comsolve__) && marker == prefs.code_length) { // \n \r ... -> input complete
-                char points_out[MMPREFS_MAX_CODE_LENGTH] = { '.', '.', '.', '.', '.', '.', '.', '.' }, // needed for algorithm, not for output!!
-                    code_secret_tmp[MMPREFS_MAX_CODE_LENGTH], // holds clone of real secret code
-                    code_in_tmp[MMPREFS_MAX_CODE_LENGTH]; // holds clone of real secret code
-                int points_out_idx = 0, // counts the written chars for correct filling of points_out[]
-                    victory_count = 0; // counts the number of 'X'ses
-                strncpy(code_secret_tmp, code_secret, MMPREFS_MAX_CODE_LENGTH); // safe clone (cannot use code_secret_tmp = code_secret)!!
-                strncpy(code_in_tmp, code_in, MMPREFS_MAX_CODE_LENGTH); // safe clone (cannot use code_in_tmp = code_in)!!
+            else if ((tmp == MMKEY_ENTER || tmp == '\'' || prefs.__comsolve__) && marker == prefs.code_length) { // \n \r ... -> input complete
+                char points_out[MMPREFS_MAX_CODE_LENGTH]; // needed for algorithm, not for output!!
+                memset(points_out, '.', sizeof(points_out));
+                MMCODE guess = mastermind_code_pack(&prefs, code_in);
+                MMFEEDBACK feedback;
+                record->micros[cattp] = nex_micros(mmtime_now() - started);
+                mastermind_session_guess(session, guess, &feedback); // code_in only holds valid colors
+                if (hint)
+                    mmhint_feedback(hint, guess, feedback);
+                if (assist) { // only the codes left after the last guess, mostly scored while the player waited
+                    mmassist_feedback(assist, guess, feedback);
+                    nex_assist(prefs, widget, hint, assist);
+                }
+                mastermind_session_state(session, &state);
+                int victory_count = mastermind_feedback_blacks(&prefs, feedback), // counts the number of 'X'ses
+                    whites_count = mastermind_feedback_whites(&prefs, feedback); // counts the number of '+'es
                 nex_setcursorpos(2 * prefs.code_length + 4, widget.initc_y + prefs.attempt_count - cattp + 3);
-                // X detection and output
-                for (n = 0; n < prefs.code_length; n++) {
-                    if (code_secret_tmp[n] == code_in_tmp[n] && code_secret_tmp[n] != 0) {
-                        if (prefs.hints_position_based) {
+                if (prefs.hints_position_based) { // X and + output at the position they belong to
+                    for (n = 0; n < prefs.code_length; n++) {
+                        if (MMFEEDBACK_BLACKS(feedback) >> n & 1)
                             points_out[n] = 'X'; // color and position right
-                            nex_setcursorpos(2 * prefs.code_length + 4 + 2 * n, widget.initc_y + prefs.attempt_count - cattp + 3);
-                            printf("X ");
-                        }
-                        else {
-                            points_out[points_out_idx++] = 'X'; // color and position right
-                            printf("X ");
-                        }
-                        code_secret_tmp[n] = 0;
-                        code_in_tmp[n] = 0;
-                        victory_count++;
+                        else if (MMFEEDBACK_WHITES(feedback) >> n & 1)
+                            points_out[n] = '+'; // color only right
+                        else
+                            continue;
+                        nex_setcursorpos(2 * prefs.code_length + 4 + 2 * n, widget.initc_y + prefs.attempt_count - cattp + 3);
+                        printf("%c ", points_out[n]);
                     }
                 }
-                // + detection and output
-                for (n = 0; n < prefs.code_length; n++) {
-                    for (m = 0; m < prefs.code_length; m++) {
-                        if (code_in_tmp[n] == code_secret_tmp[m] && n != m && code_secret_tmp[m] != 0) {
-                            if (prefs.hints_position_based) {
-                                points_out[n] = '+'; // color only right
-                                nex_setcursorpos(2 * prefs.code_length + 4 + 2 * n, widget.initc_y + prefs.attempt_count - cattp + 3);
-                                printf("+ ");
-                            }
-                            else {
-                                points_out[points_out_idx++] = '+'; // color only right
-                                printf("+ ");
-                            }
-                            code_secret_tmp[m] = 0;
-                            code_in_tmp[n] = 0;
-                        }
+                else { // first all X then all + output
+                    for (n = 0; n < victory_count + whites_count; n++) {
+                        points_out[n] = n < victory_count ? 'X' : '+';
+                        printf("%c ", points_out[n]);
                     }
                 }
-                if (victory_count == prefs.code_length) // if victory_count equals code length it must be a victory
-                    return nex_gamecomplete(prefs, widget, code_secret, true);
+                if (state.status == MMSESSION_WON)
+                    return nex_gamecomplete(prefs, widget, state.secret, true);
                 nex_writephrase(prefs, widget, "                    "); // clean up input ok phrase
-				strncpy(solution_out, points_out, prefs.code_length);
+				if (prefs.__comsolve__) {
+					if (solver)
+						mastermind_solver_feedback(solver, guess, feedback);
+					mmscreen_present(); // one frame per guess of the COMSOLVER
+				}
                 break; // next attempt input or finish
             }
             else if (tmp == '?') // ? -> help
                 nex_help(widget.width, widget.height); // open help window
+            else if (tmp == 'H' && hint) // H -> show the guess of the COMSOLVER for this attempt
+                hint_shown = true;
+            else if (tmp == 'C' && hint) { // C -> the COMSOLVER takes over the game
+                for (n = 0; n < marker; n++) { // forget the typed pegs
+                    nex_setcursorpos(2 * n + 2, widget.initc_y + prefs.attempt_count - cattp + 3);
+                    putchar('.');
+                }
+                marker = 0;
+                nex_writephrase(prefs, widget, "                    ");
+                nex_writestatus(prefs, widget, "");
+                prefs.__comsolve__ = true;
+                solver = NULL; // the hint has every feedback of this game, solver may hold the ones of an earlier game
+                record->comsolver = true; // the COMSOLVER finishes the game
+                mastermind_code_unpack(&prefs, mmhint_guess(hint, NULL), code_in);
+            }
 			else if (tmp == 27) { // \033 -> escape (settings screen)
 				nex_writephrase(prefs, widget, "Are you sure? (game will be resetted) <y/n>");
 				bool input_ok = false;
@@ -410,10 +570,10 @@ enum mmaction mastermind_game(MASTERMIND_PREFERENCES prefs) {
 				}
 			}
         } // <-- end of while (attempt)
-    } // <-- end of main game loop's for (n = 0; ...)
+    } // <-- end of main game loop's while (playing)
 
     // --< after game cleanup (you lost the game when you reach this point) >--
-    return nex_gamecomplete(prefs, widget, code_secret, false);
+    return nex_gamecomplete(prefs, widget, state.secret, false);
 }
 
 /// <summary>Manages the settings screen so users can edit the prefs object.</summary>
@@ -432,7 +592,7 @@ enum mmaction mastermind_settings(MASTERMIND_PREFERENCES initprefs, MASTERMIND_P
     // --< widget UI interface setup >--
     // sets UI for the setting-screen
     putchar('\r'); // reset x coordinate
-    struct mmwidgetinfo widget = { 50, 14 + 6, 0, 0 }; // +6 = note on COMSOLVER
+    struct mmwidgetinfo widget = { 50, 14, 0, 0 };
     nex_getcursorpos(&widget.initc_x, &widget.initc_y);
     nex_setcolor(MM_COLOR_BGFG);
     nex_drawframe(widget.width, widget.height, "MasterMind Settings");
@@ -448,13 +608,15 @@ enum mmaction mastermind_settings(MASTERMIND_PREFERENCES initprefs, MASTERMIND_P
         if (tmpprefs.code_length < MMPREFS_MIN_CODE_LENGTH ||
             tmpprefs.code_length > MMPREFS_MAX_CODE_LENGTH)
             tmpprefs.code_length = 4;
-        printf("#1 code length          [ 2; 8] = %d  ", tmpprefs.code_length);
+        printf("#1 code length          [%2d;%2d] = %d  ", MMPREFS_MIN_CODE_LENGTH, MMPREFS_MAX_CODE_LENGTH,
+            tmpprefs.code_length);
         // check and output settings for the color count
         nex_setcursorpos(2, widget.initc_y + 5);
         if (tmpprefs.color_count < MMPREFS_MIN_COLOR_COUNT ||
             tmpprefs.color_count > MMPREFS_MAX_COLOR_COUNT)
             tmpprefs.color_count = 6;
-        printf("#2 color count          [ 4; 8] = %d  ", tmpprefs.color_count);
+        printf("#2 color count          [%2d;%2d] = %d  ", MMPREFS_MIN_COLOR_COUNT, MMPREFS_MAX_COLOR_COUNT,
+            tmpprefs.color_count);
         // check and output settings for the attempt count
         nex_setcursorpos(2, widget.initc_y + 6);
         if (tmpprefs.attempt_count < MMPREFS_MIN_ATTEMPT_COUNT ||
@@ -474,17 +636,6 @@ enum mmaction mastermind_settings(MASTERMIND_PREFERENCES initprefs, MASTERMIND_P
         // writes a quit, computer-solve and play text
         nex_setcursorpos(2, widget.initc_y + 12);
         printf("Quit <q>        COMSOLVER <c>        Play <p>");
-		// Write note for COMSOLVER
-        nex_setcursorpos(2, widget.initc_y + 14);
-        printf("Note: COMSOLVER is currently only availabe if:");
-        nex_setcursorpos(2, widget.initc_y + 15);
-		printf("   #1 == 4 && #2 == 6 && #3 == 7 &&");
-        nex_setcursorpos(2, widget.initc_y + 16);
-		printf("   #4 == 0 && #5 == 1");
-        nex_setcursorpos(2, widget.initc_y + 17);
-		printf("   This algorithm is in alpha state, therefore");
-        nex_setcursorpos(2, widget.initc_y + 18);
-		printf("   it has this restrictions.");
         // input of the player
         nex_setcursorpos(2, widget.initc_y + 10);
         printf("edit setting:             \b\b\b\b\b\b\b\b\b\b\b\b");
@@ -498,22 +649,9 @@ enum mmaction mastermind_settings(MASTERMIND_PREFERENCES initprefs, MASTERMIND_P
             return nex_clearandexit(widget, MMACT_STARTGAME);
         }
         else if (tmp == 'c') { // let computer solve with new settings
-			if (tmpprefs.code_length != 4
-				|| tmpprefs.color_count != 6
-				|| tmpprefs.attempt_count != 7
-				|| tmpprefs.multiple_colors
-				|| !tmpprefs.hints_position_based) {
-				nex_setcursorpos(2, widget.initc_y + 10);
-				printf("Invalid settings, see note below! <any>");
-				getch();
-				nex_setcursorpos(2, widget.initc_y + 10);
-				printf("                                       ");
-			}
-			else {
-				tmpprefs.__comsolve__ = true;
-				*newprefs = tmpprefs;
-				return nex_clearandexit(widget, MMACT_STARTGAME);
-			}
+            tmpprefs.__comsolve__ = true;
+            *newprefs = tmpprefs;
+            return nex_clearandexit(widget, MMACT_STARTGAME);
         }
         else if (tmp_int >= 1 && tmp_int <= 5) {
             char buf[2] = { 0, 0 };
@@ -530,11 +668,11 @@ enum mmaction mastermind_settings(MASTERMIND_PREFERENCES initprefs, MASTERMIND_P
                     buf[marker++] = tmp;
                     putchar(tmp);
                 }
-                else if ((tmp == MMKEY_BACKSPACE || tmp == '*' || tmp == KEY_BACKSPACE) && marker > 0) {
+                else if ((tmp == MMKEY_BACKSPACE || tmp == '*') && marker > 0) {
                     printf("\b \b");
                     marker--;
                 }
-                else if ((tmp == MMKEY_ENTER || tmp == '\'' || tmp == KEY_ENTER) && marker > 0) {
+                else if ((tmp == MMKEY_ENTER || tmp == '\'') && marker > 0) {
                     int new_val = 0;
                     for (n = 0; n < marker; n++)
                         new_val += (buf[n] - '0') * nex_pow(10, marker - n - 1);
@@ -557,35 +695,117 @@ enum mmaction mastermind_settings(MASTERMIND_PREFERENCES initprefs, MASTERMIND_P
     return nex_clearandexit(widget, MMACT_STARTGAME);
 }
 
+/// <summary>Selects the terminal backend of mastermind().</summary>
+/// <param name='name'>Name of the backend, NULL = default.</param>
+/// <param name='capture'>File which gets a copy of all output or NULL.</param>
+/// <returns>False if there is no such backend or it cannot capture.</returns>
+bool mastermind_terminal(const char *name, const char *capture) {
+    const struct mmterminal *backend = mmscreen_find(name);
+    if (!backend || (capture && !backend->capture))
+        return false;
+    terminal.name = name;
+    terminal.capture = capture;
+    return true;
+}
+
+/// <summary>Replays the keys of a script in mastermind() instead of reading the keyboard and measures every key.</summary>
+/// <param name='path'>Script file (see mmscript.h), NULL drops the script of the last call.</param>
+/// <param name='delay_ms'>Milliseconds between two keys where the script does not wait itself.</param>
+/// <returns>False if the file cannot be read or has an unknown &lt;KEY&gt;.</returns>
+bool mastermind_script(const char *path, unsigned int delay_ms) {
+    mmscript_destroy(terminal.script);
+    terminal.script = path ? mmscript_load(path, delay_ms) : NULL;
+    return !path || terminal.script;
+}
+
+/// <summary>Gets the measurements of the script after mastermind() returned.</summary>
+/// <param name='report'>Destination for the results.</param>
+/// <returns>False if there is no script.</returns>
+bool mastermind_uireport(MASTERMIND_UIREPORT *report) {
+    if (!terminal.script)
+        return false;
+    mmscript_report(terminal.script, report);
+    return true;
+}
+
 /// <summary>Manages which action has to be done.</summary>
 /// <param name='initprefs'>Initial preferences.</param>
 /// <param name='start_game_direct'>Skip settings screen and go directly to game.</param>
 /// <returns>Gives back an integer value of 0.</returns>
 int mastermind(MASTERMIND_PREFERENCES initprefs, bool start_game_direct) {
-    #if defined(__usinglinux__)
-    // initialize screen for curses library
-    initscr();
-    noecho();
-    keypad(stdscr, TRUE);
-    #endif
+    // initialize the terminal (curses clears the screen)
+    if (!mmscreen_open(mmscreen_find(terminal.name), terminal.capture))
+        return 1;
+    mmscreen_input(terminal.script);
     enum mmaction retstate = MMACT_OPENSETTINGS;
     MASTERMIND_PREFERENCES newprefs = initprefs;
+    // feedback table and COMSOLVER are built once for each set of preferences
+    MASTERMIND_PREFERENCES solverprefs = initprefs;
+    MASTERMIND_SCORETABLE *table = NULL;
+    MASTERMIND_SOLVER *solver = NULL;
+    struct mmhint *hint = NULL; // for games of the player
+    struct mmassist *assist = NULL; // codes left in the assist panel
+    // one generator for all games, so every game gets another secret code
+    uint64_t seed = initprefs.seed ? initprefs.seed : nex_clockseed(),
+        game = 0; // number of the game within seed
+    MASTERMIND_RANDOM random;
+    mastermind_random_seed(&random, seed);
+    // the UI plays one session at a time
+    MASTERMIND_POOL *pool = mastermind_pool_create(1);
+    MASTERMIND_SESSION *session;
+    MASTERMIND_GAMELOG record;
+    MMCODE secret;
     while (1) {
-        if (start_game_direct) {
+        if (start_game_direct || retstate == MMACT_STARTGAME) {
+            if (start_game_direct)
+                newprefs = initprefs;
             start_game_direct = false;
-            retstate = mastermind_game(initprefs);
+            if (!table || !nex_sameprefs(solverprefs, newprefs)) {
+                mastermind_solver_destroy(solver);
+                mmhint_destroy(hint);
+                mmassist_destroy(assist);
+                mastermind_scoretable_destroy(table);
+                solverprefs = newprefs;
+                table = nex_parametercheck(newprefs) ? mastermind_scoretable_create(&newprefs) : NULL;
+                solver = NULL;
+                hint = NULL;
+                assist = NULL;
+            }
+            if (table && newprefs.__comsolve__ && !solver)
+                solver = mastermind_solver_create(&newprefs, table);
+            if (table && !newprefs.__comsolve__ && !hint)
+                hint = mmhint_create(&newprefs, table);
+            if (table && nex_assistshown(newprefs) && !assist)
+                assist = mmassist_create(&newprefs);
+            session = NULL;
+            memset(&record, 0, sizeof(record));
+            if (nex_parametercheck(newprefs)) {
+                secret = mastermind_random_code(&newprefs, &random);
+                session = mastermind_session_create(pool, &newprefs, secret);
+                record.game = game++;
+                if (terminal.script)
+                    mmscript_game(terminal.script);
+            }
+            retstate = mastermind_game(newprefs, solver, hint, nex_assistshown(newprefs) ? assist : NULL, session, &record);
+            if (session && newprefs.log) { // also games which were given up
+                mastermind_session_state(session, &record.state);
+                record.state.secret = secret;
+                record.seed = seed;
+                mastermind_log_games(newprefs.log, &record, 1);
+            }
+            mastermind_session_destroy(pool, session);
         }
         else if (retstate == MMACT_QUIT) 
             break;
         else if (retstate == MMACT_OPENSETTINGS) 
             retstate = mastermind_settings(newprefs, &newprefs);
-        else if (retstate == MMACT_STARTGAME)
-            retstate = mastermind_game(newprefs);
     }
-    #if defined(__usinglinux__)
-    // clean up screen for further use of the 'normal' shell
-    endwin();
-    #endif
+    mastermind_solver_destroy(solver);
+    mmhint_destroy(hint);
+    mmassist_destroy(assist);
+    mastermind_scoretable_destroy(table);
+    mastermind_pool_destroy(pool);
+    mmscreen_close(); // presents the cleared widget and restores the terminal
     return 0;
 }
 
@@ -13,11 +13,15 @@
 // this defines the maximum and minimum 
 // values of the preferences of the game  
 #define MMPREFS_MIN_CODE_LENGTH 2
-#define MMPREFS_MAX_CODE_LENGTH 8
+#define MMPREFS_MAX_CODE_LENGTH 16
 #define MMPREFS_MIN_COLOR_COUNT 4
-#define MMPREFS_MAX_COLOR_COUNT 8
+#define MMPREFS_MAX_COLOR_COUNT 16
 #define MMPREFS_MIN_ATTEMPT_COUNT 3
 #define MMPREFS_MAX_ATTEMPT_COUNT 12
+// candidate sets, feedback tables, books and the minimax COMSOLVER go through all codes,
+// which they do up to these limits (see mastermind_prefs_enumerable())
+#define MMPREFS_ENUM_MAX_CODE_LENGTH 8
+#define MMPREFS_ENUM_MAX_CODES (1u << 24)
 #define MM_COLOR_BGFG 0xF0
 
 // this defines the frame for the game in Windows
@@ -52,21 +56,568 @@
     #include <stdbool.h>
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+
+// packed code representation: every peg uses MMCODE_PEG_BITS bits,
+// the first peg of the code is stored in the lowest bits
+#define MMCODE_PEG_BITS 4
+#define MMCODE_PEG_MASK 0xF
+typedef uint64_t MMCODE;
+
+// feedback of one scored attempt: blacks (X) are stored in the low 16 bits and
+// whites (+) in the high 16 bits. with position based hints both parts are bit
+// masks over the positions of the guess, otherwise they are plain counts.
+typedef uint32_t MMFEEDBACK;
+#define MMFEEDBACK_SHIFT 16
+#define MMFEEDBACK_MAKE(blacks, whites) ((MMFEEDBACK)(blacks) | ((MMFEEDBACK)(whites) << MMFEEDBACK_SHIFT))
+#define MMFEEDBACK_BLACKS(feedback) ((feedback) & ((1 << MMFEEDBACK_SHIFT) - 1))
+#define MMFEEDBACK_WHITES(feedback) ((feedback) >> MMFEEDBACK_SHIFT)
+
+// opening book of the COMSOLVER, a memory-mapped decision tree file (see mmbook.h)
+typedef struct mmbook MASTERMIND_BOOK;
+// file the game loads its opening book from if no other is given
+#define MMBOOK_DEFAULT_PATH "mastermind.book"
+// guess of a book node without a guess (unreachable feedback or beyond the book),
+// books only hold codes of enumerable preferences, which never have this value
+#define MMBOOK_NO_GUESS UINT32_MAX
+// append-only binary log of played games (see mmlog.h), written by a background thread
+typedef struct mmlog MASTERMIND_LOG;
+// lock-free transposition table of the COMSOLVER: guesses of candidate sets seen before (see mmttable.c)
+typedef struct mmttable MASTERMIND_TTABLE;
+// number of entries of a transposition table if no other is given (24 bytes each)
+#define MMTTABLE_DEFAULT_ENTRIES (1u << 20)
+
+// revision of the guesses the COMSOLVER selects, increase it whenever they change:
+// books generated by another revision are stale and are not loaded
+#define MMSOLVER_REVISION 1
+
+// guess selection of the COMSOLVER for enumerable preferences
+typedef enum {
+    MMSTRATEGY_MINIMAX, // smallest worst-case partition (Knuth), the opening book holds its guesses
+    MMSTRATEGY_ENTROPY, // most expected information (Shannon entropy of the partitions)
+    MMSTRATEGY_PROPAGATE // a consistent code by constraint propagation, needs position based hints (minimax without)
+} MMSTRATEGY;
+
 // these are the preferences, which you will change in the settings
 typedef struct {
-    unsigned int code_length; // 2 - 8
-    unsigned int color_count; // 4 - 8
+    unsigned int code_length; // 2 - 16
+    unsigned int color_count; // 4 - 16
     unsigned int attempt_count; // 3 - 12
     bool multiple_colors; // false - true
     bool hints_position_based; // false - true
 	bool __comsolve__;
+    size_t scoretable_limit; // max. bytes of the feedback table, 0 = MMSCORETABLE_DEFAULT_LIMIT
+    unsigned int thread_count; // threads of the COMSOLVER, 0 = all cores, 1 = single-threaded
+    unsigned int solver_millis; // time budget of a guess of the genetic COMSOLVER in ms, 0 = MMSOLVER_DEFAULT_MILLIS
+    MMSTRATEGY strategy; // guess selection of the COMSOLVER, the book is only used with minimax
+    bool consistent_only; // the COMSOLVER only guesses codes which may be the secret code (faster)
+    const MASTERMIND_BOOK *book; // opening book of the COMSOLVER or NULL, must outlive the solver
+    MASTERMIND_TTABLE *ttable; // transposition table shared by all solvers or NULL, must outlive them
+    uint64_t seed; // secret codes of mastermind(), the same seed gives the same games, 0 = clock
+    MASTERMIND_LOG *log; // games of mastermind() and mastermind_simulate() are appended to it, NULL = none
+    bool assist; // mastermind() shows the codes left after every guess (enumerable preferences only)
 } MASTERMIND_PREFERENCES;
 
+// state of the pseudo random generator of the secret codes (xoshiro256**),
+// every game or thread keeps its own, the same seed gives the same numbers
+typedef struct {
+    uint64_t state[4];
+} MASTERMIND_RANDOM;
+
+// default time budget of a guess of the genetic COMSOLVER (preferences beyond enumeration)
+#define MMSOLVER_DEFAULT_MILLIS 500
+
+// default memory cap of the feedback table, 4 MiB holds e.g. 4 pegs x 6 colors (1296 x 1296)
+#define MMSCORETABLE_DEFAULT_LIMIT (4u << 20)
+
+// precomputed feedback indices for every (guess, secret) pair, the codes are
+// addressed by their rank (see mastermind_code_rank()). feedback is NULL if
+// the table would exceed the memory cap, then scores are computed directly.
+// One table is created per game setup and shared read-only by the solvers of
+// mastermind(), mastermind_simulate(), mmbookgen, mmoptimal and mmeval.
+typedef struct {
+    MASTERMIND_PREFERENCES prefs;
+    uint32_t code_count; // color_count ^ code_length
+    uint8_t *feedback; // code_count x code_count feedback indices, row = guess
+} MASTERMIND_SCORETABLE;
+
+// scoring kernels for one code length and kind of hints, see mastermind_scorer()
+typedef struct {
+    MMFEEDBACK (*score)(const MASTERMIND_PREFERENCES *prefs, MMCODE guess, MMCODE secret);
+    void (*batch)(const MASTERMIND_PREFERENCES *prefs, MMCODE guess, const MMCODE *secrets, MMFEEDBACK *out, size_t count);
+    const char *name; // "code_length/hints_position_based", e.g. "4/1/avx2", or "generic"
+} MASTERMIND_SCORER;
+
+// set of codes which may still be the secret code, a bitset over the ranks of all codes
+typedef struct mmcandidates MASTERMIND_CANDIDATES;
+
+// result of mastermind_simulate()
+typedef struct {
+    uint64_t games, // games played
+        won, // games solved within attempt_count
+        failed; // games not solved within attempt_count
+    uint64_t guesses[MMPREFS_MAX_ATTEMPT_COUNT + 1]; // guesses[n] = games solved with n guesses
+    unsigned int threads; // threads used
+    double seconds; // wall time
+} MASTERMIND_SIMREPORT;
+
+// result of a scripted run of mastermind() (see mastermind_script())
+typedef struct {
+    uint64_t keys, // keys of the script which were replayed
+        frames, // frames presented
+        games, // games started
+        bytes; // bytes written to the terminal, 0 if the backend cannot tell (curses, console)
+    double seconds, // wall time from the first to the last key
+        latency_mean, // microseconds from a key until the next frame is written
+        latency_p50,
+        latency_p99,
+        latency_max;
+} MASTERMIND_UIREPORT;
+
+// the COMSOLVER, keeps the codes consistent with the feedbacks of one game (minimax),
+// or searches some of them if the codes cannot be enumerated (constraint propagation
+// with position based hints, a genetic algorithm with hints by count)
+typedef struct mmsolver MASTERMIND_SOLVER;
+
+// one game without any UI: secret code, guesses and feedbacks
+typedef struct mmsession MASTERMIND_SESSION;
+// fixed number of preallocated sessions, not thread-safe (one pool per thread)
+typedef struct mmpool MASTERMIND_POOL;
+
+// progress of a session
+typedef enum {
+    MMSESSION_PLAYING, MMSESSION_WON, MMSESSION_LOST
+} MMSESSION_STATUS;
+
+// everything a client needs to show a session
+typedef struct {
+    MASTERMIND_PREFERENCES prefs; // only the preferences of the game itself are set
+    MMSESSION_STATUS status;
+    unsigned int attempt; // attempts done
+    MMCODE secret; // only set when the game is over
+    MMCODE guesses[MMPREFS_MAX_ATTEMPT_COUNT];
+    MMFEEDBACK feedbacks[MMPREFS_MAX_ATTEMPT_COUNT];
+} MASTERMIND_STATE;
+
+// one played game as it is logged
+typedef struct {
+    MASTERMIND_STATE state; // the secret is always set, MMSESSION_PLAYING = abandoned
+    uint64_t seed, // seed the secret code was drawn with
+        game; // number of the game within seed
+    bool comsolver; // played by the COMSOLVER
+    uint32_t micros[MMPREFS_MAX_ATTEMPT_COUNT]; // time taken for every guess in microseconds
+} MASTERMIND_GAMELOG;
+
 /// <summary>Manages which action has to be done.</summary>
 /// <param name='initprefs'>Initial preferences.</param>
 /// <param name='start_game_direct'>Skip settings screen and go directly to game.</param>
-/// <returns>Gives back an integer value of 0.</returns>
+/// <returns>Gives back an integer value of 0 (1 if the terminal cannot be used).</returns>
 int mastermind(MASTERMIND_PREFERENCES initprefs, bool start_game_direct);
+/// <summary>Selects the terminal backend of mastermind().</summary>
+/// <param name='name'>"curses" (default on Linux), "ansi" or "virtual" (Linux) or "console" (default on Windows), NULL = default.</param>
+/// <param name='capture'>File which gets a copy of all output (ansi and virtual only) or NULL.</param>
+/// <returns>False if there is no such backend or it cannot capture.</returns>
+bool mastermind_terminal(const char *name, const char *capture);
+/// <summary>Replays the keys of a script in mastermind() instead of reading the keyboard and measures every key.</summary>
+/// <param name='path'>Script file (see mmscript.h), NULL drops the script of the last call.</param>
+/// <param name='delay_ms'>Milliseconds between two keys where the script does not wait itself.</param>
+/// <returns>False if the file cannot be read or has an unknown &lt;KEY&gt;.</returns>
+bool mastermind_script(const char *path, unsigned int delay_ms);
+/// <summary>Gets the measurements of the script after mastermind() returned.</summary>
+/// <param name='report'>Destination for the results.</param>
+/// <returns>False if there is no script.</returns>
+bool mastermind_uireport(MASTERMIND_UIREPORT *report);
+
+/// <summary>Checks if the preferences are in the minimum and maximum range.</summary>
+/// <param name='prefs'>Preferences of game.</param>
+/// <returns>True if a game can be played with prefs.</returns>
+bool mastermind_prefs_valid(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Checks if all codes of the preferences can be ranked, as needed by candidate sets, feedback tables, books and the minimax COMSOLVER.</summary>
+/// <param name='prefs'>Preferences of game (code_length and color_count are used).</param>
+/// <returns>True for at most MMPREFS_ENUM_MAX_CODE_LENGTH pegs and MMPREFS_ENUM_MAX_CODES codes.</returns>
+bool mastermind_prefs_enumerable(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Packs a code given as characters ('a', 'b', ...) into an MMCODE.</summary>
+/// <param name='prefs'>Preferences of game (code_length is used).</param>
+/// <param name='code'>Characters of the code, at least code_length of them.</param>
+/// <returns>The packed code.</returns>
+MMCODE mastermind_code_pack(const MASTERMIND_PREFERENCES *prefs, const char *code);
+
+/// <summary>Unpacks an MMCODE into characters ('a', 'b', ...).</summary>
+/// <param name='prefs'>Preferences of game (code_length is used).</param>
+/// <param name='code'>The packed code.</param>
+/// <param name='out'>Destination for code_length characters (not null-terminated).</param>
+void mastermind_code_unpack(const MASTERMIND_PREFERENCES *prefs, MMCODE code, char *out);
+
+/// <summary>Selects the scoring kernels for the preferences of a game, fully unrolled for its code length.</summary>
+/// <param name='prefs'>Preferences of game (code_length and hints_position_based are used).</param>
+/// <returns>The scorer, call its functions with the same prefs. It is valid as long as the program runs.</returns>
+const MASTERMIND_SCORER *mastermind_scorer(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Scores a guess against a secret code without any output.</summary>
+/// <param name='prefs'>Preferences of game (code_length and hints_position_based are used).</param>
+/// <param name='guess'>The packed guess.</param>
+/// <param name='secret'>The packed secret code.</param>
+/// <returns>The feedback, see MMFEEDBACK.</returns>
+MMFEEDBACK mastermind_score(const MASTERMIND_PREFERENCES *prefs, MMCODE guess, MMCODE secret);
+
+/// <summary>Scores one guess against many codes at once (SSE/AVX2 if available), see mastermind_scorer().</summary>
+/// <param name='prefs'>Preferences of game (code_length and hints_position_based are used).</param>
+/// <param name='guess'>The packed guess.</param>
+/// <param name='secrets'>Array of packed codes to score the guess against.</param>
+/// <param name='out'>Destination for count feedbacks, out[i] belongs to secrets[i].</param>
+/// <param name='count'>Number of codes in secrets.</param>
+void mastermind_score_batch(const MASTERMIND_PREFERENCES *prefs, MMCODE guess,
+    const MMCODE *secrets, MMFEEDBACK *out, size_t count);
+
+/// <summary>Counts the blacks (X) of a feedback.</summary>
+/// <param name='prefs'>Preferences of game (hints_position_based is used).</param>
+/// <param name='feedback'>Feedback returned by mastermind_score().</param>
+/// <returns>Number of pegs with right color and right position.</returns>
+unsigned int mastermind_feedback_blacks(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK feedback);
+
+/// <summary>Counts the whites (+) of a feedback.</summary>
+/// <param name='prefs'>Preferences of game (hints_position_based is used).</param>
+/// <param name='feedback'>Feedback returned by mastermind_score().</param>
+/// <returns>Number of pegs with right color but wrong position.</returns>
+unsigned int mastermind_feedback_whites(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK feedback);
+
+/// <summary>Gets the number of distinct feedback indices.</summary>
+/// <param name='prefs'>Preferences of game (code_length and hints_position_based are used).</param>
+/// <returns>3^code_length with position based hints, (code_length + 1)^2 otherwise.</returns>
+unsigned int mastermind_feedback_classes(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Maps a feedback to a dense index, e.g. for histograms.</summary>
+/// <param name='prefs'>Preferences of game (code_length and hints_position_based are used).</param>
+/// <param name='feedback'>Feedback returned by mastermind_score().</param>
+/// <returns>An index below mastermind_feedback_classes().</returns>
+unsigned int mastermind_feedback_index(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK feedback);
+
+/// <summary>Maps a dense index back to its feedback.</summary>
+/// <param name='prefs'>Preferences of game (code_length and hints_position_based are used).</param>
+/// <param name='index'>Index returned by mastermind_feedback_index().</param>
+/// <returns>The feedback.</returns>
+MMFEEDBACK mastermind_feedback_from_index(const MASTERMIND_PREFERENCES *prefs, unsigned int index);
+
+/// <summary>Gets the number of codes with and without repeated colors.</summary>
+/// <param name='prefs'>Preferences of game (code_length and color_count are used).</param>
+/// <returns>color_count ^ code_length, only valid for enumerable preferences (see mastermind_prefs_enumerable()).</returns>
+uint32_t mastermind_code_count(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Gets the mixed-radix rank of a code (first peg is the lowest digit).</summary>
+/// <param name='prefs'>Preferences of game (code_length and color_count are used).</param>
+/// <param name='code'>The packed code.</param>
+/// <returns>A rank below mastermind_code_count().</returns>
+uint32_t mastermind_code_rank(const MASTERMIND_PREFERENCES *prefs, MMCODE code);
+
+/// <summary>Gets the code of a mixed-radix rank.</summary>
+/// <param name='prefs'>Preferences of game (code_length and color_count are used).</param>
+/// <param name='rank'>A rank below mastermind_code_count().</param>
+/// <returns>The packed code.</returns>
+MMCODE mastermind_code_unrank(const MASTERMIND_PREFERENCES *prefs, uint32_t rank);
+
+/// <summary>Builds the feedback table, or an empty one above prefs->scoretable_limit or for preferences beyond enumeration.</summary>
+/// <param name='prefs'>Preferences of game.</param>
+/// <returns>The table or NULL if out of memory. Free it with mastermind_scoretable_destroy().</returns>
+MASTERMIND_SCORETABLE *mastermind_scoretable_create(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Frees a table built by mastermind_scoretable_create().</summary>
+/// <param name='table'>The table, may be NULL.</param>
+void mastermind_scoretable_destroy(MASTERMIND_SCORETABLE *table);
+
+/// <summary>Gets the feedback index of a (guess, secret) pair, a single load if the table is built.</summary>
+/// <param name='table'>The table.</param>
+/// <param name='guess'>Rank of the guess.</param>
+/// <param name='secret'>Rank of the secret code.</param>
+/// <returns>The feedback index, see mastermind_feedback_index().</returns>
+static inline unsigned int mastermind_scoretable_index(const MASTERMIND_SCORETABLE *table, uint32_t guess, uint32_t secret) {
+    if (table->feedback)
+        return table->feedback[(size_t)guess * table->code_count + secret];
+    return mastermind_feedback_index(&table->prefs, mastermind_score(&table->prefs,
+        mastermind_code_unrank(&table->prefs, guess), mastermind_code_unrank(&table->prefs, secret)));
+}
+
+/// <summary>Creates a candidate set holding every valid code (no repeated colors unless prefs.multiple_colors).</summary>
+/// <param name='prefs'>Preferences of game, must be enumerable (see mastermind_prefs_enumerable()).</param>
+/// <returns>The set or NULL if out of memory. Free it with mastermind_candidates_destroy().</returns>
+MASTERMIND_CANDIDATES *mastermind_candidates_create(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Puts every valid code back into the set.</summary>
+/// <param name='set'>The candidate set.</param>
+void mastermind_candidates_reset(MASTERMIND_CANDIDATES *set);
+
+/// <summary>Removes every code which would not have given feedback for guess, in one pass over the set.</summary>
+/// <param name='set'>The candidate set.</param>
+/// <param name='guess'>The packed guess.</param>
+/// <param name='feedback'>The feedback the guess got.</param>
+/// <returns>The number of codes left.</returns>
+size_t mastermind_candidates_prune(MASTERMIND_CANDIDATES *set, MMCODE guess, MMFEEDBACK feedback);
+
+/// <summary>Gets the number of codes in the set.</summary>
+/// <param name='set'>The candidate set.</param>
+/// <returns>The number of codes.</returns>
+size_t mastermind_candidates_count(const MASTERMIND_CANDIDATES *set);
+
+/// <summary>Checks if the code of a rank is in the set.</summary>
+/// <param name='set'>The candidate set.</param>
+/// <param name='rank'>Rank of the code.</param>
+/// <returns>True if the code is a candidate.</returns>
+bool mastermind_candidates_contains(const MASTERMIND_CANDIDATES *set, uint32_t rank);
+
+/// <summary>Iterates over the set: gets the smallest rank in the set which is >= rank.</summary>
+/// <param name='set'>The candidate set.</param>
+/// <param name='rank'>Rank to start at, 0 for the first candidate.</param>
+/// <returns>The rank or UINT32_MAX if there is none.</returns>
+uint32_t mastermind_candidates_next(const MASTERMIND_CANDIDATES *set, uint32_t rank);
+
+/// <summary>Collects all codes of the set, or an evenly spread part of them if there are more than max.</summary>
+/// <param name='set'>The candidate set.</param>
+/// <param name='codes'>Destination for the packed codes.</param>
+/// <param name='ranks'>Destination for the ranks of the codes, may be NULL.</param>
+/// <param name='max'>Max. number of codes to collect.</param>
+/// <returns>The number of codes collected (in order of their ranks).</returns>
+size_t mastermind_candidates_collect(const MASTERMIND_CANDIDATES *set, MMCODE *codes, uint32_t *ranks, size_t max);
+
+/// <summary>Scores a guess against a part of the set before its feedback is known, so mastermind_candidates_prune_scored() needs no scoring.</summary>
+/// <param name='set'>The candidate set, enumerable codes have at most 8 pegs.</param>
+/// <param name='guess'>The packed guess.</param>
+/// <param name='begin'>First rank of the part, a multiple of 64.</param>
+/// <param name='end'>End of the part (exclusive), a multiple of 64 or the number of codes.</param>
+/// <param name='scores'>Destination for the scores of the codes of the part (in order of their ranks).</param>
+/// <returns>The number of codes of the part.</returns>
+size_t mastermind_candidates_score(const MASTERMIND_CANDIDATES *set, MMCODE guess, uint32_t begin, uint32_t end, uint16_t *scores);
+
+/// <summary>Removes every code which would not have given feedback, in one pass over the set without scoring.</summary>
+/// <param name='set'>The candidate set, unchanged since scores were taken.</param>
+/// <param name='scores'>Scores of all codes of the set for the guess (see mastermind_candidates_score()).</param>
+/// <param name='feedback'>The feedback the guess got.</param>
+/// <returns>The number of codes left.</returns>
+size_t mastermind_candidates_prune_scored(MASTERMIND_CANDIDATES *set, const uint16_t *scores, MMFEEDBACK feedback);
+
+/// <summary>Gets a 64 bit hash of the codes in the set (xor of a key per rank, Zobrist hashing).</summary>
+/// <param name='set'>The candidate set.</param>
+/// <returns>The hash, equal sets of the same preferences have equal hashes.</returns>
+uint64_t mastermind_candidates_hash(const MASTERMIND_CANDIDATES *set);
+
+/// <summary>Gets the colors which are still possible at every position, stops as soon as every color is possible everywhere.</summary>
+/// <param name='set'>The candidate set.</param>
+/// <param name='colors'>Destination for code_length masks, bit c of colors[n] = a code of the set has color c at peg n.</param>
+void mastermind_candidates_colors(const MASTERMIND_CANDIDATES *set, uint32_t *colors);
+
+/// <summary>Frees a candidate set created by mastermind_candidates_create().</summary>
+/// <param name='set'>The candidate set, may be NULL.</param>
+void mastermind_candidates_destroy(MASTERMIND_CANDIDATES *set);
+
+/// <summary>Maps an opening book file into memory.</summary>
+/// <param name='path'>Path of the book, e.g. MMBOOK_DEFAULT_PATH.</param>
+/// <returns>The book or NULL if the file is missing, damaged or stale (other MMSOLVER_REVISION).</returns>
+MASTERMIND_BOOK *mastermind_book_open(const char *path);
+
+/// <summary>Gets the root node of the decision tree for the given preferences.</summary>
+/// <param name='book'>The book, may be NULL.</param>
+/// <param name='prefs'>Preferences of game.</param>
+/// <returns>The node or 0 if the book has no tree for prefs.</returns>
+uint32_t mastermind_book_root(const MASTERMIND_BOOK *book, const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Gets the guess stored in a node.</summary>
+/// <param name='book'>The book.</param>
+/// <param name='node'>A node returned by mastermind_book_root() or mastermind_book_child().</param>
+/// <returns>The packed guess or MMBOOK_NO_GUESS.</returns>
+MMCODE mastermind_book_guess(const MASTERMIND_BOOK *book, uint32_t node);
+
+/// <summary>Follows the feedback the guess of a node got.</summary>
+/// <param name='book'>The book.</param>
+/// <param name='node'>A node returned by mastermind_book_root() or mastermind_book_child().</param>
+/// <param name='index'>Feedback index of the feedback, see mastermind_feedback_index().</param>
+/// <returns>The next node or 0 if the tree ends there.</returns>
+uint32_t mastermind_book_child(const MASTERMIND_BOOK *book, uint32_t node, unsigned int index);
+
+/// <summary>Unmaps a book opened by mastermind_book_open().</summary>
+/// <param name='book'>The book, may be NULL.</param>
+void mastermind_book_close(MASTERMIND_BOOK *book);
+
+/// <summary>Creates an empty transposition table, it may be shared by any number of solvers and threads.</summary>
+/// <param name='entries'>Number of entries, rounded up to a power of 2 (e.g. MMTTABLE_DEFAULT_ENTRIES).</param>
+/// <returns>The table or NULL if out of memory. Free it with mastermind_ttable_destroy().</returns>
+MASTERMIND_TTABLE *mastermind_ttable_create(size_t entries);
+
+/// <summary>Adds the entries of a table file saved before.</summary>
+/// <param name='ttable'>The table, its size may differ from the saved one.</param>
+/// <param name='path'>Path of the file.</param>
+/// <returns>False if the file is missing, damaged or stale (other MMSOLVER_REVISION).</returns>
+bool mastermind_ttable_load(MASTERMIND_TTABLE *ttable, const char *path);
+
+/// <summary>Writes the used entries of a table to a file, no solver may use it meanwhile.</summary>
+/// <param name='ttable'>The table.</param>
+/// <param name='path'>Path of the file, it is replaced.</param>
+/// <returns>False if the file cannot be written.</returns>
+bool mastermind_ttable_save(MASTERMIND_TTABLE *ttable, const char *path);
+
+/// <summary>Looks up the guess of a key.</summary>
+/// <param name='ttable'>The table.</param>
+/// <param name='key'>Key of the candidate set and everything else the guess depends on.</param>
+/// <param name='guess'>Destination for the guess.</param>
+/// <param name='cost'>Destination for the cost of the guess.</param>
+/// <returns>True if the key was found.</returns>
+bool mastermind_ttable_lookup(MASTERMIND_TTABLE *ttable, uint64_t key, MMCODE *guess, uint64_t *cost);
+
+/// <summary>Stores the guess of a key, a full bucket replaces an entry which was not found for the longest time (clock).</summary>
+/// <param name='ttable'>The table.</param>
+/// <param name='key'>Key of the candidate set and everything else the guess depends on.</param>
+/// <param name='guess'>The guess.</param>
+/// <param name='cost'>Its cost.</param>
+void mastermind_ttable_store(MASTERMIND_TTABLE *ttable, uint64_t key, MMCODE guess, uint64_t cost);
+
+/// <summary>Gets the number of lookups and how many of them found their key.</summary>
+/// <param name='ttable'>The table.</param>
+/// <param name='lookups'>Destination for the number of lookups.</param>
+/// <param name='hits'>Destination for the number of lookups which found their key.</param>
+void mastermind_ttable_counts(MASTERMIND_TTABLE *ttable, uint64_t *lookups, uint64_t *hits);
+
+/// <summary>Frees a table created by mastermind_ttable_create().</summary>
+/// <param name='ttable'>The table, may be NULL.</param>
+void mastermind_ttable_destroy(MASTERMIND_TTABLE *ttable);
+
+/// <summary>Creates a COMSOLVER for games with the given preferences.</summary>
+/// <param name='prefs'>Preferences of game, the first guesses are taken from prefs.book if it has a tree for them.</param>
+/// <param name='table'>Feedback table for prefs or NULL, must outlive the solver.</param>
+/// <returns>The solver or NULL if out of memory. Free it with mastermind_solver_destroy().</returns>
+MASTERMIND_SOLVER *mastermind_solver_create(const MASTERMIND_PREFERENCES *prefs, const MASTERMIND_SCORETABLE *table);
+/// <summary>Gets the name of the search mastermind_solver_create() uses for prefs, which may differ from prefs.strategy.</summary>
+/// <param name='prefs'>Preferences of game.</param>
+/// <returns>"minimax", "entropy", "propagate" (constraint propagation) or "genetic" (genetic search).</returns>
+const char *mastermind_solver_name(const MASTERMIND_PREFERENCES *prefs);
+
+/// <summary>Forgets all feedbacks so the solver can be used for a new game.</summary>
+/// <param name='solver'>The solver.</param>
+/// <returns>False if out of memory.</returns>
+bool mastermind_solver_reset(MASTERMIND_SOLVER *solver);
+
+/// <summary>Selects the next guess by prefs.strategy (minimax, entropy or propagate) on prefs.thread_count threads, beyond enumeration by constraint propagation (position based hints) or a genetic search within prefs.solver_millis.</summary>
+/// <param name='solver'>The solver.</param>
+/// <returns>The packed guess.</returns>
+MMCODE mastermind_solver_guess(MASTERMIND_SOLVER *solver);
+
+/// <summary>Removes all codes which are inconsistent with the feedback of a guess.</summary>
+/// <param name='solver'>The solver.</param>
+/// <param name='guess'>The packed guess.</param>
+/// <param name='feedback'>The feedback the guess got.</param>
+/// <returns>False if out of memory or too many attempts.</returns>
+bool mastermind_solver_feedback(MASTERMIND_SOLVER *solver, MMCODE guess, MMFEEDBACK feedback);
+
+/// <summary>Makes a mastermind_solver_guess() running on another thread return soon with a useless guess (not beyond enumeration).</summary>
+/// <param name='solver'>The solver.</param>
+/// <param name='cancel'>True to cancel, false to let the next guesses be selected as usual again.</param>
+void mastermind_solver_cancel(MASTERMIND_SOLVER *solver, bool cancel);
+
+/// <summary>Gets the number of codes which may still be the secret code.</summary>
+/// <param name='solver'>The solver.</param>
+/// <returns>The number of consistent codes, beyond enumeration the number found by the last genetic search (a lower bound), 0 if unknown (constraint propagation).</returns>
+size_t mastermind_solver_remaining(const MASTERMIND_SOLVER *solver);
+
+/// <summary>Frees a solver created by mastermind_solver_create().</summary>
+/// <param name='solver'>The solver, may be NULL.</param>
+void mastermind_solver_destroy(MASTERMIND_SOLVER *solver);
+
+/// <summary>Creates a pool of sessions, the only allocation of the session API.</summary>
+/// <param name='capacity'>Max. number of sessions at once.</param>
+/// <returns>The pool or NULL if out of memory. Free it with mastermind_pool_destroy().</returns>
+MASTERMIND_POOL *mastermind_pool_create(size_t capacity);
+
+/// <summary>Frees a pool and all of its sessions.</summary>
+/// <param name='pool'>The pool, may be NULL.</param>
+void mastermind_pool_destroy(MASTERMIND_POOL *pool);
+
+/// <summary>Starts a game.</summary>
+/// <param name='pool'>Pool the session is taken from, may be NULL (then NULL is returned).</param>
+/// <param name='prefs'>Preferences of game.</param>
+/// <param name='secret'>The secret code, e.g. from mastermind_random_code().</param>
+/// <returns>The session or NULL if prefs or secret are invalid or the pool is exhausted.</returns>
+MASTERMIND_SESSION *mastermind_session_create(MASTERMIND_POOL *pool, const MASTERMIND_PREFERENCES *prefs, MMCODE secret);
+
+/// <summary>Scores a guess and advances the game.</summary>
+/// <param name='session'>The session.</param>
+/// <param name='guess'>The packed guess.</param>
+/// <param name='feedback'>Destination for the feedback, may be NULL.</param>
+/// <returns>False if the game is over or guess is no valid code.</returns>
+bool mastermind_session_guess(MASTERMIND_SESSION *session, MMCODE guess, MMFEEDBACK *feedback);
+
+/// <summary>Gets the state of a game.</summary>
+/// <param name='session'>The session.</param>
+/// <param name='state'>Destination for the state.</param>
+void mastermind_session_state(const MASTERMIND_SESSION *session, MASTERMIND_STATE *state);
+
+/// <summary>Returns a session to its pool.</summary>
+/// <param name='pool'>The pool the session was taken from.</param>
+/// <param name='session'>The session, may be NULL.</param>
+void mastermind_session_destroy(MASTERMIND_POOL *pool, MASTERMIND_SESSION *session);
+
+/// <summary>Opens a game log for appending, a new file gets the header first.</summary>
+/// <param name='path'>Path of the log.</param>
+/// <returns>The log or NULL if the file cannot be written or is no game log. Close it with mastermind_log_close().</returns>
+MASTERMIND_LOG *mastermind_log_open(const char *path);
+
+/// <summary>Appends games to the buffer of a log, the background thread writes it to the file.</summary>
+/// <param name='log'>The log, may be NULL (then nothing is done).</param>
+/// <param name='games'>The games.</param>
+/// <param name='count'>Number of games.</param>
+/// <returns>False if a write of the log failed.</returns>
+bool mastermind_log_games(MASTERMIND_LOG *log, const MASTERMIND_GAMELOG *games, size_t count);
+
+/// <summary>Writes all buffered games, stops the background thread and closes the file.</summary>
+/// <param name='log'>The log, may be NULL.</param>
+/// <returns>False if a write of the log failed.</returns>
+bool mastermind_log_close(MASTERMIND_LOG *log);
+
+/// <summary>Mixes a 64 bit value (splitmix64), for seeds and hashes.</summary>
+/// <param name='value'>Any value.</param>
+/// <returns>The mixed value, a different one for every value.</returns>
+static inline uint64_t mastermind_mix64(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+/// <summary>Initializes a random generator.</summary>
+/// <param name='random'>The generator.</param>
+/// <param name='seed'>Any value, the same seed gives the same numbers.</param>
+void mastermind_random_seed(MASTERMIND_RANDOM *random, uint64_t seed);
+
+/// <summary>Gets the next 64 random bits.</summary>
+/// <param name='random'>The generator.</param>
+/// <returns>A uniformly distributed value.</returns>
+uint64_t mastermind_random_next(MASTERMIND_RANDOM *random);
+
+/// <summary>Gets a random number below bound without modulo bias.</summary>
+/// <param name='random'>The generator.</param>
+/// <param name='bound'>Number of possible values, at least 1.</param>
+/// <returns>A uniformly distributed value in [0, bound).</returns>
+uint32_t mastermind_random_below(MASTERMIND_RANDOM *random, uint32_t bound);
+
+/// <summary>Creates a random secret code, every valid code is equally likely.</summary>
+/// <param name='prefs'>Preferences of game (must be valid).</param>
+/// <param name='random'>The generator.</param>
+/// <returns>The packed code.</returns>
+MMCODE mastermind_random_code(const MASTERMIND_PREFERENCES *prefs, MASTERMIND_RANDOM *random);
+
+/// <summary>Creates many random secret codes, e.g. for simulations and benchmarks.</summary>
+/// <param name='prefs'>Preferences of game (must be valid).</param>
+/// <param name='random'>The generator.</param>
+/// <param name='codes'>Destination for count packed codes.</param>
+/// <param name='count'>Number of codes.</param>
+void mastermind_random_codes(const MASTERMIND_PREFERENCES *prefs, MASTERMIND_RANDOM *random,
+    MMCODE *codes, size_t count);
+
+/// <summary>Plays games with the COMSOLVER against random secret codes, without any UI.</summary>
+/// <param name='prefs'>Preferences of game, prefs.thread_count games are played at once.</param>
+/// <param name='games'>Number of games to play.</param>
+/// <param name='seed'>Seed of the secret codes, the same seed gives the same games.</param>
+/// <param name='report'>Destination for the results.</param>
+/// <returns>False if prefs are invalid or out of memory.</returns>
+bool mastermind_simulate(const MASTERMIND_PREFERENCES *prefs, uint64_t games, uint64_t seed,
+    MASTERMIND_SIMREPORT *report);
 
 // end of MASTERMIND_H include guard
 #endif
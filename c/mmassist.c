@@ -0,0 +1,141 @@
+/*!mmassist.c
+ * Codes left after every guess (assist panel) for game MasterMind (see mmassist.h).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mastermind.h"
+#include "mmassist.h"
+#include "mmthread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ranks scored at once, a multiple of 64 (about a millisecond for a full set of 8 pegs)
+#define MMASSIST_STEP (1u << 16)
+
+// state of the assist panel
+struct mmassist {
+    MASTERMIND_PREFERENCES prefs;
+    MASTERMIND_CANDIDATES *set; // codes left
+    uint16_t *scores; // scores of the codes left for the typed guess, in order of their ranks
+    uint32_t code_count,
+        scored_to; // the codes left below this rank are scored
+    size_t scored; // number of scores
+    MMCODE input; // typed guess if complete
+    bool complete;
+    uint32_t colors[MMPREFS_MAX_CODE_LENGTH]; // colors left at every peg
+    MMCODE code; // a code left
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// scores the typed guess against the next MMASSIST_STEP ranks
+static void nex_assist_score(struct mmassist *assist) {
+    uint32_t end = assist->code_count - assist->scored_to > MMASSIST_STEP ?
+        assist->scored_to + MMASSIST_STEP : assist->code_count;
+    assist->scored += mastermind_candidates_score(assist->set, assist->input, assist->scored_to, end,
+        assist->scores + assist->scored);
+    assist->scored_to = end;
+}
+// forgets the scores of the typed guess
+static void nex_assist_forget(struct mmassist *assist) {
+    assist->scored_to = 0;
+    assist->scored = 0;
+}
+// updates the colors and the code left after the set changed
+static void nex_assist_update(struct mmassist *assist) {
+    uint32_t rank = mastermind_candidates_next(assist->set, 0);
+    mastermind_candidates_colors(assist->set, assist->colors);
+    assist->code = rank != UINT32_MAX ? mastermind_code_unrank(&assist->prefs, rank) : 0;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+struct mmassist *mmassist_create(const MASTERMIND_PREFERENCES *prefs) {
+    struct mmassist *assist = calloc(1, sizeof(struct mmassist));
+    if (!assist)
+        return NULL;
+    assist->prefs = *prefs;
+    assist->code_count = mastermind_code_count(prefs);
+    assist->set = mastermind_candidates_create(prefs);
+    assist->scores = malloc(assist->code_count * sizeof(uint16_t));
+    if (!assist->set || !assist->scores) {
+        mmassist_destroy(assist);
+        return NULL;
+    }
+    mmassist_reset(assist);
+    return assist;
+}
+
+void mmassist_reset(struct mmassist *assist) {
+    mastermind_candidates_reset(assist->set);
+    assist->complete = false;
+    nex_assist_forget(assist);
+    nex_assist_update(assist);
+}
+
+void mmassist_input(struct mmassist *assist, const char *code, unsigned int length) {
+    bool complete = length == assist->prefs.code_length;
+    MMCODE input = complete ? mastermind_code_pack(&assist->prefs, code) : 0;
+    if (complete != assist->complete || input != assist->input) {
+        assist->complete = complete;
+        assist->input = input;
+        nex_assist_forget(assist);
+    }
+}
+
+bool mmassist_step(struct mmassist *assist, double seconds) {
+    double started = mmtime_now();
+    if (!assist->complete)
+        return false;
+    while (assist->scored_to < assist->code_count && mmtime_now() - started < seconds)
+        nex_assist_score(assist);
+    return assist->scored_to < assist->code_count;
+}
+
+void mmassist_feedback(struct mmassist *assist, MMCODE guess, MMFEEDBACK feedback) {
+    if (!assist->complete || assist->input != guess) { // not typed (COMSOLVER), nothing scored ahead
+        assist->complete = true;
+        assist->input = guess;
+        nex_assist_forget(assist);
+    }
+    while (assist->scored_to < assist->code_count)
+        nex_assist_score(assist);
+    mastermind_candidates_prune_scored(assist->set, assist->scores, feedback);
+    assist->complete = false;
+    nex_assist_forget(assist);
+    nex_assist_update(assist);
+}
+
+size_t mmassist_remaining(const struct mmassist *assist) {
+    return mastermind_candidates_count(assist->set);
+}
+
+MMCODE mmassist_code(const struct mmassist *assist) {
+    return assist->code;
+}
+
+const uint32_t *mmassist_colors(const struct mmassist *assist) {
+    return assist->colors;
+}
+
+void mmassist_destroy(struct mmassist *assist) {
+    if (!assist)
+        return;
+    mastermind_candidates_destroy(assist->set);
+    free(assist->scores);
+    free(assist);
+}
+
+
+
+// End of source file 'mmassist.c'
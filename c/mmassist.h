@@ -0,0 +1,44 @@
+/*!mmassist.h
+ * Codes left after every guess (assist panel) for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Keeps the set of codes which may still be the secret code and prunes it
+ * with every feedback, so no guess is scored twice. The typed guess is
+ * scored against the set in small steps while the player waits anyway, so
+ * the feedback only needs one pass without scoring (8 pegs with 8 colors:
+ * milliseconds instead of a quarter of a second for the first guess).
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMASSIST_H
+#define MMASSIST_H
+
+#include "mastermind.h"
+
+// state of the assist panel of the game
+struct mmassist;
+
+// creates the assist state for games with prefs (must be enumerable), returns NULL if out of memory
+struct mmassist *mmassist_create(const MASTERMIND_PREFERENCES *prefs);
+// starts a new game, every code is left
+void mmassist_reset(struct mmassist *assist);
+// tells the typed guess, code holds its first length pegs ('a' = color 0)
+void mmassist_input(struct mmassist *assist, const char *code, unsigned int length);
+// scores the typed guess for about seconds, returns true if there is still work to do
+bool mmassist_step(struct mmassist *assist, double seconds);
+// removes every code which would not have given feedback for guess
+void mmassist_feedback(struct mmassist *assist, MMCODE guess, MMFEEDBACK feedback);
+// gets the number of codes left
+size_t mmassist_remaining(const struct mmassist *assist);
+// gets a code which is left, it may win at once (the panel shows it while the hint is not ready)
+MMCODE mmassist_code(const struct mmassist *assist);
+// gets code_length masks, bit c of mask n = color c is still possible at peg n
+const uint32_t *mmassist_colors(const struct mmassist *assist);
+// frees everything, may be NULL
+void mmassist_destroy(struct mmassist *assist);
+
+// end of MMASSIST_H include guard
+#endif
@@ -0,0 +1,405 @@
+/*!mmbench.c
+ * Microbenchmarks of the hot paths of game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Prints one result per benchmark as CSV (default) or JSON:
+ *   name, iterations, ns_per_op, cycles_per_op
+ * With --compare FILE the results are checked against a CSV baseline and
+ * every benchmark slower than the threshold is flagged as a regression.
+ */
+
+#include "mastermind.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <x86intrin.h>
+    #define __mmbenchtsc__ 1
+#endif
+
+// number of codes the scoring benchmarks work on
+#define MMBENCH_CODES 4096
+// max. number of benchmarks and length of their names
+#define MMBENCH_MAX 512
+#define MMBENCH_NAME 64
+// max. colors of the full game benchmarks, the games run up to 8 pegs x 8 colors
+#define MMBENCH_GAME_MAX_COLOR_COUNT 8
+
+// one benchmark: setup() creates its state, run() does ops operations
+struct mmbench {
+    char name[MMBENCH_NAME];
+    MASTERMIND_PREFERENCES prefs;
+    void *(*setup)(const MASTERMIND_PREFERENCES *prefs);
+    void (*run)(void *state, uint64_t ops);
+    void (*teardown)(void *state);
+};
+
+// result of one benchmark
+struct mmbenchresult {
+    char name[MMBENCH_NAME];
+    uint64_t iterations;
+    double ns_per_op,
+        cycles_per_op;
+};
+
+// state of the scoring benchmarks
+struct mmbenchcodes {
+    MASTERMIND_PREFERENCES prefs;
+    MMCODE codes[MMBENCH_CODES];
+    MMFEEDBACK out[MMBENCH_CODES];
+};
+
+// state of the solver benchmarks
+struct mmbenchsolver {
+    MASTERMIND_PREFERENCES prefs;
+    MASTERMIND_SCORETABLE *table;
+    MASTERMIND_SOLVER *solver;
+    MMCODE secrets[MMBENCH_CODES];
+};
+
+static volatile uint64_t sink; // keeps the compiler from removing the benchmarked work
+static MASTERMIND_RANDOM random_state = { { 0x853C49E6748FEA9Bull, 0xDA3E39CB94B95BDBull, 1, 2 } };
+
+
+
+/*****************/
+/*** UTILITIES ***/
+/*****************/
+
+// gets the CPU time stamp counter, 0 if not available
+static uint64_t bench_cycles(void) {
+    #if defined(__mmbenchtsc__)
+    return __rdtsc();
+    #else
+    return 0;
+    #endif
+}
+// creates a random code which is valid for prefs, the benchmarks get the same codes on every run
+static MMCODE bench_code(const MASTERMIND_PREFERENCES *prefs) {
+    return mastermind_random_code(prefs, &random_state);
+}
+
+
+
+/******************/
+/*** BENCHMARKS ***/
+/******************/
+
+static void *setup_codes(const MASTERMIND_PREFERENCES *prefs) {
+    struct mmbenchcodes *state = malloc(sizeof(struct mmbenchcodes));
+    unsigned int n;
+    if (!state)
+        return NULL;
+    state->prefs = *prefs;
+    for (n = 0; n < MMBENCH_CODES; n++)
+        state->codes[n] = bench_code(prefs);
+    return state;
+}
+// op = one mastermind_score() call
+static void run_score(void *arg, uint64_t ops) {
+    struct mmbenchcodes *state = arg;
+    uint64_t n, acc = 0;
+    for (n = 0; n < ops; n++)
+        acc += mastermind_score(&state->prefs, state->codes[n % MMBENCH_CODES], state->codes[(n * 7 + 1) % MMBENCH_CODES]);
+    sink += acc;
+}
+// op = one code scored by mastermind_score_batch()
+static void run_score_batch(void *arg, uint64_t ops) {
+    struct mmbenchcodes *state = arg;
+    uint64_t n;
+    for (n = 0; n < ops; n += MMBENCH_CODES) {
+        size_t count = ops - n < MMBENCH_CODES ? (size_t)(ops - n) : MMBENCH_CODES;
+        mastermind_score_batch(&state->prefs, state->codes[n / MMBENCH_CODES % MMBENCH_CODES], state->codes, state->out, count);
+        sink += state->out[count - 1];
+    }
+}
+// op = one secret code created like mastermind_game() does it
+static void run_secret(void *arg, uint64_t ops) {
+    struct mmbenchcodes *state = arg;
+    uint64_t n, acc = 0;
+    for (n = 0; n < ops; n++)
+        acc += mastermind_random_code(&state->prefs, &random_state);
+    sink += acc;
+}
+// op = one secret code created by mastermind_random_codes() like mastermind_simulate() does it
+static void run_secrets(void *arg, uint64_t ops) {
+    struct mmbenchcodes *state = arg;
+    uint64_t n;
+    for (n = 0; n < ops; n += MMBENCH_CODES) {
+        size_t count = ops - n < MMBENCH_CODES ? (size_t)(ops - n) : MMBENCH_CODES;
+        mastermind_random_codes(&state->prefs, &random_state, state->codes, count);
+        sink += state->codes[count - 1];
+    }
+}
+
+static void *setup_solver(const MASTERMIND_PREFERENCES *prefs) {
+    struct mmbenchsolver *state = calloc(1, sizeof(struct mmbenchsolver));
+    unsigned int n;
+    if (!state)
+        return NULL;
+    state->prefs = *prefs;
+    state->table = mastermind_scoretable_create(prefs);
+    state->solver = state->table ? mastermind_solver_create(prefs, state->table) : NULL;
+    if (!state->solver) {
+        mastermind_scoretable_destroy(state->table);
+        free(state);
+        return NULL;
+    }
+    for (n = 0; n < MMBENCH_CODES; n++)
+        state->secrets[n] = bench_code(prefs);
+    return state;
+}
+static void teardown_solver(void *arg) {
+    struct mmbenchsolver *state = arg;
+    mastermind_solver_destroy(state->solver);
+    mastermind_scoretable_destroy(state->table);
+    free(state);
+}
+// op = reset + pruning of the full candidate set with the feedback of the first guess
+static void run_prune(void *arg, uint64_t ops) {
+    struct mmbenchsolver *state = arg;
+    MMCODE guess = mastermind_solver_guess(state->solver); // the same for every game
+    uint64_t n;
+    for (n = 0; n < ops; n++) {
+        MMCODE secret = state->secrets[n % MMBENCH_CODES];
+        mastermind_solver_reset(state->solver);
+        mastermind_solver_feedback(state->solver, guess, mastermind_score(&state->prefs, guess, secret));
+        sink += mastermind_solver_remaining(state->solver);
+    }
+}
+// op = selection of the second guess (after the feedback of the first guess)
+static void run_select(void *arg, uint64_t ops) {
+    struct mmbenchsolver *state = arg;
+    MMCODE guess;
+    uint64_t n;
+    mastermind_solver_reset(state->solver);
+    guess = mastermind_solver_guess(state->solver);
+    mastermind_solver_feedback(state->solver, guess, mastermind_score(&state->prefs, guess, state->secrets[0]));
+    for (n = 0; n < ops; n++)
+        sink += mastermind_solver_guess(state->solver);
+}
+// op = one game solved by the COMSOLVER
+static void run_game(void *arg, uint64_t ops) {
+    struct mmbenchsolver *state = arg;
+    uint64_t n;
+    for (n = 0; n < ops; n++) {
+        MMCODE secret = state->secrets[n % MMBENCH_CODES], guess;
+        unsigned int attempt;
+        mastermind_solver_reset(state->solver);
+        for (attempt = 0; attempt < state->prefs.attempt_count; attempt++) {
+            guess = mastermind_solver_guess(state->solver);
+            if (guess == secret)
+                break;
+            mastermind_solver_feedback(state->solver, guess, mastermind_score(&state->prefs, guess, secret));
+        }
+        sink += attempt;
+    }
+}
+
+
+
+/*******************/
+/*** THE HARNESS ***/
+/*******************/
+
+// adds a benchmark to the list
+static void bench_add(struct mmbench *list, unsigned int *count, const char *name,
+    MASTERMIND_PREFERENCES prefs, void *(*setup)(const MASTERMIND_PREFERENCES *),
+    void (*run)(void *, uint64_t), void (*teardown)(void *)) {
+    struct mmbench *bench = &list[(*count)++];
+    snprintf(bench->name, MMBENCH_NAME, "%s/%ux%u/a%u/m%d/p%d", name, prefs.code_length,
+        prefs.color_count, prefs.attempt_count, prefs.multiple_colors, prefs.hints_position_based);
+    bench->prefs = prefs;
+    bench->setup = setup;
+    bench->run = run;
+    bench->teardown = teardown;
+}
+// builds the list of all benchmarks
+static unsigned int bench_list(struct mmbench *list) {
+    MASTERMIND_PREFERENCES prefs = { 4, 6, MMPREFS_MAX_ATTEMPT_COUNT, false, true };
+    unsigned int count = 0, length, colors, multiple, position;
+    prefs.thread_count = 1; // measure the single-threaded code paths
+    for (position = 0; position <= 1; position++) {
+        MASTERMIND_PREFERENCES small = prefs, large = prefs, huge = prefs;
+        small.hints_position_based = large.hints_position_based = huge.hints_position_based = position;
+        large.code_length = large.color_count = MMPREFS_ENUM_MAX_CODE_LENGTH;
+        huge.code_length = huge.color_count = MMPREFS_MAX_CODE_LENGTH;
+        large.multiple_colors = huge.multiple_colors = true;
+        bench_add(list, &count, "score", small, setup_codes, run_score, free);
+        bench_add(list, &count, "score", large, setup_codes, run_score, free);
+        bench_add(list, &count, "score", huge, setup_codes, run_score, free);
+        bench_add(list, &count, "score_batch", small, setup_codes, run_score_batch, free);
+        bench_add(list, &count, "score_batch", large, setup_codes, run_score_batch, free);
+        bench_add(list, &count, "score_batch", huge, setup_codes, run_score_batch, free);
+        bench_add(list, &count, "prune", small, setup_solver, run_prune, teardown_solver);
+        bench_add(list, &count, "select", small, setup_solver, run_select, teardown_solver);
+        small.strategy = MMSTRATEGY_ENTROPY;
+        bench_add(list, &count, "select_entropy", small, setup_solver, run_select, teardown_solver);
+    }
+    bench_add(list, &count, "secret", prefs, setup_codes, run_secret, free);
+    bench_add(list, &count, "secrets", prefs, setup_codes, run_secrets, free);
+    prefs.multiple_colors = true;
+    bench_add(list, &count, "secret", prefs, setup_codes, run_secret, free);
+    bench_add(list, &count, "secrets", prefs, setup_codes, run_secrets, free);
+    // full games for every valid preference combination up to 8x8 (minimax COMSOLVER)
+    for (length = MMPREFS_MIN_CODE_LENGTH; length <= MMPREFS_ENUM_MAX_CODE_LENGTH; length++)
+    for (colors = MMPREFS_MIN_COLOR_COUNT; colors <= MMBENCH_GAME_MAX_COLOR_COUNT; colors++)
+    for (multiple = 0; multiple <= 1; multiple++)
+    for (position = 0; position <= 1; position++) {
+        MASTERMIND_PREFERENCES game = prefs;
+        game.code_length = length;
+        game.color_count = colors;
+        game.multiple_colors = multiple;
+        game.hints_position_based = position;
+        if (mastermind_prefs_valid(&game) && mastermind_prefs_enumerable(&game))
+            bench_add(list, &count, "game", game, setup_solver, run_game, teardown_solver);
+    }
+    // a full game of the genetic COMSOLVER beyond enumeration
+    prefs.code_length = prefs.color_count = 10;
+    bench_add(list, &count, "game", prefs, setup_solver, run_game, teardown_solver);
+    return count;
+}
+// runs a benchmark with more and more ops until it took min_seconds
+static bool bench_run(const struct mmbench *bench, double min_seconds, struct mmbenchresult *result) {
+    void *state = bench->setup(&bench->prefs);
+    uint64_t ops = 1, cycles;
+    double seconds;
+    if (!state)
+        return false;
+    bench->run(state, 1); // warm up caches and lazy initialization
+    while (1) {
+        double start = mmtime_now();
+        uint64_t start_cycles = bench_cycles();
+        bench->run(state, ops);
+        cycles = bench_cycles() - start_cycles;
+        seconds = mmtime_now() - start;
+        if (seconds >= min_seconds)
+            break;
+        // aim a bit above min_seconds with the next try
+        ops = seconds > 0 ? (uint64_t)(ops * (min_seconds * 1.2 / seconds)) + 1 : ops * 16;
+    }
+    bench->teardown(state);
+    strcpy(result->name, bench->name);
+    result->iterations = ops;
+    result->ns_per_op = seconds * 1e9 / ops;
+    result->cycles_per_op = (double)cycles / ops;
+    return true;
+}
+// reads a CSV file written by this program, returns the number of results
+static unsigned int bench_read(const char *path, struct mmbenchresult *results) {
+    FILE *file = fopen(path, "r");
+    char line[256];
+    unsigned int count = 0;
+    if (!file)
+        return 0;
+    while (count < MMBENCH_MAX && fgets(line, sizeof(line), file)) {
+        struct mmbenchresult *result = &results[count];
+        char *comma = strchr(line, ',');
+        unsigned long long iterations;
+        if (!comma || comma - line >= MMBENCH_NAME || strncmp(line, "name,", 5) == 0)
+            continue;
+        memcpy(result->name, line, comma - line);
+        result->name[comma - line] = 0;
+        if (sscanf(comma + 1, "%llu,%lf,%lf", &iterations, &result->ns_per_op, &result->cycles_per_op) == 3) {
+            result->iterations = iterations;
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --json                 print JSON instead of CSV\n"
+        "  --filter TEXT          only run benchmarks whose name contains TEXT\n"
+        "  --time SECONDS         min. time per benchmark (default 0.2)\n"
+        "  --output FILE          write the results to FILE instead of stdout\n"
+        "  --compare FILE         flag regressions against a CSV baseline (exit code 2)\n"
+        "  --threshold PERCENT    allowed slowdown for --compare (default 10)\n", name);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    static struct mmbench benches[MMBENCH_MAX];
+    static struct mmbenchresult results[MMBENCH_MAX], baseline[MMBENCH_MAX];
+    const char *filter = NULL, *output = NULL, *compare = NULL;
+    double min_seconds = 0.2, threshold = 10;
+    bool json = false;
+    unsigned int n, m, count, result_count = 0, baseline_count = 0, regressions = 0;
+    FILE *out = stdout;
+    for (n = 1; n < (unsigned int)argc; n++) {
+        if (strcmp(argv[n], "--json") == 0)
+            json = true;
+        else if (n + 1 == (unsigned int)argc)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--filter") == 0)
+            filter = argv[++n];
+        else if (strcmp(argv[n], "--time") == 0)
+            min_seconds = atof(argv[++n]);
+        else if (strcmp(argv[n], "--output") == 0)
+            output = argv[++n];
+        else if (strcmp(argv[n], "--compare") == 0)
+            compare = argv[++n];
+        else if (strcmp(argv[n], "--threshold") == 0)
+            threshold = atof(argv[++n]);
+        else
+            return usage(argv[0]);
+    }
+    if (compare && !(baseline_count = bench_read(compare, baseline))) {
+        fprintf(stderr, "no results in baseline '%s'\n", compare);
+        return 1;
+    }
+    if (output && !(out = fopen(output, "w"))) {
+        fprintf(stderr, "cannot write '%s'\n", output);
+        return 1;
+    }
+    count = bench_list(benches);
+    fprintf(out, json ? "[\n" : "name,iterations,ns_per_op,cycles_per_op\n");
+    for (n = 0; n < count; n++) {
+        struct mmbenchresult *result = &results[result_count];
+        if (filter && !strstr(benches[n].name, filter))
+            continue;
+        if (!bench_run(&benches[n], min_seconds, result)) {
+            fprintf(stderr, "%s: setup failed\n", benches[n].name);
+            continue;
+        }
+        if (json)
+            fprintf(out, "%s  { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"cycles_per_op\": %.3f }",
+                result_count ? ",\n" : "", result->name, (unsigned long long)result->iterations,
+                result->ns_per_op, result->cycles_per_op);
+        else
+            fprintf(out, "%s,%llu,%.3f,%.3f\n", result->name, (unsigned long long)result->iterations,
+                result->ns_per_op, result->cycles_per_op);
+        fflush(out);
+        result_count++;
+    }
+    if (json)
+        fprintf(out, "\n]\n");
+    if (output)
+        fclose(out);
+    // compare against the baseline, the report goes to stderr so the results stay machine-readable
+    for (n = 0; n < result_count && compare; n++) {
+        for (m = 0; m < baseline_count && strcmp(baseline[m].name, results[n].name) != 0; m++);
+        if (m == baseline_count)
+            continue;
+        double change = 100.0 * (results[n].ns_per_op / baseline[m].ns_per_op - 1);
+        if (change > threshold) {
+            fprintf(stderr, "REGRESSION %s: %.3f -> %.3f ns/op (%+.1f %%)\n",
+                results[n].name, baseline[m].ns_per_op, results[n].ns_per_op, change);
+            regressions++;
+        }
+    }
+    if (compare)
+        fprintf(stderr, "%u regression(s) above %.1f %% against '%s'\n", regressions, threshold, compare);
+    return regressions ? 2 : 0;
+}
+
+
+
+// End of source file 'mmbench.c'
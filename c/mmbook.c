@@ -0,0 +1,284 @@
+/*!mmbook.c
+ * Memory-mapped opening book of the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mastermind.h"
+#include "mmbook.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__usingwindows__)
+    #include <Windows.h>
+#elif defined(__usinglinux__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// state of an opened book
+struct mmbook {
+    const void *data; // the mapped file
+    size_t size;
+    const struct mmbookheader *header;
+    const struct mmbookentry *entries;
+    const struct mmbooknode *nodes;
+    #if defined(__usingwindows__)
+    HANDLE file, mapping;
+    #endif
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// maps the whole file read-only, returns false if it cannot be read
+static bool nex_book_map(struct mmbook *book, const char *path) {
+    #if defined(__usingwindows__)
+    LARGE_INTEGER size;
+    book->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (book->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(book->file, &size) || size.QuadPart == 0)
+        return false;
+    book->size = (size_t)size.QuadPart;
+    book->mapping = CreateFileMappingA(book->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!book->mapping)
+        return false;
+    book->data = MapViewOfFile(book->mapping, FILE_MAP_READ, 0, 0, 0);
+    return book->data != NULL;
+    #else
+    struct stat info;
+    void *data;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED)
+        return false;
+    book->data = data;
+    book->size = (size_t)info.st_size;
+    return true;
+    #endif
+}
+// checks that the book is complete and was generated by this solver
+static bool nex_book_valid(const struct mmbook *book) {
+    const struct mmbookheader *header = book->data;
+    if (book->size < sizeof(struct mmbookheader) || memcmp(header->magic, MMBOOK_MAGIC, 8) != 0 ||
+        header->version != MMBOOK_VERSION || header->revision != MMSOLVER_REVISION ||
+        header->node_count == 0)
+        return false;
+    return book->size == sizeof(struct mmbookheader) +
+        (uint64_t)header->entry_count * sizeof(struct mmbookentry) +
+        (uint64_t)header->node_count * sizeof(struct mmbooknode);
+}
+// checks if an entry holds the tree of prefs
+static bool nex_book_matches(const struct mmbookentry *entry, const MASTERMIND_PREFERENCES *prefs) {
+    return entry->code_length == prefs->code_length && entry->color_count == prefs->color_count &&
+        entry->attempt_count == prefs->attempt_count && entry->multiple_colors == prefs->multiple_colors &&
+        entry->hints_position_based == prefs->hints_position_based;
+}
+// copies the subtree of node src of book into node dst of writer
+static bool nex_book_copy(struct mmbookwriter *writer, const struct mmbook *book, unsigned int classes,
+    uint32_t src, uint32_t dst) {
+    uint32_t children = book->nodes[src].children, copies, n;
+    writer->nodes[dst].guess = book->nodes[src].guess;
+    // children always follow their parent, which rules out cycles in damaged books
+    if (!children || children <= src || (uint64_t)children + classes > book->header->node_count)
+        return true;
+    if (!(copies = mmbook_writer_nodes(writer, classes)))
+        return false;
+    writer->nodes[dst].children = copies;
+    for (n = 0; n < classes; n++) {
+        if (!nex_book_copy(writer, book, classes, children + n, copies + n))
+            return false;
+    }
+    return true;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+MASTERMIND_BOOK *mastermind_book_open(const char *path) {
+    struct mmbook *book = calloc(1, sizeof(struct mmbook));
+    if (!book)
+        return NULL;
+    #if defined(__usingwindows__)
+    book->file = INVALID_HANDLE_VALUE;
+    #endif
+    if (!nex_book_map(book, path) || !nex_book_valid(book)) {
+        mastermind_book_close(book);
+        return NULL;
+    }
+    book->header = book->data;
+    book->entries = (const struct mmbookentry *)(book->header + 1);
+    book->nodes = (const struct mmbooknode *)(book->entries + book->header->entry_count);
+    return book;
+}
+
+uint32_t mastermind_book_root(const MASTERMIND_BOOK *book, const MASTERMIND_PREFERENCES *prefs) {
+    uint32_t n;
+    if (!book)
+        return 0;
+    for (n = 0; n < book->header->entry_count; n++) {
+        const struct mmbookentry *entry = &book->entries[n];
+        if (nex_book_matches(entry, prefs))
+            return entry->root < book->header->node_count ? entry->root : 0;
+    }
+    return 0;
+}
+
+MMCODE mastermind_book_guess(const MASTERMIND_BOOK *book, uint32_t node) {
+    return node ? book->nodes[node].guess : MMBOOK_NO_GUESS;
+}
+
+uint32_t mastermind_book_child(const MASTERMIND_BOOK *book, uint32_t node, unsigned int index) {
+    uint64_t child;
+    if (!node || !book->nodes[node].children)
+        return 0;
+    child = (uint64_t)book->nodes[node].children + index;
+    return child < book->header->node_count ? (uint32_t)child : 0;
+}
+
+void mastermind_book_close(MASTERMIND_BOOK *book) {
+    if (!book)
+        return;
+    #if defined(__usingwindows__)
+    if (book->data)
+        UnmapViewOfFile(book->data);
+    if (book->mapping)
+        CloseHandle(book->mapping);
+    if (book->file != INVALID_HANDLE_VALUE)
+        CloseHandle(book->file);
+    #else
+    if (book->data)
+        munmap((void *)book->data, book->size);
+    #endif
+    free(book);
+}
+
+uint32_t mmbook_writer_nodes(struct mmbookwriter *writer, uint32_t count) {
+    uint32_t rt, n; // rt means return value
+    if (!writer->node_count) // node 0 means "no node"
+        count++;
+    if ((uint64_t)writer->node_count + count > UINT32_MAX)
+        return 0;
+    if (writer->node_count + count > writer->node_capacity) {
+        uint64_t capacity = writer->node_capacity ? writer->node_capacity : 1024;
+        struct mmbooknode *nodes;
+        while (capacity < writer->node_count + count)
+            capacity *= 2;
+        if (capacity > UINT32_MAX)
+            capacity = UINT32_MAX;
+        if (!(nodes = realloc(writer->nodes, capacity * sizeof(struct mmbooknode))))
+            return 0;
+        writer->nodes = nodes;
+        writer->node_capacity = (uint32_t)capacity;
+    }
+    for (n = 0; n < count; n++) {
+        writer->nodes[writer->node_count + n].guess = MMBOOK_NO_GUESS;
+        writer->nodes[writer->node_count + n].children = 0;
+    }
+    rt = writer->node_count ? writer->node_count : 1;
+    writer->node_count += count;
+    return rt;
+}
+
+struct mmbookentry *mmbook_writer_entry(struct mmbookwriter *writer, const MASTERMIND_PREFERENCES *prefs, unsigned int depth) {
+    struct mmbookentry *rt; // rt means return value
+    if (writer->entry_count == writer->entry_capacity) {
+        uint32_t capacity = writer->entry_capacity ? 2 * writer->entry_capacity : 64;
+        struct mmbookentry *entries = realloc(writer->entries, capacity * sizeof(struct mmbookentry));
+        if (!entries)
+            return NULL;
+        writer->entries = entries;
+        writer->entry_capacity = capacity;
+    }
+    rt = &writer->entries[writer->entry_count++];
+    memset(rt, 0, sizeof(struct mmbookentry));
+    rt->code_length = prefs->code_length;
+    rt->color_count = prefs->color_count;
+    rt->attempt_count = prefs->attempt_count;
+    rt->multiple_colors = prefs->multiple_colors;
+    rt->hints_position_based = prefs->hints_position_based;
+    rt->depth = depth;
+    return rt;
+}
+
+bool mmbook_writer_import(struct mmbookwriter *writer, const MASTERMIND_BOOK *book, const MASTERMIND_PREFERENCES *skip) {
+    // copied[n] = root of entry n in writer, so trees shared by several entries stay shared
+    uint32_t *copied = calloc(book->header->entry_count + 1, sizeof(uint32_t)), n, m;
+    bool rt = copied != NULL; // rt means return value
+    for (n = 0; rt && n < book->header->entry_count; n++) {
+        const struct mmbookentry *src = &book->entries[n];
+        MASTERMIND_PREFERENCES prefs = { src->code_length, src->color_count, src->attempt_count,
+            src->multiple_colors, src->hints_position_based };
+        struct mmbookentry *dst;
+        if (!mastermind_prefs_valid(&prefs) || (skip && nex_book_matches(src, skip)) ||
+            !src->root || src->root >= book->header->node_count)
+            continue;
+        if (!(dst = mmbook_writer_entry(writer, &prefs, src->depth))) {
+            rt = false;
+            break;
+        }
+        for (m = 0; m < n && !(copied[m] && book->entries[m].root == src->root); m++);
+        if (m < n)
+            dst->root = copied[m];
+        else if (!(dst->root = mmbook_writer_nodes(writer, 1)) ||
+            !nex_book_copy(writer, book, mastermind_feedback_classes(&prefs), src->root, dst->root))
+            rt = false;
+        copied[n] = dst->root;
+    }
+    free(copied);
+    return rt;
+}
+
+bool mmbook_writer_save(const struct mmbookwriter *writer, const char *path) {
+    struct mmbookheader header;
+    char temp[1024];
+    FILE *file;
+    bool ok;
+    if (!writer->node_count)
+        return false;
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    if (!(file = fopen(temp, "wb")))
+        return false;
+    memcpy(header.magic, MMBOOK_MAGIC, 8);
+    header.version = MMBOOK_VERSION;
+    header.revision = MMSOLVER_REVISION;
+    header.entry_count = writer->entry_count;
+    header.node_count = writer->node_count;
+    ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(writer->entries, sizeof(struct mmbookentry), writer->entry_count, file) == writer->entry_count &&
+        fwrite(writer->nodes, sizeof(struct mmbooknode), writer->node_count, file) == writer->node_count;
+    ok = fclose(file) == 0 && ok;
+    if (ok && rename(temp, path) != 0) { // Windows does not replace existing files
+        remove(path);
+        ok = rename(temp, path) == 0;
+    }
+    if (!ok)
+        remove(temp);
+    return ok;
+}
+
+void mmbook_writer_free(struct mmbookwriter *writer) {
+    free(writer->nodes);
+    free(writer->entries);
+    memset(writer, 0, sizeof(struct mmbookwriter));
+}
+
+
+
+// End of source file 'mmbook.c'
@@ -0,0 +1,75 @@
+/*!mmbook.h
+ * File format of the opening book of the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * A book holds one decision tree per preference tuple. It is written by
+ * mmbookgen or mmoptimal and mapped read-only by the game, all references
+ * are node indices (no pointers), so the file works at any address. Layout
+ * (little endian): header, header.entry_count entries, header.node_count nodes.
+ * Node 0 is an empty node, a reference to it means "no node".
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMBOOK_H
+#define MMBOOK_H
+
+#include "mastermind.h"
+
+// first bytes of every book
+#define MMBOOK_MAGIC "MMBOOK\r\n"
+// version of the file format
+#define MMBOOK_VERSION 2
+
+// start of the file
+struct mmbookheader {
+    char magic[8]; // MMBOOK_MAGIC
+    uint32_t version; // MMBOOK_VERSION
+    uint32_t revision; // MMSOLVER_REVISION of the solver which generated the book
+    uint32_t entry_count,
+        node_count;
+};
+
+// one decision tree, found by its preference tuple
+struct mmbookentry {
+    uint8_t code_length,
+        color_count,
+        attempt_count,
+        multiple_colors,
+        hints_position_based,
+        depth, // number of guesses stored in the tree
+        reserved[2];
+    uint32_t root; // node of the first guess
+};
+
+// one game state: the guess for it and where the states after its feedbacks are
+struct mmbooknode {
+    uint32_t guess; // MMCODE (of enumerable preferences, so it fits), MMBOOK_NO_GUESS if there is none
+    uint32_t children; // first of mastermind_feedback_classes() nodes, indexed by feedback index, 0 = none
+};
+
+// book under construction, used by the generator tools
+struct mmbookwriter {
+    struct mmbooknode *nodes; // node 0 is reserved by the first mmbook_writer_nodes() call
+    uint32_t node_count,
+        node_capacity;
+    struct mmbookentry *entries;
+    uint32_t entry_count,
+        entry_capacity;
+};
+
+// appends count empty nodes, returns the index of the first or 0 if out of memory
+uint32_t mmbook_writer_nodes(struct mmbookwriter *writer, uint32_t count);
+// appends an entry for prefs without a tree (root 0), returns NULL if out of memory
+struct mmbookentry *mmbook_writer_entry(struct mmbookwriter *writer, const MASTERMIND_PREFERENCES *prefs, unsigned int depth);
+// copies all trees of book except the one of skip (may be NULL), returns false if out of memory
+bool mmbook_writer_import(struct mmbookwriter *writer, const MASTERMIND_BOOK *book, const MASTERMIND_PREFERENCES *skip);
+// writes the book to a temporary file which replaces path when complete
+bool mmbook_writer_save(const struct mmbookwriter *writer, const char *path);
+// frees nodes and entries
+void mmbook_writer_free(struct mmbookwriter *writer);
+
+// end of MMBOOK_H include guard
+#endif
@@ -0,0 +1,181 @@
+/*!mmbookgen.c
+ * Generator of the opening book of the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Plays the first --depth guesses of the COMSOLVER for every reachable
+ * feedback sequence of every valid preference tuple and writes the
+ * resulting decision trees as one book (see mmbook.h).
+ */
+
+#include "mastermind.h"
+#include "mmbook.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// state of one tree
+struct mmbooktree {
+    MASTERMIND_PREFERENCES prefs;
+    MASTERMIND_SOLVER *solver;
+    MASTERMIND_CANDIDATES *candidates; // replayed next to the solver to find the reachable feedbacks
+    uint32_t *histogram; // codes per feedback index
+    unsigned int depth;
+    MMCODE guesses[MMPREFS_MAX_ATTEMPT_COUNT];
+    MMFEEDBACK feedbacks[MMPREFS_MAX_ATTEMPT_COUNT];
+};
+
+// prints the command line options
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --output FILE             book to write (default: " MMBOOK_DEFAULT_PATH ")\n"
+        "  --depth N                 guesses stored per game (default: 2)\n"
+        "  --code-length N           only generate trees for this code length\n"
+        "  --color-count N           only generate trees for this color count\n"
+        "  --threads N               threads of the COMSOLVER (0 = all cores)\n", name);
+    return 1;
+}
+
+// brings solver and candidates to the state after the first attempt feedbacks
+static void tree_replay(struct mmbooktree *tree, unsigned int attempt) {
+    unsigned int n;
+    mastermind_solver_reset(tree->solver);
+    mastermind_candidates_reset(tree->candidates);
+    for (n = 0; n < attempt; n++) {
+        mastermind_solver_feedback(tree->solver, tree->guesses[n], tree->feedbacks[n]);
+        mastermind_candidates_prune(tree->candidates, tree->guesses[n], tree->feedbacks[n]);
+    }
+}
+
+// fills node with the guess after the first attempt feedbacks and its subtrees, returns false if out of memory
+static bool tree_fill(struct mmbookwriter *writer, struct mmbooktree *tree, uint32_t node, unsigned int attempt) {
+    const MASTERMIND_PREFERENCES *prefs = &tree->prefs;
+    unsigned int n, classes = mastermind_feedback_classes(prefs);
+    unsigned int solved = mastermind_feedback_index(prefs, prefs->hints_position_based ?
+        MMFEEDBACK_MAKE((1u << prefs->code_length) - 1, 0) : MMFEEDBACK_MAKE(prefs->code_length, 0));
+    uint32_t rank, children;
+    MMCODE guess;
+    tree_replay(tree, attempt);
+    guess = mastermind_solver_guess(tree->solver);
+    writer->nodes[node].guess = (uint32_t)guess;
+    if (attempt + 1 >= tree->depth || attempt + 1 >= prefs->attempt_count)
+        return true;
+    // only feedbacks some candidate gives get a subtree
+    memset(tree->histogram, 0, classes * sizeof(uint32_t));
+    for (rank = mastermind_candidates_next(tree->candidates, 0); rank != UINT32_MAX;
+        rank = mastermind_candidates_next(tree->candidates, rank + 1))
+        tree->histogram[mastermind_feedback_index(prefs,
+            mastermind_score(prefs, guess, mastermind_code_unrank(prefs, rank)))]++;
+    if (!(children = mmbook_writer_nodes(writer, classes)))
+        return false;
+    writer->nodes[node].children = children;
+    tree->guesses[attempt] = guess;
+    for (n = 0; n < classes; n++) {
+        if (n == solved || !tree->histogram[n])
+            continue;
+        tree->feedbacks[attempt] = mastermind_feedback_from_index(prefs, n);
+        if (!tree_fill(writer, tree, children + n, attempt + 1))
+            return false;
+    }
+    return true;
+}
+
+// generates the tree of one preference tuple, returns its root or 0 on failure
+static uint32_t tree_generate(struct mmbookwriter *writer, const MASTERMIND_PREFERENCES *prefs, unsigned int depth) {
+    struct mmbooktree tree;
+    MASTERMIND_SCORETABLE *table = mastermind_scoretable_create(prefs);
+    uint32_t rt = 0; // rt means return value
+    memset(&tree, 0, sizeof(tree));
+    tree.prefs = *prefs;
+    tree.depth = depth;
+    tree.solver = table ? mastermind_solver_create(prefs, table) : NULL;
+    tree.candidates = mastermind_candidates_create(prefs);
+    tree.histogram = malloc(mastermind_feedback_classes(prefs) * sizeof(uint32_t));
+    if (tree.solver && tree.candidates && tree.histogram && (rt = mmbook_writer_nodes(writer, 1)) &&
+        !tree_fill(writer, &tree, rt, 0))
+        rt = 0;
+    free(tree.histogram);
+    mastermind_candidates_destroy(tree.candidates);
+    mastermind_solver_destroy(tree.solver);
+    mastermind_scoretable_destroy(table);
+    return rt;
+}
+
+int main(int argc, char *argv[]) {
+    struct mmbookwriter writer = { NULL, 0, 0, NULL, 0, 0 };
+    const char *output = MMBOOK_DEFAULT_PATH;
+    unsigned int depth = 2, only_length = 0, only_colors = 0, threads = 0;
+    unsigned int length, colors, attempts, multiple, positional;
+    double start = mmtime_now();
+    int n;
+    for (n = 1; n < argc; n++) {
+        if (n + 1 == argc)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--output") == 0)
+            output = argv[++n];
+        else if (strcmp(argv[n], "--depth") == 0)
+            depth = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--code-length") == 0)
+            only_length = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--color-count") == 0)
+            only_colors = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--threads") == 0)
+            threads = atoi(argv[++n]);
+        else
+            return usage(argv[0]);
+    }
+    if (depth < 1 || depth > MMPREFS_MAX_ATTEMPT_COUNT)
+        return usage(argv[0]);
+    for (length = MMPREFS_MIN_CODE_LENGTH; length <= MMPREFS_MAX_CODE_LENGTH; length++) {
+        for (colors = MMPREFS_MIN_COLOR_COUNT; colors <= MMPREFS_MAX_COLOR_COUNT; colors++) {
+            for (multiple = 0; multiple < 2; multiple++) {
+                for (positional = 0; positional < 2; positional++) {
+                    // with attempts >= depth + 3 the endgame rules of the solver never
+                    // apply within the book, so all of these share one tree
+                    uint32_t shared = 0;
+                    if ((only_length && length != only_length) || (only_colors && colors != only_colors))
+                        continue;
+                    for (attempts = MMPREFS_MIN_ATTEMPT_COUNT; attempts <= MMPREFS_MAX_ATTEMPT_COUNT; attempts++) {
+                        MASTERMIND_PREFERENCES prefs = { length, colors, attempts, multiple, positional };
+                        struct mmbookentry *entry;
+                        double tree_start = mmtime_now();
+                        uint32_t nodes = writer.node_count, root;
+                        prefs.thread_count = threads;
+                        if (!mastermind_prefs_valid(&prefs) || !mastermind_prefs_enumerable(&prefs))
+                            continue;
+                        if (attempts >= depth + 3 && shared)
+                            root = shared;
+                        else
+                            root = tree_generate(&writer, &prefs, depth);
+                        if (!root || !(entry = mmbook_writer_entry(&writer, &prefs, depth))) {
+                            fprintf(stderr, "%ux%u A%u M%u P%u: out of memory\n", length, colors, attempts, multiple, positional);
+                            return 1;
+                        }
+                        entry->root = root;
+                        if (attempts >= depth + 3)
+                            shared = root;
+                        if (writer.node_count != nodes)
+                            fprintf(stderr, "%ux%u A%u M%u P%u: %u nodes in %.2f s\n", length, colors, attempts,
+                                multiple, positional, writer.node_count - nodes, mmtime_now() - tree_start);
+                    }
+                }
+            }
+        }
+    }
+    if (!mmbook_writer_save(&writer, output)) {
+        fprintf(stderr, "cannot write '%s'\n", output);
+        return 1;
+    }
+    printf("%s: %u trees, %u nodes, %.1f KiB in %.1f s\n", output, writer.entry_count, writer.node_count,
+        (sizeof(struct mmbookheader) + writer.entry_count * sizeof(struct mmbookentry) +
+        writer.node_count * sizeof(struct mmbooknode)) / 1024.0, mmtime_now() - start);
+    mmbook_writer_free(&writer);
+    return 0;
+}
+
+
+
+// End of source file 'mmbookgen.c'
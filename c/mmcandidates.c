@@ -0,0 +1,310 @@
+/*!mmcandidates.c
+ * Set of candidate codes (codes which may still be the secret code) for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Every code is identified by its mixed-radix rank (see mastermind_code_rank()),
+ * the set is a bitset over all color_count ^ code_length ranks. 8 pegs with
+ * 8 colors need 16.7M bits = 2 MiB, independent of the number of candidates.
+ */
+
+#include "mastermind.h"
+#include "mmstats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__usingwindows__)
+    #include <intrin.h>
+#endif
+
+// state of a candidate set
+struct mmcandidates {
+    MASTERMIND_PREFERENCES prefs;
+    const MASTERMIND_SCORER *scorer; // kernels for prefs
+    uint32_t code_count, // color_count ^ code_length
+        word_count; // 64 bit words of bits
+    uint64_t *bits; // bit n set = code of rank n is a candidate
+    size_t count; // number of set bits
+    // unranking without a division per peg: rank = high * low_radix + low
+    uint32_t low_radix; // color_count ^ (code_length / 2)
+    MMCODE *low_codes, // code of the low digits, one per low value
+        *high_codes; // code of the high digits (already shifted), one per high value
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// counts the set bits of value
+static unsigned int nex_popcount64(uint64_t value) {
+    #if defined(__GNUC__)
+    return __builtin_popcountll(value);
+    #elif defined(__usingwindows__)
+    return (unsigned int)__popcnt64(value);
+    #else
+    unsigned int rt = 0; // rt means return value
+    for (; value; value &= value - 1)
+        rt++;
+    return rt;
+    #endif
+}
+// gets the index of the lowest set bit of value (value must not be 0)
+static unsigned int nex_ctz64(uint64_t value) {
+    #if defined(__GNUC__)
+    return __builtin_ctzll(value);
+    #elif defined(__usingwindows__)
+    unsigned long rt; // rt means return value
+    _BitScanForward64(&rt, value);
+    return rt;
+    #else
+    unsigned int rt = 0; // rt means return value
+    for (; !(value & 1); value >>= 1)
+        rt++;
+    return rt;
+    #endif
+}
+// gets the code of a rank with two table lookups
+static MMCODE nex_candidates_unrank(const struct mmcandidates *set, uint32_t rank) {
+    return set->low_codes[rank % set->low_radix] | set->high_codes[rank / set->low_radix];
+}
+// gets the codes of the set bits of a word and their offsets in it, returns their number
+static unsigned int nex_candidates_word(const struct mmcandidates *set, uint32_t word, uint64_t bits,
+    MMCODE *codes, unsigned char *offsets) {
+    uint32_t rank = word * 64, low = rank % set->low_radix, high = rank / set->low_radix;
+    unsigned int rt = 0; // rt means return value
+    for (; bits; bits &= bits - 1, rt++) {
+        unsigned int offset = nex_ctz64(bits);
+        offsets[rt] = offset;
+        if (set->low_radix < 64) // short codes: the high digits may change more than once within a word
+            codes[rt] = nex_candidates_unrank(set, rank + offset);
+        else if (low + offset < set->low_radix) // no division per code, at most one carry within a word
+            codes[rt] = set->low_codes[low + offset] | set->high_codes[high];
+        else
+            codes[rt] = set->low_codes[low + offset - set->low_radix] | set->high_codes[high + 1];
+    }
+    return rt;
+}
+// packs a feedback of at most 8 pegs (enumerable codes) into 16 bits
+static uint16_t nex_candidates_score16(MMFEEDBACK feedback) {
+    return (uint16_t)(MMFEEDBACK_BLACKS(feedback) | MMFEEDBACK_WHITES(feedback) << 8);
+}
+// sets the bits of all codes without repeated colors, pegs [peg, code_length) are still open
+static void nex_candidates_permute(struct mmcandidates *set, unsigned int peg, unsigned int used,
+    uint32_t rank, uint32_t weight) {
+    unsigned int color;
+    if (peg == set->prefs.code_length) {
+        set->bits[rank / 64] |= 1ull << (rank % 64);
+        return;
+    }
+    for (color = 0; color < set->prefs.color_count; color++) {
+        if (!(used >> color & 1))
+            nex_candidates_permute(set, peg + 1, used | 1u << color,
+                rank + color * weight, weight * set->prefs.color_count);
+    }
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+MASTERMIND_CANDIDATES *mastermind_candidates_create(const MASTERMIND_PREFERENCES *prefs) {
+    struct mmcandidates *set = calloc(1, sizeof(struct mmcandidates));
+    MASTERMIND_PREFERENCES low_prefs = *prefs, high_prefs = *prefs;
+    uint32_t n, high_radix;
+    if (!set)
+        return NULL;
+    set->prefs = *prefs;
+    set->scorer = mastermind_scorer(prefs);
+    set->code_count = mastermind_code_count(prefs);
+    set->word_count = (set->code_count + 63) / 64;
+    low_prefs.code_length = prefs->code_length / 2;
+    high_prefs.code_length = prefs->code_length - low_prefs.code_length;
+    set->low_radix = mastermind_code_count(&low_prefs);
+    high_radix = mastermind_code_count(&high_prefs);
+    set->bits = malloc(set->word_count * sizeof(uint64_t));
+    set->low_codes = malloc(set->low_radix * sizeof(MMCODE));
+    set->high_codes = malloc(high_radix * sizeof(MMCODE));
+    if (!set->bits || !set->low_codes || !set->high_codes) {
+        mastermind_candidates_destroy(set);
+        return NULL;
+    }
+    for (n = 0; n < set->low_radix; n++)
+        set->low_codes[n] = mastermind_code_unrank(&low_prefs, n);
+    for (n = 0; n < high_radix; n++)
+        set->high_codes[n] = mastermind_code_unrank(&high_prefs, n) << (MMCODE_PEG_BITS * low_prefs.code_length);
+    mastermind_candidates_reset(set);
+    return set;
+}
+
+void mastermind_candidates_reset(MASTERMIND_CANDIDATES *set) {
+    if (set->prefs.multiple_colors) { // every rank is a valid code
+        memset(set->bits, 0xFF, set->word_count * sizeof(uint64_t));
+        if (set->code_count % 64)
+            set->bits[set->word_count - 1] = (1ull << (set->code_count % 64)) - 1;
+        set->count = set->code_count;
+    }
+    else { // only the ranks of the permutations are set, no rank is tested
+        uint32_t n, count = 1;
+        memset(set->bits, 0, set->word_count * sizeof(uint64_t));
+        nex_candidates_permute(set, 0, 0, 0, 1);
+        for (n = 0; n < set->prefs.code_length; n++)
+            count *= set->prefs.color_count - n;
+        set->count = count;
+    }
+}
+
+size_t mastermind_candidates_prune(MASTERMIND_CANDIDATES *set, MMCODE guess, MMFEEDBACK feedback) {
+    MMCODE codes[64];
+    MMFEEDBACK scores[64];
+    unsigned char offsets[64];
+    uint32_t word;
+    size_t count = 0;
+    MMSTATS_START(timer);
+    // one streaming pass: score the candidates of a word at once and clear the inconsistent ones
+    for (word = 0; word < set->word_count; word++) {
+        uint64_t bits = set->bits[word];
+        unsigned int n, found;
+        if (!bits)
+            continue;
+        found = nex_candidates_word(set, word, bits, codes, offsets);
+        set->scorer->batch(&set->prefs, guess, codes, scores, found);
+        for (n = 0; n < found; n++) {
+            if (scores[n] != feedback)
+                bits &= ~(1ull << offsets[n]);
+        }
+        set->bits[word] = bits;
+        count += nex_popcount64(bits);
+    }
+    set->count = count;
+    MMSTATS_STOP(MMSTATS_PRUNE, timer);
+    return count;
+}
+
+size_t mastermind_candidates_score(const MASTERMIND_CANDIDATES *set, MMCODE guess, uint32_t begin, uint32_t end, uint16_t *scores) {
+    MMCODE codes[64];
+    MMFEEDBACK feedbacks[64];
+    unsigned char offsets[64];
+    uint32_t word;
+    size_t rt = 0; // rt means return value
+    for (word = begin / 64; word < set->word_count && word * 64 < end; word++) {
+        unsigned int n, found;
+        if (!set->bits[word])
+            continue;
+        found = nex_candidates_word(set, word, set->bits[word], codes, offsets);
+        set->scorer->batch(&set->prefs, guess, codes, feedbacks, found);
+        for (n = 0; n < found; n++)
+            scores[rt++] = nex_candidates_score16(feedbacks[n]);
+    }
+    return rt;
+}
+
+size_t mastermind_candidates_prune_scored(MASTERMIND_CANDIDATES *set, const uint16_t *scores, MMFEEDBACK feedback) {
+    uint16_t wanted = nex_candidates_score16(feedback);
+    uint32_t word;
+    size_t count = 0, n = 0;
+    MMSTATS_START(timer);
+    for (word = 0; word < set->word_count; word++) {
+        uint64_t bits = set->bits[word], rest;
+        for (rest = bits; rest; rest &= rest - 1) {
+            if (scores[n++] != wanted)
+                bits &= ~(rest & -rest); // lowest set bit of rest
+        }
+        set->bits[word] = bits;
+        count += nex_popcount64(bits);
+    }
+    set->count = count;
+    MMSTATS_STOP(MMSTATS_PRUNE, timer);
+    return count;
+}
+
+size_t mastermind_candidates_count(const MASTERMIND_CANDIDATES *set) {
+    return set->count;
+}
+
+bool mastermind_candidates_contains(const MASTERMIND_CANDIDATES *set, uint32_t rank) {
+    return rank < set->code_count && (set->bits[rank / 64] >> (rank % 64) & 1);
+}
+
+uint32_t mastermind_candidates_next(const MASTERMIND_CANDIDATES *set, uint32_t rank) {
+    uint32_t word = rank / 64;
+    uint64_t bits;
+    if (rank >= set->code_count)
+        return UINT32_MAX;
+    bits = set->bits[word] & (~0ull << (rank % 64));
+    while (!bits) {
+        if (++word == set->word_count)
+            return UINT32_MAX;
+        bits = set->bits[word];
+    }
+    return word * 64 + nex_ctz64(bits);
+}
+
+size_t mastermind_candidates_collect(const MASTERMIND_CANDIDATES *set, MMCODE *codes, uint32_t *ranks, size_t max) {
+    size_t count = set->count < max ? set->count : max, seen = 0, n = 0;
+    uint32_t word;
+    // candidate number n * set->count / count is collected, whole words are skipped by their popcount
+    for (word = 0; word < set->word_count && n < count; word++) {
+        uint64_t bits = set->bits[word];
+        size_t in_word = nex_popcount64(bits), target;
+        while (n < count && (target = (size_t)((uint64_t)n * set->count / count)) < seen + in_word) {
+            uint64_t rest = bits;
+            size_t skip;
+            for (skip = target - seen; skip; skip--)
+                rest &= rest - 1;
+            uint32_t rank = word * 64 + nex_ctz64(rest);
+            codes[n] = nex_candidates_unrank(set, rank);
+            if (ranks)
+                ranks[n] = rank;
+            n++;
+        }
+        seen += in_word;
+    }
+    return n;
+}
+
+uint64_t mastermind_candidates_hash(const MASTERMIND_CANDIDATES *set) {
+    uint64_t rt = 0; // rt means return value
+    uint32_t word;
+    // the key of a rank is computed, a table of them would be as big as 64 sets
+    for (word = 0; word < set->word_count; word++) {
+        uint64_t rest;
+        for (rest = set->bits[word]; rest; rest &= rest - 1)
+            rt ^= mastermind_mix64(word * 64 + nex_ctz64(rest));
+    }
+    return rt;
+}
+
+void mastermind_candidates_colors(const MASTERMIND_CANDIDATES *set, uint32_t *colors) {
+    MMCODE codes[64];
+    unsigned char offsets[64];
+    uint32_t all = (1u << set->prefs.color_count) - 1, word;
+    unsigned int n, m, complete = 0; // leading pegs which may have every color
+    memset(colors, 0, set->prefs.code_length * sizeof(uint32_t));
+    for (word = 0; word < set->word_count && complete < set->prefs.code_length; word++) {
+        unsigned int found = set->bits[word] ? nex_candidates_word(set, word, set->bits[word], codes, offsets) : 0;
+        for (m = 0; m < found; m++) {
+            for (n = 0; n < set->prefs.code_length; n++)
+                colors[n] |= 1u << (codes[m] >> MMCODE_PEG_BITS * n & MMCODE_PEG_MASK);
+        }
+        while (complete < set->prefs.code_length && colors[complete] == all)
+            complete++;
+    }
+}
+
+void mastermind_candidates_destroy(MASTERMIND_CANDIDATES *set) {
+    if (!set)
+        return;
+    free(set->bits);
+    free(set->low_codes);
+    free(set->high_codes);
+    free(set);
+}
+
+
+
+// End of source file 'mmcandidates.c'
@@ -0,0 +1,232 @@
+/*!mmclient.c
+ * Load test client of the game server for game MasterMind (Linux).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Opens --connections sessions at once on mmserver and plays games with
+ * random guesses on all of them (one request in flight per session) until
+ * --requests responses arrived, then prints the throughput and the latency
+ * percentiles of the requests.
+ */
+
+#include "mastermind.h"
+#include "mmthread.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// longest response line
+#define MMCLIENT_LINE 64
+// events handled per epoll_wait() call
+#define MMCLIENT_EVENTS 256
+
+// one session on the server
+struct mmclientsession {
+    int fd;
+    double sent; // time stamp of the request in flight
+    size_t used;
+    char input[MMCLIENT_LINE];
+};
+
+// state of the load test
+struct mmclient {
+    MASTERMIND_PREFERENCES prefs;
+    MASTERMIND_RANDOM random;
+    uint64_t requests, // to send
+        sent,
+        received,
+        errors;
+    float *latencies; // seconds of every request
+};
+
+// prints the command line options
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --socket PATH             Unix domain socket of the server (default: mastermind.sock)\n"
+        "  --port N                  connect to TCP port N of 127.0.0.1 instead\n"
+        "  --connections N           concurrent sessions (default: 1000)\n"
+        "  --requests N              requests to send in total (default: 1000000)\n"
+        "  --code-length N           preferences of the games (default: 4 6 12 1 1)\n"
+        "  --color-count N\n"
+        "  --attempt-count N\n"
+        "  --multiple-colors 0|1\n"
+        "  --hints-position-based 0|1\n", name);
+    return 1;
+}
+
+// connects to the server, returns -1 on failure
+static int client_connect(const char *path, int port) {
+    int fd, one = 1;
+    if (port) {
+        struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port) };
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+            return -1;
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    else {
+        struct sockaddr_un address = { .sun_family = AF_UNIX };
+        if (strlen(path) >= sizeof(address.sun_path) || (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+            return -1;
+        strcpy(address.sun_path, path);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+// sends the next request of a session: a random guess or a new game after "ok"/"won"/"lost"
+static void client_send(struct mmclient *client, struct mmclientsession *session, const char *response) {
+    char line[MMCLIENT_LINE];
+    int length;
+    if (!response || strncmp(response, "won", 3) == 0 || strncmp(response, "lost", 4) == 0)
+        length = snprintf(line, sizeof(line), "new %u %u %u %d %d\n", client->prefs.code_length,
+            client->prefs.color_count, client->prefs.attempt_count, client->prefs.multiple_colors,
+            client->prefs.hints_position_based);
+    else {
+        memcpy(line, "guess ", 6);
+        mastermind_code_unpack(&client->prefs, mastermind_random_code(&client->prefs, &client->random), line + 6);
+        line[6 + client->prefs.code_length] = '\n';
+        length = 7 + client->prefs.code_length;
+    }
+    session->sent = mmtime_now();
+    if (send(session->fd, line, length, MSG_NOSIGNAL) != length)
+        client->errors++; // a request line always fits into an empty socket
+    client->sent++;
+}
+
+// reads the responses of a session, returns false if the connection is broken
+static bool client_receive(struct mmclient *client, struct mmclientsession *session) {
+    ssize_t received = recv(session->fd, session->input + session->used, MMCLIENT_LINE - 1 - session->used, 0);
+    char *end;
+    if (received <= 0)
+        return received < 0 && (errno == EAGAIN || errno == EINTR);
+    session->used += received;
+    session->input[session->used] = '\0';
+    if (!(end = strchr(session->input, '\n')))
+        return session->used < MMCLIENT_LINE - 1;
+    *end = '\0';
+    client->latencies[client->received++] = (float)(mmtime_now() - session->sent);
+    if (strncmp(session->input, "error", 5) == 0)
+        client->errors++;
+    if (client->sent < client->requests)
+        client_send(client, session, session->input);
+    session->used = 0; // one request in flight, so nothing follows the line
+    return true;
+}
+
+// sorts latencies
+static int client_compare(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[]) {
+    struct mmclient client = { { 4, 6, MMPREFS_MAX_ATTEMPT_COUNT, true, true } };
+    struct mmclientsession *sessions;
+    struct epoll_event events[MMCLIENT_EVENTS];
+    const char *path = "mastermind.sock";
+    unsigned int connections = 1000, n;
+    int port = 0, epoll;
+    double start, seconds;
+    struct rlimit limit;
+    client.requests = 1000000;
+    for (n = 1; n < (unsigned int)argc; n++) {
+        const char *value = n + 1 < (unsigned int)argc ? argv[n + 1] : NULL;
+        if (!value)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--socket") == 0)
+            path = value;
+        else if (strcmp(argv[n], "--port") == 0)
+            port = atoi(value);
+        else if (strcmp(argv[n], "--connections") == 0)
+            connections = atoi(value);
+        else if (strcmp(argv[n], "--requests") == 0)
+            client.requests = strtoull(value, NULL, 10);
+        else if (strcmp(argv[n], "--code-length") == 0)
+            client.prefs.code_length = atoi(value);
+        else if (strcmp(argv[n], "--color-count") == 0)
+            client.prefs.color_count = atoi(value);
+        else if (strcmp(argv[n], "--attempt-count") == 0)
+            client.prefs.attempt_count = atoi(value);
+        else if (strcmp(argv[n], "--multiple-colors") == 0)
+            client.prefs.multiple_colors = atoi(value) != 0;
+        else if (strcmp(argv[n], "--hints-position-based") == 0)
+            client.prefs.hints_position_based = atoi(value) != 0;
+        else
+            return usage(argv[0]);
+        n++;
+    }
+    if (!mastermind_prefs_valid(&client.prefs) || !connections || client.requests < connections) {
+        fprintf(stderr, "invalid preferences, or fewer requests than connections\n");
+        return 1;
+    }
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    mastermind_random_seed(&client.random, 1);
+    sessions = calloc(connections, sizeof(struct mmclientsession));
+    client.latencies = malloc(client.requests * sizeof(float));
+    if (!sessions || !client.latencies || (epoll = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (n = 0; n < connections; n++) {
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = &sessions[n] };
+        if ((sessions[n].fd = client_connect(path, port)) < 0 ||
+            epoll_ctl(epoll, EPOLL_CTL_ADD, sessions[n].fd, &event) != 0) {
+            fprintf(stderr, "cannot open connection %u: %s\n", n + 1, strerror(errno));
+            return 1;
+        }
+    }
+    start = mmtime_now();
+    for (n = 0; n < connections; n++)
+        client_send(&client, &sessions[n], NULL);
+    while (client.received < client.sent) {
+        int count = epoll_wait(epoll, events, MMCLIENT_EVENTS, 5000), m;
+        if (count <= 0) {
+            fprintf(stderr, "the server stopped answering\n");
+            return 1;
+        }
+        for (m = 0; m < count; m++) {
+            if (!client_receive(&client, events[m].data.ptr)) {
+                fprintf(stderr, "the server closed a connection\n");
+                return 1;
+            }
+        }
+    }
+    seconds = mmtime_now() - start;
+    qsort(client.latencies, client.received, sizeof(float), client_compare);
+    printf("connections:  %u\n", connections);
+    printf("requests:     %llu in %.3f s, %llu errors\n", (unsigned long long)client.received, seconds,
+        (unsigned long long)client.errors);
+    printf("requests/s:   %.0f\n", client.received / seconds);
+    printf("latency (us): p50 %.1f, p99 %.1f, max %.1f\n", 1e6 * client.latencies[client.received / 2],
+        1e6 * client.latencies[client.received * 99 / 100], 1e6 * client.latencies[client.received - 1]);
+    for (n = 0; n < connections; n++)
+        close(sessions[n].fd);
+    free(sessions);
+    free(client.latencies);
+    return client.errors ? 2 : 0;
+}
+
+
+
+// End of source file 'mmclient.c'
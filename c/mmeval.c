@@ -0,0 +1,418 @@
+/*!mmeval.c
+ * Exhaustive evaluation of the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Plays the COMSOLVER against every secret code of the preferences at once:
+ * a game state (the guesses and feedbacks so far) is only solved once for
+ * all secret codes which lead to it. The guess of a state splits its codes
+ * by feedback into consecutive parts of the same array, every part is a
+ * new state. A worker goes on with the first part on its own solver and
+ * leaves the others to idle workers, which replay the feedbacks of the
+ * state on their solver first. This works because the guesses only depend
+ * on the guesses and feedbacks so far (not for the genetic search, whose
+ * population is kept from one guess to the next).
+ */
+
+#include "mastermind.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// number of lost secret codes which are printed
+#define MMEVAL_EXAMPLES 8
+
+// a game state and its secret codes eval->secrets[begin, begin + count)
+struct mmevaltask {
+    size_t begin,
+        count;
+    unsigned int attempt; // number of guesses so far
+    MMCODE guesses[MMPREFS_MAX_ATTEMPT_COUNT];
+    MMFEEDBACK feedbacks[MMPREFS_MAX_ATTEMPT_COUNT];
+};
+
+// results of one worker, added to the totals when it is done
+struct mmevalresult {
+    uint64_t guesses[MMPREFS_MAX_ATTEMPT_COUNT + 1], // guesses[n] = secret codes solved with n guesses
+        failed, // secret codes not solved within attempt_count
+        states, // guesses computed by the solver
+        moves; // guesses of all games (a state counts once per secret code)
+    double seconds, // time of all computed guesses
+        weighted, // time of the guesses of all games
+        slowest; // time of the slowest guess
+    MMCODE examples[MMEVAL_EXAMPLES]; // some lost secret codes
+    unsigned int example_count;
+};
+
+// state of the evaluation
+struct mmeval {
+    MASTERMIND_PREFERENCES prefs; // solver prefs (single-threaded)
+    const MASTERMIND_SCORETABLE *table;
+    MMCODE *secrets; // every valid code, reordered into the parts of the states
+    size_t secret_count;
+    unsigned int classes;
+    MMMUTEX lock; // protects everything below
+    MMCOND wake; // signals new tasks or the end
+    struct mmevaltask *tasks; // states left to a free worker
+    size_t task_count,
+        task_capacity;
+    unsigned int busy; // workers working on a state, the end is reached when 0 and no tasks
+    bool failed; // out of memory
+    struct mmevalresult total;
+};
+
+// working memory of one worker
+struct mmevalworker {
+    struct mmeval *eval;
+    MASTERMIND_SOLVER *solver;
+    MMFEEDBACK *scores; // feedbacks of the secret codes of a state
+    MMCODE *sorted; // the secret codes of a state ordered by feedback
+    uint32_t *offsets; // first code of every feedback in sorted
+    struct mmevalresult result;
+};
+
+// prints the command line options
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --code-length N           preferences of the game (default: 4 pegs, 6 colors,\n"
+        "  --color-count N           7 attempts, no multiple colors, position based hints)\n"
+        "  --attempt-count N\n"
+        "  --multiple-colors 0|1\n"
+        "  --hints-position-based 0|1\n"
+        "  --strategy NAME           guesses of the COMSOLVER: minimax (default), entropy or propagate\n"
+        "  --consistent-only 0|1     the COMSOLVER only guesses codes which may be the secret code\n"
+        "  --threads N               threads (0 = all cores, default)\n"
+        "  --book FILE               opening book of the COMSOLVER (default: " MMBOOK_DEFAULT_PATH ")\n"
+        "  --json                    print JSON instead of text\n", name);
+    return 1;
+}
+
+// writes a code as letters ('a' = color 0) into out (code_length + 1 chars)
+static void eval_code_string(const MASTERMIND_PREFERENCES *prefs, MMCODE code, char *out) {
+    unsigned int n;
+    for (n = 0; n < prefs->code_length; n++, code >>= MMCODE_PEG_BITS)
+        out[n] = (char)('a' + (code & MMCODE_PEG_MASK));
+    out[n] = '\0';
+}
+
+// hands a state to the free workers
+static void eval_push(struct mmeval *eval, const struct mmevaltask *task) {
+    mmmutex_lock(&eval->lock);
+    if (eval->task_count == eval->task_capacity) {
+        size_t capacity = eval->task_capacity ? 2 * eval->task_capacity : 256;
+        struct mmevaltask *tasks = realloc(eval->tasks, capacity * sizeof(struct mmevaltask));
+        if (!tasks) {
+            eval->failed = true;
+            mmmutex_unlock(&eval->lock);
+            return;
+        }
+        eval->tasks = tasks;
+        eval->task_capacity = capacity;
+    }
+    eval->tasks[eval->task_count++] = *task;
+    mmcond_broadcast(&eval->wake);
+    mmmutex_unlock(&eval->lock);
+}
+
+// plays a state and, on the same solver, always the first of the states after it
+static void eval_state(struct mmevalworker *worker, struct mmevaltask task) {
+    struct mmeval *eval = worker->eval;
+    const MASTERMIND_PREFERENCES *prefs = &eval->prefs;
+    struct mmevalresult *result = &worker->result;
+    unsigned int n;
+    // the solver of this worker was used for another state: replay the feedbacks of this one
+    mastermind_solver_reset(worker->solver);
+    for (n = 0; n < task.attempt; n++)
+        mastermind_solver_feedback(worker->solver, task.guesses[n], task.feedbacks[n]);
+    while (1) {
+        MMCODE *secrets = eval->secrets + task.begin, guess;
+        struct mmevaltask next, state = task; // task becomes the first state after this one
+        double start = mmtime_now(), seconds;
+        size_t m;
+        bool first = true;
+        guess = mastermind_solver_guess(worker->solver);
+        seconds = mmtime_now() - start;
+        result->states++;
+        result->moves += task.count;
+        result->seconds += seconds;
+        result->weighted += seconds * task.count;
+        if (seconds > result->slowest)
+            result->slowest = seconds;
+        // order the secret codes by feedback, every feedback is a state of its own
+        mastermind_score_batch(prefs, guess, secrets, worker->scores, task.count);
+        memset(worker->offsets, 0, (eval->classes + 1) * sizeof(uint32_t));
+        for (m = 0; m < task.count; m++)
+            worker->offsets[mastermind_feedback_index(prefs, worker->scores[m]) + 1]++;
+        for (n = 0; n < eval->classes; n++)
+            worker->offsets[n + 1] += worker->offsets[n];
+        for (m = 0; m < task.count; m++)
+            worker->sorted[worker->offsets[mastermind_feedback_index(prefs, worker->scores[m])]++] = secrets[m];
+        memcpy(secrets, worker->sorted, task.count * sizeof(MMCODE));
+        // offsets[n] is the end of the codes of feedback n now
+        next = task;
+        next.guesses[state.attempt] = guess;
+        next.attempt = state.attempt + 1;
+        for (n = 0, m = 0; n < eval->classes; m = worker->offsets[n++]) {
+            size_t count = worker->offsets[n] - m;
+            if (!count)
+                continue;
+            if (count == 1 && secrets[m] == guess) { // solved
+                result->guesses[next.attempt]++;
+                continue;
+            }
+            if (next.attempt >= prefs->attempt_count) { // lost
+                for (; count && result->example_count < MMEVAL_EXAMPLES; count--)
+                    result->examples[result->example_count++] = secrets[m + count - 1];
+                result->failed += worker->offsets[n] - m;
+                continue;
+            }
+            next.begin = state.begin + m;
+            next.count = count;
+            next.feedbacks[state.attempt] = mastermind_score(prefs, guess, secrets[m]);
+            if (first) // kept for this worker
+                task = next;
+            else
+                eval_push(eval, &next);
+            first = false;
+        }
+        if (first) // no state after this one
+            return;
+        mastermind_solver_feedback(worker->solver, guess, task.feedbacks[state.attempt]);
+    }
+}
+
+// main function of the workers: takes states until there are no more
+static void eval_worker(void *arg) {
+    struct mmevalworker *worker = arg;
+    struct mmeval *eval = worker->eval;
+    unsigned int n;
+    mmmutex_lock(&eval->lock);
+    while (1) {
+        struct mmevaltask task;
+        while (!eval->task_count && eval->busy)
+            mmcond_wait(&eval->wake, &eval->lock);
+        if (!eval->task_count)
+            break;
+        task = eval->tasks[--eval->task_count];
+        eval->busy++;
+        mmmutex_unlock(&eval->lock);
+        eval_state(worker, task);
+        mmmutex_lock(&eval->lock);
+        if (!--eval->busy && !eval->task_count)
+            mmcond_broadcast(&eval->wake);
+    }
+    // add the results of this worker to the totals
+    for (n = 0; n <= MMPREFS_MAX_ATTEMPT_COUNT; n++)
+        eval->total.guesses[n] += worker->result.guesses[n];
+    eval->total.failed += worker->result.failed;
+    eval->total.states += worker->result.states;
+    eval->total.moves += worker->result.moves;
+    eval->total.seconds += worker->result.seconds;
+    eval->total.weighted += worker->result.weighted;
+    if (worker->result.slowest > eval->total.slowest)
+        eval->total.slowest = worker->result.slowest;
+    for (n = 0; n < worker->result.example_count && eval->total.example_count < MMEVAL_EXAMPLES; n++)
+        eval->total.examples[eval->total.example_count++] = worker->result.examples[n];
+    mmmutex_unlock(&eval->lock);
+}
+
+// prints the results as text
+static void eval_print(const struct mmeval *eval, unsigned int threads, double seconds) {
+    const MASTERMIND_PREFERENCES *prefs = &eval->prefs;
+    const struct mmevalresult *total = &eval->total;
+    uint64_t guesses = 0, solved = 0;
+    unsigned int n, worst = 0;
+    char code[MMPREFS_MAX_CODE_LENGTH + 1];
+    for (n = 1; n <= MMPREFS_MAX_ATTEMPT_COUNT; n++) {
+        guesses += n * total->guesses[n];
+        solved += total->guesses[n];
+        if (total->guesses[n])
+            worst = n;
+    }
+    printf("preferences:   %u pegs, %u colors, %u attempts, multiple colors %d, position based hints %d\n",
+        prefs->code_length, prefs->color_count, prefs->attempt_count,
+        prefs->multiple_colors, prefs->hints_position_based);
+    printf("strategy:      %s%s%s\n", mastermind_solver_name(prefs),
+        prefs->consistent_only ? ", consistent guesses only" : "", prefs->book ? ", opening book" : "");
+    printf("secret codes:  %llu on %u threads in %.3f s\n", (unsigned long long)eval->secret_count, threads, seconds);
+    printf("avg. guesses:  %.4f (solved codes)\n", solved ? (double)guesses / solved : 0.0);
+    printf("worst case:    %u guesses\n", worst);
+    printf("guesses:");
+    for (n = 1; n <= prefs->attempt_count; n++) {
+        if (total->guesses[n])
+            printf(" %u:%llu", n, (unsigned long long)total->guesses[n]);
+    }
+    printf(" lost:%llu\n", (unsigned long long)total->failed);
+    printf("guess time:    %.1f us per move (%llu moves), %.1f us per state (%llu states), max %.1f us\n",
+        total->moves ? 1e6 * total->weighted / total->moves : 0.0, (unsigned long long)total->moves,
+        total->states ? 1e6 * total->seconds / total->states : 0.0, (unsigned long long)total->states,
+        1e6 * total->slowest);
+    if (total->failed) {
+        printf("lost codes:   ");
+        for (n = 0; n < total->example_count; n++) {
+            eval_code_string(prefs, total->examples[n], code);
+            printf(" %s", code);
+        }
+        printf("%s\n", total->failed > total->example_count ? " ..." : "");
+    }
+}
+
+// prints the results as JSON
+static void eval_print_json(const struct mmeval *eval, unsigned int threads, double seconds) {
+    const MASTERMIND_PREFERENCES *prefs = &eval->prefs;
+    const struct mmevalresult *total = &eval->total;
+    uint64_t guesses = 0, solved = 0;
+    unsigned int n, worst = 0;
+    for (n = 1; n <= MMPREFS_MAX_ATTEMPT_COUNT; n++) {
+        guesses += n * total->guesses[n];
+        solved += total->guesses[n];
+        if (total->guesses[n])
+            worst = n;
+    }
+    printf("{\"code_length\":%u,\"color_count\":%u,\"attempt_count\":%u,\"multiple_colors\":%u,"
+        "\"hints_position_based\":%u,\"strategy\":\"%s\",\"consistent_only\":%s,\"book\":%s,\"secrets\":%llu,"
+        "\"threads\":%u,\"seconds\":%.6f,\"avg_guesses\":%.6f,\"worst\":%u,\"lost\":%llu,\"guesses\":[",
+        prefs->code_length, prefs->color_count, prefs->attempt_count, prefs->multiple_colors,
+        prefs->hints_position_based, mastermind_solver_name(prefs),
+        prefs->consistent_only ? "true" : "false", prefs->book ? "true" : "false",
+        (unsigned long long)eval->secret_count, threads, seconds, solved ? (double)guesses / solved : 0.0, worst,
+        (unsigned long long)total->failed);
+    for (n = 1; n <= prefs->attempt_count; n++)
+        printf("%s%llu", n > 1 ? "," : "", (unsigned long long)total->guesses[n]);
+    printf("],\"moves\":%llu,\"states\":%llu,\"move_us\":%.3f,\"state_us\":%.3f,\"max_us\":%.3f}\n",
+        (unsigned long long)total->moves, (unsigned long long)total->states,
+        total->moves ? 1e6 * total->weighted / total->moves : 0.0,
+        total->states ? 1e6 * total->seconds / total->states : 0.0, 1e6 * total->slowest);
+}
+
+int main(int argc, char *argv[]) {
+    static struct mmeval eval;
+    MASTERMIND_PREFERENCES prefs = { 4, 6, 7, false, true };
+    const char *book_path = MMBOOK_DEFAULT_PATH;
+    MASTERMIND_CANDIDATES *all;
+    MASTERMIND_BOOK *book;
+    struct mmevalworker *workers;
+    struct mmevaltask root;
+    MMTHREAD *threads;
+    unsigned int thread_count = 0, started = 0, n;
+    bool json = false, ok = true;
+    double start;
+    for (n = 1; n < (unsigned int)argc; n++) {
+        const char *value = n + 1 < (unsigned int)argc ? argv[n + 1] : NULL;
+        if (strcmp(argv[n], "--json") == 0) {
+            json = true;
+            continue;
+        }
+        if (!value)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--code-length") == 0)
+            prefs.code_length = atoi(value);
+        else if (strcmp(argv[n], "--color-count") == 0)
+            prefs.color_count = atoi(value);
+        else if (strcmp(argv[n], "--attempt-count") == 0)
+            prefs.attempt_count = atoi(value);
+        else if (strcmp(argv[n], "--multiple-colors") == 0)
+            prefs.multiple_colors = atoi(value) != 0;
+        else if (strcmp(argv[n], "--hints-position-based") == 0)
+            prefs.hints_position_based = atoi(value) != 0;
+        else if (strcmp(argv[n], "--strategy") == 0 && strcmp(value, "minimax") == 0)
+            prefs.strategy = MMSTRATEGY_MINIMAX;
+        else if (strcmp(argv[n], "--strategy") == 0 && strcmp(value, "entropy") == 0)
+            prefs.strategy = MMSTRATEGY_ENTROPY;
+        else if (strcmp(argv[n], "--strategy") == 0 && strcmp(value, "propagate") == 0)
+            prefs.strategy = MMSTRATEGY_PROPAGATE;
+        else if (strcmp(argv[n], "--consistent-only") == 0)
+            prefs.consistent_only = atoi(value) != 0;
+        else if (strcmp(argv[n], "--threads") == 0)
+            thread_count = atoi(value);
+        else if (strcmp(argv[n], "--book") == 0)
+            book_path = value;
+        else
+            return usage(argv[0]);
+        n++;
+    }
+    if (!mastermind_prefs_valid(&prefs))
+        return usage(argv[0]);
+    if (prefs.strategy == MMSTRATEGY_PROPAGATE && !prefs.hints_position_based) {
+        fprintf(stderr, "--strategy propagate needs position based hints\n");
+        return 1;
+    }
+    if (!mastermind_prefs_enumerable(&prefs)) {
+        fprintf(stderr, "the codes cannot be enumerated, beyond enumeration the COMSOLVER can only be simulated\n");
+        return 1;
+    }
+    if (!thread_count)
+        thread_count = mmthread_cpu_count();
+    start = mmtime_now();
+    // a missing or stale book is no error, every guess is computed then
+    prefs.book = book = mastermind_book_open(book_path);
+    prefs.thread_count = 1; // the states are spread over the threads
+    eval.prefs = prefs;
+    eval.classes = mastermind_feedback_classes(&prefs);
+    eval.table = mastermind_scoretable_create(&prefs);
+    all = mastermind_candidates_create(&prefs);
+    eval.secret_count = all ? mastermind_candidates_count(all) : 0;
+    eval.secrets = malloc(eval.secret_count * sizeof(MMCODE));
+    workers = calloc(thread_count, sizeof(struct mmevalworker));
+    threads = calloc(thread_count, sizeof(MMTHREAD));
+    if (!eval.table || !all || !eval.secrets || !workers || !threads) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    mastermind_candidates_collect(all, eval.secrets, NULL, eval.secret_count);
+    mastermind_candidates_destroy(all);
+    for (n = 0; n < thread_count; n++) {
+        struct mmevalworker *worker = &workers[n];
+        worker->eval = &eval;
+        worker->solver = mastermind_solver_create(&eval.prefs, eval.table);
+        worker->scores = malloc(eval.secret_count * sizeof(MMFEEDBACK));
+        worker->sorted = malloc(eval.secret_count * sizeof(MMCODE));
+        worker->offsets = malloc((eval.classes + 1) * sizeof(uint32_t));
+        if (!worker->solver || !worker->scores || !worker->sorted || !worker->offsets) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    mmmutex_init(&eval.lock);
+    mmcond_init(&eval.wake);
+    memset(&root, 0, sizeof(root));
+    root.count = eval.secret_count;
+    eval_push(&eval, &root);
+    for (n = 1; n < thread_count; n++) {
+        if (mmthread_create(&threads[started], eval_worker, &workers[n]))
+            started++;
+    }
+    eval_worker(&workers[0]);
+    for (n = 0; n < started; n++)
+        mmthread_join(threads[n]);
+    if (eval.failed) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (json)
+        eval_print_json(&eval, started + 1, mmtime_now() - start);
+    else
+        eval_print(&eval, started + 1, mmtime_now() - start);
+    ok = eval.total.failed == 0;
+    for (n = 0; n < thread_count; n++) {
+        mastermind_solver_destroy(workers[n].solver);
+        free(workers[n].scores);
+        free(workers[n].sorted);
+        free(workers[n].offsets);
+    }
+    mmcond_destroy(&eval.wake);
+    mmmutex_destroy(&eval.lock);
+    mastermind_scoretable_destroy((MASTERMIND_SCORETABLE *)eval.table);
+    mastermind_book_close(book);
+    free(eval.secrets);
+    free(workers);
+    free(threads);
+    return ok ? 0 : 2; // 2 = some secret codes are lost
+}
+
+
+
+// End of source file 'mmeval.c'
@@ -0,0 +1,337 @@
+/*!mmgenetic.c
+ * Genetic search of the COMSOLVER for game MasterMind (see mmgenetic.h).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * The fitness of a code is its distance to consistency: for every guess so
+ * far the difference between the feedback the code would have given and the
+ * real one (0 = consistent). Every generation keeps the best codes and fills
+ * up with children of the better half (crossover, then mutation, swapped
+ * pegs and reversed ranges), duplicates are replaced by random codes. One
+ * code of the better half climbs towards consistency peg by peg, and a
+ * population which has not got any better for a while starts over. The
+ * search takes the whole time budget unless it has found enough codes. The
+ * population is kept from one guess to the next, it is close to the new
+ * consistent codes already. See Berghman, Goossens and Leus: Efficient
+ * solutions for Mastermind using genetic algorithms (2009).
+ */
+
+#include "mastermind.h"
+#include "mmgenetic.h"
+#include "mmthread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// number of codes of the population
+#define MMGENETIC_POPULATION 128
+// number of the best codes which survive a generation unchanged
+#define MMGENETIC_ELITE 8
+// max. number of consistent codes the guess is selected from
+#define MMGENETIC_ELIGIBLE 256
+// generations without a better code after which the population starts over
+#define MMGENETIC_STAGNATION 64
+// chances of the changes of a child in 1/1000
+#define MMGENETIC_MUTATE 30
+#define MMGENETIC_SWAP 30
+#define MMGENETIC_REVERSE 20
+// max. number of codes with another color at one peg
+#define MMGENETIC_NEIGHBORS (MMPREFS_MAX_CODE_LENGTH * MMPREFS_MAX_COLOR_COUNT)
+
+// state of the search for one game, all memory is allocated at once
+struct mmgenetic {
+    MASTERMIND_PREFERENCES prefs;
+    const MASTERMIND_SCORER *scorer;
+    MASTERMIND_RANDOM random;
+    double budget; // seconds per guess
+    MMCODE population[MMGENETIC_POPULATION],
+        children[MMGENETIC_POPULATION];
+    uint64_t ranking[MMGENETIC_POPULATION]; // fitness (high 32 bits) and index of every code, best first
+    MMFEEDBACK scores[MMGENETIC_POPULATION];
+    MMCODE neighbors[MMGENETIC_NEIGHBORS]; // codes the climbing code may move to
+    unsigned int distances[MMGENETIC_NEIGHBORS];
+    MMFEEDBACK neighbor_scores[MMGENETIC_NEIGHBORS];
+    MMCODE eligible[MMGENETIC_ELIGIBLE]; // consistent codes found for the next guess
+    size_t eligible_count;
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// counts the set bits of value
+static unsigned int nex_genetic_popcount(uint32_t value) {
+    unsigned int rt = 0; // rt means return value
+    for (; value; value &= value - 1)
+        rt++;
+    return rt;
+}
+// gets the difference between two feedbacks, 0 if they are equal
+static unsigned int nex_genetic_distance(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK a, MMFEEDBACK b) {
+    int blacks = (int)MMFEEDBACK_BLACKS(a) - (int)MMFEEDBACK_BLACKS(b),
+        whites = (int)MMFEEDBACK_WHITES(a) - (int)MMFEEDBACK_WHITES(b);
+    if (prefs->hints_position_based) // positions which got another hint
+        return nex_genetic_popcount(MMFEEDBACK_BLACKS(a) ^ MMFEEDBACK_BLACKS(b)) +
+            nex_genetic_popcount(MMFEEDBACK_WHITES(a) ^ MMFEEDBACK_WHITES(b));
+    return (blacks < 0 ? -blacks : blacks) + (whites < 0 ? -whites : whites);
+}
+// gets the color of a peg
+static unsigned int nex_genetic_peg(MMCODE code, unsigned int peg) {
+    return code >> (MMCODE_PEG_BITS * peg) & MMCODE_PEG_MASK;
+}
+// sets the color of a peg
+static MMCODE nex_genetic_setpeg(MMCODE code, unsigned int peg, unsigned int color) {
+    unsigned int shift = MMCODE_PEG_BITS * peg;
+    return (code & ~((MMCODE)MMCODE_PEG_MASK << shift)) | (MMCODE)color << shift;
+}
+// gets the bits of the pegs [begin, end)
+static MMCODE nex_genetic_pegs(unsigned int begin, unsigned int end) {
+    MMCODE below_end = end >= MMPREFS_MAX_CODE_LENGTH ? ~(MMCODE)0 : ((MMCODE)1 << (MMCODE_PEG_BITS * end)) - 1;
+    return below_end & ~(((MMCODE)1 << (MMCODE_PEG_BITS * begin)) - 1);
+}
+// gets a random color which is not in used (bit n = color n)
+static unsigned int nex_genetic_unused(struct mmgenetic *genetic, unsigned int used) {
+    unsigned int pick = mastermind_random_below(&genetic->random,
+        genetic->prefs.color_count - nex_genetic_popcount(used)), color;
+    for (color = 0; used >> color & 1 || pick--; color++);
+    return color;
+}
+// replaces repeated colors by unused ones if the preferences do not allow them
+static MMCODE nex_genetic_repair(struct mmgenetic *genetic, MMCODE code) {
+    unsigned int n, used = 0, repeated = 0;
+    if (genetic->prefs.multiple_colors)
+        return code;
+    for (n = 0; n < genetic->prefs.code_length; n++) {
+        unsigned int color = nex_genetic_peg(code, n);
+        if (used >> color & 1)
+            repeated |= 1u << n;
+        used |= 1u << color;
+    }
+    for (n = 0; repeated; n++, repeated >>= 1) {
+        if (repeated & 1) {
+            unsigned int color = nex_genetic_unused(genetic, used);
+            code = nex_genetic_setpeg(code, n, color);
+            used |= 1u << color;
+        }
+    }
+    return code;
+}
+// creates a child of two codes
+static MMCODE nex_genetic_child(struct mmgenetic *genetic, MMCODE a, MMCODE b) {
+    unsigned int length = genetic->prefs.code_length, begin, end, n;
+    MMCODE rt, mask; // rt means return value
+    // one-point or two-point crossover: the pegs [begin, end) are taken from b
+    begin = 1 + mastermind_random_below(&genetic->random, length - 1);
+    end = mastermind_random_below(&genetic->random, 2) ? length : begin + mastermind_random_below(&genetic->random, length - begin + 1);
+    mask = nex_genetic_pegs(begin, end);
+    rt = nex_genetic_repair(genetic, (a & ~mask) | (b & mask));
+    if (mastermind_random_below(&genetic->random, 1000) < MMGENETIC_MUTATE) { // one peg gets another color
+        unsigned int peg = mastermind_random_below(&genetic->random, length), used = 0;
+        for (n = 0; n < length && !genetic->prefs.multiple_colors; n++)
+            used |= 1u << nex_genetic_peg(rt, n);
+        used |= 1u << nex_genetic_peg(rt, peg); // never the color it has
+        if (nex_genetic_popcount(used) < genetic->prefs.color_count) // else all colors are taken
+            rt = nex_genetic_setpeg(rt, peg, nex_genetic_unused(genetic, used));
+    }
+    if (mastermind_random_below(&genetic->random, 1000) < MMGENETIC_SWAP) { // two pegs swap their colors
+        unsigned int x = mastermind_random_below(&genetic->random, length),
+            y = mastermind_random_below(&genetic->random, length), color = nex_genetic_peg(rt, x);
+        rt = nex_genetic_setpeg(nex_genetic_setpeg(rt, x, nex_genetic_peg(rt, y)), y, color);
+    }
+    if (mastermind_random_below(&genetic->random, 1000) < MMGENETIC_REVERSE) { // the pegs of a range are reversed
+        begin = mastermind_random_below(&genetic->random, length);
+        end = begin + mastermind_random_below(&genetic->random, length - begin) + 1;
+        for (n = 0; begin + n < end - 1 - n; n++) {
+            unsigned int color = nex_genetic_peg(rt, begin + n);
+            rt = nex_genetic_setpeg(nex_genetic_setpeg(rt, begin + n, nex_genetic_peg(rt, end - 1 - n)), end - 1 - n, color);
+        }
+    }
+    return rt;
+}
+// adds a consistent code to the eligible ones unless it is there already or they are full
+static void nex_genetic_collect(struct mmgenetic *genetic, MMCODE code) {
+    size_t m;
+    if (genetic->eligible_count == MMGENETIC_ELIGIBLE)
+        return;
+    for (m = 0; m < genetic->eligible_count && genetic->eligible[m] != code; m++);
+    if (m == genetic->eligible_count)
+        genetic->eligible[genetic->eligible_count++] = code;
+}
+// moves a code closer to consistency, one peg at a time, as long as another color of a peg does so
+static MMCODE nex_genetic_climb(struct mmgenetic *genetic, MMCODE code, unsigned int fitness,
+    const MMCODE *guesses, const MMFEEDBACK *feedbacks, unsigned int attempt) {
+    unsigned int length = genetic->prefs.code_length, count, best, n, m, c;
+    while (fitness) {
+        for (count = 0, n = 0; n < length; n++) {
+            unsigned int color = nex_genetic_peg(code, n);
+            for (c = 0; c < genetic->prefs.color_count; c++) {
+                MMCODE neighbor = nex_genetic_setpeg(code, n, c);
+                if (c == color)
+                    continue;
+                for (m = 0; m < length && !genetic->prefs.multiple_colors; m++) { // the peg of color c gets the old one
+                    if (m != n && nex_genetic_peg(code, m) == c)
+                        neighbor = nex_genetic_setpeg(neighbor, m, color);
+                }
+                genetic->neighbors[count] = neighbor;
+                genetic->distances[count++] = 0;
+            }
+        }
+        for (m = 0; m < attempt; m++) {
+            genetic->scorer->batch(&genetic->prefs, guesses[m], genetic->neighbors, genetic->neighbor_scores, count);
+            for (n = 0; n < count; n++)
+                genetic->distances[n] += nex_genetic_distance(&genetic->prefs, genetic->neighbor_scores[n], feedbacks[m]);
+        }
+        for (best = 0, n = 1; n < count; n++) {
+            if (genetic->distances[n] < genetic->distances[best])
+                best = n;
+        }
+        if (genetic->distances[best] >= fitness)
+            break;
+        code = genetic->neighbors[best];
+        fitness = genetic->distances[best];
+    }
+    if (!fitness)
+        nex_genetic_collect(genetic, code);
+    return code;
+}
+// orders the ranking, best fitness first
+static int nex_genetic_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+// rates the population, collects its consistent codes and sorts the ranking
+static unsigned int nex_genetic_rate(struct mmgenetic *genetic, const MMCODE *guesses, const MMFEEDBACK *feedbacks,
+    unsigned int attempt) {
+    unsigned int fitness[MMGENETIC_POPULATION] = { 0 }, n, m;
+    for (m = 0; m < attempt; m++) {
+        genetic->scorer->batch(&genetic->prefs, guesses[m], genetic->population, genetic->scores, MMGENETIC_POPULATION);
+        for (n = 0; n < MMGENETIC_POPULATION; n++)
+            fitness[n] += nex_genetic_distance(&genetic->prefs, genetic->scores[n], feedbacks[m]);
+    }
+    for (n = 0; n < MMGENETIC_POPULATION; n++) {
+        genetic->ranking[n] = (uint64_t)fitness[n] << 32 | n;
+        if (!fitness[n])
+            nex_genetic_collect(genetic, genetic->population[n]);
+    }
+    qsort(genetic->ranking, MMGENETIC_POPULATION, sizeof(uint64_t), nex_genetic_compare);
+    return genetic->ranking[0] >> 32;
+}
+// replaces the population by the next generation
+static void nex_genetic_breed(struct mmgenetic *genetic) {
+    unsigned int n, m;
+    for (n = 0; n < MMGENETIC_POPULATION; n++) {
+        MMCODE child;
+        if (n < MMGENETIC_ELITE)
+            child = genetic->population[(uint32_t)genetic->ranking[n]];
+        else
+            child = nex_genetic_child(genetic,
+                genetic->population[(uint32_t)genetic->ranking[mastermind_random_below(&genetic->random, MMGENETIC_POPULATION / 2)]],
+                genetic->population[(uint32_t)genetic->ranking[mastermind_random_below(&genetic->random, MMGENETIC_POPULATION / 2)]]);
+        // a population of copies finds nothing new
+        for (m = 0; m < n && genetic->children[m] != child; m++);
+        genetic->children[n] = m < n ? mastermind_random_code(&genetic->prefs, &genetic->random) : child;
+    }
+    memcpy(genetic->population, genetic->children, sizeof(genetic->population));
+}
+// orders feedbacks ascending
+static int nex_genetic_comparefeedback(const void *a, const void *b) {
+    MMFEEDBACK x = *(const MMFEEDBACK *)a, y = *(const MMFEEDBACK *)b;
+    return x < y ? -1 : x > y;
+}
+// selects the consistent code which splits the others into the most partitions, on a tie the one of the smaller
+// partitions (sum of their squared sizes)
+static MMCODE nex_genetic_select(struct mmgenetic *genetic) {
+    MMFEEDBACK scores[MMGENETIC_ELIGIBLE];
+    size_t n, m, best = 0, best_parts = 0, best_squares = 0;
+    for (n = 0; n < genetic->eligible_count; n++) {
+        size_t parts = 0, squares = 0, size = 0;
+        genetic->scorer->batch(&genetic->prefs, genetic->eligible[n], genetic->eligible, scores, genetic->eligible_count);
+        qsort(scores, genetic->eligible_count, sizeof(MMFEEDBACK), nex_genetic_comparefeedback);
+        for (m = 0; m < genetic->eligible_count; m++) { // a partition ends where the next score differs
+            size++;
+            if (m + 1 < genetic->eligible_count && scores[m + 1] == scores[m])
+                continue;
+            parts++;
+            squares += size * size;
+            size = 0;
+        }
+        if (parts > best_parts || (parts == best_parts && squares < best_squares)) {
+            best = n;
+            best_parts = parts;
+            best_squares = squares;
+        }
+    }
+    return genetic->eligible[best];
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+struct mmgenetic *mmgenetic_create(const MASTERMIND_PREFERENCES *prefs) {
+    struct mmgenetic *genetic = calloc(1, sizeof(struct mmgenetic));
+    if (!genetic)
+        return NULL;
+    genetic->prefs = *prefs;
+    genetic->scorer = mastermind_scorer(prefs);
+    genetic->budget = (prefs->solver_millis ? prefs->solver_millis : MMSOLVER_DEFAULT_MILLIS) / 1000.0;
+    mmgenetic_reset(genetic);
+    return genetic;
+}
+
+void mmgenetic_reset(struct mmgenetic *genetic) {
+    unsigned int n;
+    mastermind_random_seed(&genetic->random, genetic->prefs.seed);
+    for (n = 0; n < MMGENETIC_POPULATION; n++)
+        genetic->population[n] = mastermind_random_code(&genetic->prefs, &genetic->random);
+    genetic->eligible_count = 0;
+}
+
+MMCODE mmgenetic_guess(struct mmgenetic *genetic, const MMCODE *guesses, const MMFEEDBACK *feedbacks,
+    unsigned int attempt) {
+    double start = mmtime_now();
+    unsigned int generation, n, best = ~0u, stagnant = 0;
+    uint64_t ranked;
+    size_t found = 0;
+    genetic->eligible_count = 0;
+    for (generation = 0; ; generation++) {
+        unsigned int fitness = nex_genetic_rate(genetic, guesses, feedbacks, attempt);
+        if (genetic->eligible_count == MMGENETIC_ELIGIBLE || mmtime_now() - start >= genetic->budget)
+            break;
+        ranked = genetic->ranking[mastermind_random_below(&genetic->random, MMGENETIC_POPULATION / 2)];
+        genetic->population[(uint32_t)ranked] = nex_genetic_climb(genetic, genetic->population[(uint32_t)ranked],
+            ranked >> 32, guesses, feedbacks, attempt); // one code of the better half
+        if (fitness < best || genetic->eligible_count > found) {
+            best = fitness;
+            found = genetic->eligible_count;
+            stagnant = 0;
+        }
+        else if (++stagnant == MMGENETIC_STAGNATION) { // stuck at a local optimum
+            for (n = 0; n < MMGENETIC_POPULATION; n++)
+                genetic->population[n] = mastermind_random_code(&genetic->prefs, &genetic->random);
+            best = ~0u;
+            stagnant = 0;
+            continue;
+        }
+        nex_genetic_breed(genetic);
+    }
+    if (!genetic->eligible_count) // out of time: the code closest to consistency
+        return genetic->population[(uint32_t)genetic->ranking[0]];
+    return nex_genetic_select(genetic);
+}
+
+size_t mmgenetic_found(const struct mmgenetic *genetic) {
+    return genetic->eligible_count;
+}
+
+void mmgenetic_destroy(struct mmgenetic *genetic) {
+    free(genetic);
+}
+
+
+
+// End of source file 'mmgenetic.c'
@@ -0,0 +1,38 @@
+/*!mmgenetic.h
+ * Genetic search of the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Beyond MMPREFS_ENUM_MAX_CODE_LENGTH pegs or MMPREFS_ENUM_MAX_CODES codes
+ * the candidates cannot be enumerated, so mmsolver.c hands every guess with
+ * hints by count to this search (see mmpropagate.h for position based
+ * hints): a population of codes evolves towards the codes consistent with
+ * all feedbacks so far, the ones found are collected and the guess is taken
+ * from them. Memory is fixed when the search is created.
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMGENETIC_H
+#define MMGENETIC_H
+
+#include "mastermind.h"
+
+// state of the search for one game
+struct mmgenetic;
+
+// creates a search for games with prefs, returns NULL if out of memory
+struct mmgenetic *mmgenetic_create(const MASTERMIND_PREFERENCES *prefs);
+// starts a new game: a new random population, the generator is seeded with prefs.seed
+void mmgenetic_reset(struct mmgenetic *genetic);
+// selects the next guess within prefs.solver_millis from the attempt guesses and feedbacks so far
+MMCODE mmgenetic_guess(struct mmgenetic *genetic, const MMCODE *guesses, const MMFEEDBACK *feedbacks,
+    unsigned int attempt);
+// gets the number of consistent codes the last guess was selected from
+size_t mmgenetic_found(const struct mmgenetic *genetic);
+// frees a search, may be NULL
+void mmgenetic_destroy(struct mmgenetic *genetic);
+
+// end of MMGENETIC_H include guard
+#endif
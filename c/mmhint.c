@@ -0,0 +1,328 @@
+/*!mmhint.c
+ * COMSOLVER running ahead of the player for game MasterMind (see mmhint.h).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * The thread works on one game state at a time, the current state first.
+ * A state is identified by the guesses and feedbacks leading to it, so a
+ * result is kept if its state is still the current one or one after the
+ * typed guess, whatever happened in the meantime. When the player changes
+ * the game so that the running selection becomes useless, it is cancelled
+ * (mastermind_solver_cancel()).
+ */
+
+#include "mastermind.h"
+#include "mmhint.h"
+#include "mmthread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// max. number of feedbacks of the typed guess whose states are solved ahead
+#define MMHINT_AHEAD 16
+// max. number of candidates the likely feedbacks of the typed guess are counted with
+#define MMHINT_SAMPLE (1u << 16)
+
+// work of the thread
+enum mmhintjob {
+    MMHINT_CURRENT, // guess for the current state
+    MMHINT_COUNT, // most likely feedbacks of the typed guess
+    MMHINT_AHEAD_STATE // guess for a state after the typed guess
+};
+
+// a game state: the guesses and feedbacks leading to it
+struct mmhintstate {
+    unsigned int attempt;
+    MMCODE guesses[MMPREFS_MAX_ATTEMPT_COUNT];
+    MMFEEDBACK feedbacks[MMPREFS_MAX_ATTEMPT_COUNT];
+};
+
+// guess of the COMSOLVER for a state
+struct mmhintresult {
+    MMFEEDBACK feedback; // feedback of the typed guess leading to the state (states ahead only)
+    MMCODE guess;
+    size_t remaining; // codes which may still be the secret code
+    bool ready;
+};
+
+// state of the background COMSOLVER
+struct mmhint {
+    MASTERMIND_PREFERENCES prefs;
+    // used by the thread only
+    MASTERMIND_SOLVER *solver;
+    MASTERMIND_CANDIDATES *candidates; // NULL beyond enumeration, then nothing is solved ahead
+    MMCODE *sample;
+    MMFEEDBACK *scores,
+        *class_feedbacks; // a feedback of every feedback index
+    uint32_t *class_counts; // number of sample codes of every feedback index
+    unsigned int classes;
+    MMTHREAD thread;
+    MMMUTEX lock; // protects everything below
+    MMCOND wake, // signals new work or shutdown to the thread
+        done; // signals a result of the thread
+    struct mmhintstate state; // current state of the game
+    struct mmhintresult current; // guess for it
+    MMCODE input; // typed guess if complete
+    bool complete,
+        counted; // the likely feedbacks of input are in ahead
+    struct mmhintresult ahead[MMHINT_AHEAD]; // guesses for the states after the likely feedbacks of input
+    unsigned int ahead_count;
+    struct mmhintstate running; // state the thread works on
+    bool busy,
+        shutdown;
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// gets how a state is related to the game: 0 = useless, 1 = current state, 2 = a state after the typed guess
+static int nex_hint_relation(const struct mmhint *hint, const struct mmhintstate *state) {
+    unsigned int n, attempt = hint->state.attempt;
+    if (state->attempt != attempt &&
+        !(state->attempt == attempt + 1 && hint->complete && state->guesses[attempt] == hint->input))
+        return 0;
+    for (n = 0; n < attempt; n++) {
+        if (state->guesses[n] != hint->state.guesses[n] || state->feedbacks[n] != hint->state.feedbacks[n])
+            return 0;
+    }
+    return state->attempt == attempt ? 1 : 2;
+}
+// the game changed: cancels the running selection if its state became useless (lock is held)
+static void nex_hint_changed(struct mmhint *hint) {
+    if (hint->busy && !nex_hint_relation(hint, &hint->running))
+        mastermind_solver_cancel(hint->solver, true);
+    mmcond_broadcast(&hint->wake);
+}
+// selects the guess for a state
+static struct mmhintresult nex_hint_solve(struct mmhint *hint, const struct mmhintstate *state) {
+    struct mmhintresult rt = { 0, 0, 0, true }; // rt means return value
+    unsigned int n;
+    mastermind_solver_reset(hint->solver);
+    for (n = 0; n < state->attempt; n++)
+        mastermind_solver_feedback(hint->solver, state->guesses[n], state->feedbacks[n]);
+    rt.remaining = mastermind_solver_remaining(hint->solver);
+    rt.guess = mastermind_solver_guess(hint->solver);
+    return rt;
+}
+// finds the most likely feedbacks of the last guess of state (its feedback is ignored), returns their number
+static unsigned int nex_hint_count(struct mmhint *hint, const struct mmhintstate *state, struct mmhintresult *out) {
+    MMCODE guess = state->guesses[state->attempt - 1];
+    unsigned int rt = 0, n, solved; // rt means return value
+    size_t count, m;
+    if (!hint->candidates)
+        return 0;
+    mastermind_candidates_reset(hint->candidates);
+    for (n = 0; n + 1 < state->attempt; n++)
+        mastermind_candidates_prune(hint->candidates, state->guesses[n], state->feedbacks[n]);
+    count = mastermind_candidates_collect(hint->candidates, hint->sample, NULL, MMHINT_SAMPLE);
+    mastermind_score_batch(&hint->prefs, guess, hint->sample, hint->scores, count);
+    memset(hint->class_counts, 0, hint->classes * sizeof(uint32_t));
+    for (m = 0; m < count; m++) {
+        unsigned int index = mastermind_feedback_index(&hint->prefs, hint->scores[m]);
+        hint->class_counts[index]++;
+        hint->class_feedbacks[index] = hint->scores[m];
+    }
+    solved = mastermind_feedback_index(&hint->prefs, mastermind_score(&hint->prefs, guess, guess));
+    hint->class_counts[solved] = 0; // nothing left to solve after it
+    while (rt < MMHINT_AHEAD) { // the biggest partitions first
+        unsigned int best = 0;
+        for (n = 1; n < hint->classes; n++) {
+            if (hint->class_counts[n] > hint->class_counts[best])
+                best = n;
+        }
+        if (!hint->class_counts[best])
+            break;
+        memset(&out[rt], 0, sizeof(struct mmhintresult));
+        out[rt++].feedback = hint->class_feedbacks[best];
+        hint->class_counts[best] = 0;
+    }
+    return rt;
+}
+// main function of the thread: works on the most urgent state until shutdown
+static void nex_hint_main(void *arg) {
+    struct mmhint *hint = arg;
+    mmmutex_lock(&hint->lock);
+    while (!hint->shutdown) {
+        struct mmhintresult result, ahead[MMHINT_AHEAD];
+        struct mmhintstate state = hint->state;
+        enum mmhintjob job;
+        unsigned int n, ahead_count = 0;
+        if (!hint->current.ready)
+            job = MMHINT_CURRENT;
+        else if (hint->complete && !hint->counted && state.attempt + 1 < hint->prefs.attempt_count)
+            job = MMHINT_COUNT;
+        else {
+            for (n = 0; n < hint->ahead_count && hint->ahead[n].ready; n++);
+            if (!hint->complete || n >= hint->ahead_count) {
+                mmcond_wait(&hint->wake, &hint->lock);
+                continue;
+            }
+            job = MMHINT_AHEAD_STATE;
+            state.feedbacks[state.attempt] = hint->ahead[n].feedback;
+        }
+        if (job != MMHINT_CURRENT)
+            state.guesses[state.attempt++] = hint->input;
+        hint->running = state;
+        hint->busy = true;
+        mastermind_solver_cancel(hint->solver, false);
+        mmmutex_unlock(&hint->lock);
+        if (job == MMHINT_COUNT)
+            ahead_count = nex_hint_count(hint, &state, ahead);
+        else
+            result = nex_hint_solve(hint, &state);
+        mmmutex_lock(&hint->lock);
+        hint->busy = false;
+        switch (nex_hint_relation(hint, &state)) {
+        case 1: // the state of the game, also if the feedback the state was solved ahead for came in
+            if (job != MMHINT_COUNT)
+                hint->current = result;
+            break;
+        case 2: // still a state after the typed guess
+            if (job == MMHINT_COUNT) {
+                memcpy(hint->ahead, ahead, ahead_count * sizeof(struct mmhintresult));
+                hint->ahead_count = ahead_count;
+                hint->counted = true;
+            }
+            for (n = 0; n < hint->ahead_count && job == MMHINT_AHEAD_STATE; n++) {
+                if (hint->ahead[n].feedback == state.feedbacks[state.attempt - 1]) {
+                    result.feedback = hint->ahead[n].feedback;
+                    hint->ahead[n] = result;
+                }
+            }
+            break;
+        }
+        mmcond_broadcast(&hint->done);
+    }
+    mmmutex_unlock(&hint->lock);
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+struct mmhint *mmhint_create(const MASTERMIND_PREFERENCES *prefs, const MASTERMIND_SCORETABLE *table) {
+    struct mmhint *hint = calloc(1, sizeof(struct mmhint));
+    if (!hint)
+        return NULL;
+    hint->prefs = *prefs;
+    hint->solver = mastermind_solver_create(prefs, table);
+    if (mastermind_prefs_enumerable(prefs)) {
+        hint->classes = mastermind_feedback_classes(prefs);
+        hint->candidates = mastermind_candidates_create(prefs);
+        hint->sample = malloc(MMHINT_SAMPLE * sizeof(MMCODE));
+        hint->scores = malloc(MMHINT_SAMPLE * sizeof(MMFEEDBACK));
+        hint->class_feedbacks = malloc(hint->classes * sizeof(MMFEEDBACK));
+        hint->class_counts = malloc(hint->classes * sizeof(uint32_t));
+    }
+    if (hint->solver && (!hint->classes || (hint->candidates && hint->sample && hint->scores &&
+        hint->class_feedbacks && hint->class_counts))) {
+        mmmutex_init(&hint->lock);
+        mmcond_init(&hint->wake);
+        mmcond_init(&hint->done);
+        if (mmthread_create(&hint->thread, nex_hint_main, hint))
+            return hint;
+        mmcond_destroy(&hint->done);
+        mmcond_destroy(&hint->wake);
+        mmmutex_destroy(&hint->lock);
+    }
+    mastermind_solver_destroy(hint->solver);
+    mastermind_candidates_destroy(hint->candidates);
+    free(hint->sample);
+    free(hint->scores);
+    free(hint->class_feedbacks);
+    free(hint->class_counts);
+    free(hint);
+    return NULL;
+}
+
+void mmhint_reset(struct mmhint *hint) {
+    mmmutex_lock(&hint->lock);
+    hint->state.attempt = 0;
+    hint->current.ready = false;
+    hint->complete = hint->counted = false;
+    hint->ahead_count = 0;
+    nex_hint_changed(hint);
+    mmmutex_unlock(&hint->lock);
+}
+
+void mmhint_input(struct mmhint *hint, const char *code, unsigned int length) {
+    bool complete = length == hint->prefs.code_length;
+    MMCODE input = complete ? mastermind_code_pack(&hint->prefs, code) : 0;
+    mmmutex_lock(&hint->lock);
+    if (complete != hint->complete || input != hint->input) {
+        hint->complete = complete;
+        hint->input = input;
+        hint->counted = false;
+        hint->ahead_count = 0;
+        nex_hint_changed(hint);
+    }
+    mmmutex_unlock(&hint->lock);
+}
+
+void mmhint_feedback(struct mmhint *hint, MMCODE guess, MMFEEDBACK feedback) {
+    unsigned int n;
+    mmmutex_lock(&hint->lock);
+    if (hint->state.attempt < MMPREFS_MAX_ATTEMPT_COUNT) {
+        hint->current.ready = false;
+        for (n = 0; n < hint->ahead_count && hint->complete && hint->input == guess; n++) {
+            if (hint->ahead[n].feedback == feedback && hint->ahead[n].ready)
+                hint->current = hint->ahead[n]; // solved ahead
+        }
+        hint->state.guesses[hint->state.attempt] = guess;
+        hint->state.feedbacks[hint->state.attempt++] = feedback;
+        hint->complete = hint->counted = false;
+        hint->ahead_count = 0;
+        nex_hint_changed(hint);
+    }
+    mmmutex_unlock(&hint->lock);
+}
+
+bool mmhint_ready(struct mmhint *hint) {
+    bool rt; // rt means return value
+    mmmutex_lock(&hint->lock);
+    rt = hint->current.ready;
+    mmmutex_unlock(&hint->lock);
+    return rt;
+}
+
+MMCODE mmhint_guess(struct mmhint *hint, size_t *remaining) {
+    MMCODE rt; // rt means return value
+    mmmutex_lock(&hint->lock);
+    while (!hint->current.ready)
+        mmcond_wait(&hint->done, &hint->lock);
+    rt = hint->current.guess;
+    if (remaining)
+        *remaining = hint->current.remaining;
+    mmmutex_unlock(&hint->lock);
+    return rt;
+}
+
+void mmhint_destroy(struct mmhint *hint) {
+    if (!hint)
+        return;
+    mmmutex_lock(&hint->lock);
+    hint->shutdown = true;
+    mastermind_solver_cancel(hint->solver, true);
+    mmcond_broadcast(&hint->wake);
+    mmmutex_unlock(&hint->lock);
+    mmthread_join(hint->thread);
+    mmcond_destroy(&hint->done);
+    mmcond_destroy(&hint->wake);
+    mmmutex_destroy(&hint->lock);
+    mastermind_solver_destroy(hint->solver);
+    mastermind_candidates_destroy(hint->candidates);
+    free(hint->sample);
+    free(hint->scores);
+    free(hint->class_feedbacks);
+    free(hint->class_counts);
+    free(hint);
+}
+
+
+
+// End of source file 'mmhint.c'
@@ -0,0 +1,41 @@
+/*!mmhint.h
+ * COMSOLVER running ahead of the player for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * While the player thinks, a background thread with its own solver selects
+ * the guess for the current game state, so the hint <H> and the takeover
+ * <C> of the game need no computation. As soon as the typed guess is
+ * complete, it also solves the states after the most likely feedbacks of
+ * it, so the hint for the next attempt is ready too. Work for a guess which
+ * is not typed anymore is cancelled and thrown away.
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMHINT_H
+#define MMHINT_H
+
+#include "mastermind.h"
+
+// state of the background COMSOLVER of the game
+struct mmhint;
+
+// creates the background thread for games with prefs, returns NULL if out of memory
+struct mmhint *mmhint_create(const MASTERMIND_PREFERENCES *prefs, const MASTERMIND_SCORETABLE *table);
+// starts a new game
+void mmhint_reset(struct mmhint *hint);
+// tells the typed guess, code holds its first length pegs ('a' = color 0)
+void mmhint_input(struct mmhint *hint, const char *code, unsigned int length);
+// adds the feedback of a guess to the game
+void mmhint_feedback(struct mmhint *hint, MMCODE guess, MMFEEDBACK feedback);
+// checks if the guess for the current game state is ready
+bool mmhint_ready(struct mmhint *hint);
+// gets the guess for the current game state and the number of codes left (may be NULL), waits until it is ready
+MMCODE mmhint_guess(struct mmhint *hint, size_t *remaining);
+// stops the thread and frees everything, may be NULL
+void mmhint_destroy(struct mmhint *hint);
+
+// end of MMHINT_H include guard
+#endif
@@ -0,0 +1,226 @@
+/*!mmlog.c
+ * Append-only game log with a background writer for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Games are encoded into one of two buffers under a lock. The other buffer
+ * belongs to the writer thread, which writes it with a single fwrite(). A
+ * buffer is handed over when the writer is idle and the buffer holds
+ * MMLOG_FLUSH_SIZE bytes or is MMLOG_FLUSH_SECONDS old, so single games (UI)
+ * reach the file at once and simulations write large blocks. A game only
+ * waits for the writer if a whole buffer is filled while the other one is
+ * still being written.
+ */
+
+#include "mastermind.h"
+#include "mmlog.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__usingwindows__)
+    #include <io.h>
+#elif defined(__usinglinux__)
+    #include <unistd.h>
+#endif
+
+// bytes of one buffer
+#define MMLOG_BUFFER (1u << 20)
+// bytes after which a buffer is handed to the idle writer thread
+#define MMLOG_FLUSH_SIZE (64u << 10)
+// seconds after which a buffer is handed to the idle writer thread
+#define MMLOG_FLUSH_SECONDS 1.0
+
+// state of an opened log
+struct mmlog {
+    FILE *file;
+    MMTHREAD thread;
+    MMMUTEX lock; // protects everything below
+    MMCOND wake, // signals a handed over buffer or shutdown to the writer thread
+        written; // signals that the writer thread is idle again
+    char *buffers[2];
+    int active; // buffer the games go into, the other one belongs to the writer thread
+    size_t used, // bytes in the active buffer
+        pending; // bytes the writer thread has to write, 0 = idle
+    double handed; // time of the last hand over
+    bool shutdown,
+        failed;
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// encodes a game as record at out (aligned to 8 bytes), returns its size
+static size_t nex_log_encode(const MASTERMIND_GAMELOG *game, char *out) {
+    const MASTERMIND_STATE *state = &game->state;
+    struct mmlogrecord *record = (struct mmlogrecord *)out;
+    struct mmlogguess *guesses = (struct mmlogguess *)(record + 1);
+    unsigned int n;
+    record->seed = game->seed;
+    record->game = game->game;
+    record->secret = state->secret;
+    record->code_length = state->prefs.code_length;
+    record->color_count = state->prefs.color_count;
+    record->attempt_count = state->prefs.attempt_count;
+    record->multiple_colors = state->prefs.multiple_colors;
+    record->hints_position_based = state->prefs.hints_position_based;
+    record->status = state->status;
+    record->comsolver = game->comsolver;
+    record->attempt = state->attempt;
+    for (n = 0; n < state->attempt; n++) {
+        guesses[n].guess = state->guesses[n];
+        guesses[n].feedback = state->feedbacks[n];
+        guesses[n].micros = game->micros[n];
+    }
+    return MMLOG_RECORD_SIZE(state->attempt);
+}
+// hands the active buffer to the writer thread, waits if it is still busy (lock is held)
+static void nex_log_handover(struct mmlog *log) {
+    while (log->pending)
+        mmcond_wait(&log->written, &log->lock);
+    log->pending = log->used;
+    log->active = !log->active;
+    log->used = 0;
+    log->handed = mmtime_now();
+    mmcond_broadcast(&log->wake);
+}
+// main function of the writer thread
+static void nex_log_main(void *arg) {
+    struct mmlog *log = arg;
+    mmmutex_lock(&log->lock);
+    while (1) {
+        const char *data;
+        size_t size;
+        bool ok;
+        while (!log->pending && !log->shutdown)
+            mmcond_wait(&log->wake, &log->lock);
+        if (!log->pending) // shutdown and everything written
+            break;
+        data = log->buffers[!log->active];
+        size = log->pending;
+        mmmutex_unlock(&log->lock);
+        ok = fwrite(data, 1, size, log->file) == size && fflush(log->file) == 0;
+        mmmutex_lock(&log->lock);
+        if (!ok)
+            log->failed = true;
+        log->pending = 0;
+        mmcond_broadcast(&log->written);
+    }
+    mmmutex_unlock(&log->lock);
+}
+// cuts off the end of an existing log behind its last complete record, e.g. a record the process was killed while
+// writing, so the games appended next can be read again
+static bool nex_log_trim(FILE *file) {
+    struct mmlogrecord record;
+    long offset = sizeof(struct mmlogheader), size;
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0)
+        return false;
+    while (fseek(file, offset, SEEK_SET) == 0 && fread(&record, sizeof(record), 1, file) == 1 &&
+        mmlog_record_valid(&record) && (long)MMLOG_RECORD_SIZE(record.attempt) <= size - offset)
+        offset += MMLOG_RECORD_SIZE(record.attempt);
+    if (offset < size) {
+        #if defined(__usingwindows__)
+        if (_chsize_s(_fileno(file), offset) != 0)
+            return false;
+        #elif defined(__usinglinux__)
+        if (ftruncate(fileno(file), offset) != 0)
+            return false;
+        #endif
+    }
+    return fseek(file, 0, SEEK_END) == 0;
+}
+// checks the header of an existing log and trims it or writes the header of a new log
+static bool nex_log_header(FILE *file) {
+    struct mmlogheader header;
+    memset(&header, 0, sizeof(header));
+    if (fseek(file, 0, SEEK_END) != 0)
+        return false;
+    if (ftell(file) == 0) {
+        memcpy(header.magic, MMLOG_MAGIC, 8);
+        header.version = MMLOG_VERSION;
+        return fwrite(&header, sizeof(header), 1, file) == 1 && fflush(file) == 0;
+    }
+    // appending always writes at the end, the seeks are only needed to switch from reading to writing
+    return fseek(file, 0, SEEK_SET) == 0 && fread(&header, sizeof(header), 1, file) == 1 &&
+        memcmp(header.magic, MMLOG_MAGIC, 8) == 0 && header.version == MMLOG_VERSION && nex_log_trim(file);
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+MASTERMIND_LOG *mastermind_log_open(const char *path) {
+    struct mmlog *log = calloc(1, sizeof(struct mmlog));
+    if (!log)
+        return NULL;
+    log->buffers[0] = malloc(MMLOG_BUFFER);
+    log->buffers[1] = malloc(MMLOG_BUFFER);
+    log->file = fopen(path, "a+b");
+    if (log->buffers[0] && log->buffers[1] && log->file && nex_log_header(log->file)) {
+        mmmutex_init(&log->lock);
+        mmcond_init(&log->wake);
+        mmcond_init(&log->written);
+        log->handed = mmtime_now();
+        if (mmthread_create(&log->thread, nex_log_main, log))
+            return log;
+        mmcond_destroy(&log->written);
+        mmcond_destroy(&log->wake);
+        mmmutex_destroy(&log->lock);
+    }
+    if (log->file)
+        fclose(log->file);
+    free(log->buffers[0]);
+    free(log->buffers[1]);
+    free(log);
+    return NULL;
+}
+
+bool mastermind_log_games(MASTERMIND_LOG *log, const MASTERMIND_GAMELOG *games, size_t count) {
+    bool rt; // rt means return value
+    size_t n;
+    if (!log)
+        return true;
+    mmmutex_lock(&log->lock);
+    for (n = 0; n < count; n++) {
+        if (log->used + MMLOG_RECORD_SIZE(games[n].state.attempt) > MMLOG_BUFFER)
+            nex_log_handover(log);
+        log->used += nex_log_encode(&games[n], log->buffers[log->active] + log->used);
+    }
+    if (log->used && !log->pending && (log->used >= MMLOG_FLUSH_SIZE || mmtime_now() - log->handed >= MMLOG_FLUSH_SECONDS))
+        nex_log_handover(log);
+    rt = !log->failed;
+    mmmutex_unlock(&log->lock);
+    return rt;
+}
+
+bool mastermind_log_close(MASTERMIND_LOG *log) {
+    bool rt; // rt means return value
+    if (!log)
+        return true;
+    mmmutex_lock(&log->lock);
+    if (log->used)
+        nex_log_handover(log);
+    log->shutdown = true;
+    mmcond_broadcast(&log->wake);
+    mmmutex_unlock(&log->lock);
+    mmthread_join(log->thread); // writes the last buffer
+    rt = fclose(log->file) == 0 && !log->failed;
+    mmcond_destroy(&log->written);
+    mmcond_destroy(&log->wake);
+    mmmutex_destroy(&log->lock);
+    free(log->buffers[0]);
+    free(log->buffers[1]);
+    free(log);
+    return rt;
+}
+
+
+
+// End of source file 'mmlog.c'
@@ -0,0 +1,75 @@
+/*!mmlog.h
+ * File format of the game log for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * A log is appended to by mastermind_log_games() and read by mmlogstat.
+ * Layout (little endian): header, then one record per game until the end
+ * of the file. A record (32 bytes) is followed by its guesses (16 bytes
+ * each), so every record of a mapped log is aligned to 8 bytes. A record cut
+ * off at the end (the process was killed while writing) ends the log, it is
+ * cut off the file when the log is opened for appending again.
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMLOG_H
+#define MMLOG_H
+
+#include "mastermind.h"
+
+#include <string.h>
+
+// first bytes of every log
+#define MMLOG_MAGIC "MMLOG\r\n\032"
+// version of the file format
+#define MMLOG_VERSION 2
+
+// start of the file
+struct mmlogheader {
+    char magic[8]; // MMLOG_MAGIC
+    uint32_t version; // MMLOG_VERSION
+    uint32_t reserved;
+};
+
+// one game
+struct mmlogrecord {
+    uint64_t seed, // seed the secret code was drawn with
+        game; // number of the game within seed
+    MMCODE secret;
+    uint8_t code_length,
+        color_count,
+        attempt_count,
+        multiple_colors,
+        hints_position_based,
+        status, // MMSESSION_STATUS, MMSESSION_PLAYING = abandoned
+        comsolver, // 1 if played by the COMSOLVER
+        attempt; // number of guesses following the record
+};
+
+// one guess of a game
+struct mmlogguess {
+    MMCODE guess;
+    MMFEEDBACK feedback;
+    uint32_t micros; // time taken for the guess in microseconds
+};
+
+// size of a record with attempt guesses
+#define MMLOG_RECORD_SIZE(attempt) (sizeof(struct mmlogrecord) + (attempt) * sizeof(struct mmlogguess))
+
+// checks if a record can be a game: valid preferences, flags, status and number of guesses
+static inline bool mmlog_record_valid(const struct mmlogrecord *record) {
+    MASTERMIND_PREFERENCES prefs;
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.code_length = record->code_length;
+    prefs.color_count = record->color_count;
+    prefs.attempt_count = record->attempt_count;
+    prefs.multiple_colors = record->multiple_colors;
+    prefs.hints_position_based = record->hints_position_based;
+    return mastermind_prefs_valid(&prefs) && record->multiple_colors <= 1 && record->hints_position_based <= 1 &&
+        record->comsolver <= 1 && record->attempt <= record->attempt_count && record->status <= MMSESSION_LOST;
+}
+
+// end of MMLOG_H include guard
+#endif
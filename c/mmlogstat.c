@@ -0,0 +1,272 @@
+/*!mmlogstat.c
+ * Statistics of a game log for game MasterMind (Linux).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Maps a log written with --log (see mmlog.h) and reads it in one pass:
+ * per preference tuple and player the win rate, the distribution of the
+ * guesses of won games and percentiles of the time taken per guess.
+ */
+
+#include "mastermind.h"
+#include "mmlog.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// histogram buckets of the guess times: the values 0-7 and 8 per power of two up to 2^32 us
+#define MMLOGSTAT_BUCKETS 240
+
+// games of one preference tuple and player
+struct mmloggroup {
+    uint8_t code_length,
+        color_count,
+        attempt_count,
+        multiple_colors,
+        hints_position_based,
+        comsolver;
+    uint64_t games,
+        won,
+        lost,
+        abandoned,
+        guess_count; // guesses of all games
+    uint64_t guesses[MMPREFS_MAX_ATTEMPT_COUNT + 1]; // guesses[n] = games won with n guesses
+    uint64_t times[MMLOGSTAT_BUCKETS]; // histogram of the guess times
+    uint32_t max_time;
+};
+
+// prints the command line options
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --log FILE                game log to read (default: mastermind.log)\n"
+        "  --json                    print JSON instead of text\n", name);
+    return 1;
+}
+
+// gets the histogram bucket of a guess time, 8 buckets per power of two (at most 12.5 % apart)
+static unsigned int stat_bucket(uint32_t micros) {
+    unsigned int exponent;
+    if (micros < 8)
+        return micros;
+    exponent = 31 - __builtin_clz(micros);
+    return (exponent - 2) * 8 + ((micros >> (exponent - 3)) & 7);
+}
+
+// gets the biggest time of a histogram bucket
+static uint64_t stat_bucket_max(unsigned int bucket) {
+    unsigned int exponent = bucket / 8 + 2;
+    if (bucket < 8)
+        return bucket;
+    return ((uint64_t)(8 + bucket % 8 + 1) << (exponent - 3)) - 1;
+}
+
+// gets a percentile of the guess times of a group (upper end of its bucket, at most the max.)
+static uint64_t stat_percentile(const struct mmloggroup *group, double percentile) {
+    uint64_t rank = (uint64_t)(percentile / 100 * group->guess_count), seen = 0, rt; // rt means return value
+    unsigned int n;
+    if (!group->guess_count)
+        return 0;
+    for (n = 0; n + 1 < MMLOGSTAT_BUCKETS; n++) {
+        if ((seen += group->times[n]) > rank)
+            break;
+    }
+    rt = stat_bucket_max(n);
+    return rt < group->max_time ? rt : group->max_time;
+}
+
+// finds the group of a record or adds it, returns NULL if out of memory
+static struct mmloggroup *stat_group(struct mmloggroup **groups, unsigned int *count, const struct mmlogrecord *record) {
+    struct mmloggroup *group;
+    unsigned int n;
+    for (n = 0; n < *count; n++) {
+        group = &(*groups)[n];
+        if (group->code_length == record->code_length && group->color_count == record->color_count &&
+            group->attempt_count == record->attempt_count && group->multiple_colors == record->multiple_colors &&
+            group->hints_position_based == record->hints_position_based && group->comsolver == record->comsolver)
+            return group;
+    }
+    if (!(group = realloc(*groups, (*count + 1) * sizeof(struct mmloggroup))))
+        return NULL;
+    *groups = group;
+    group = &group[(*count)++];
+    memset(group, 0, sizeof(struct mmloggroup));
+    group->code_length = record->code_length;
+    group->color_count = record->color_count;
+    group->attempt_count = record->attempt_count;
+    group->multiple_colors = record->multiple_colors;
+    group->hints_position_based = record->hints_position_based;
+    group->comsolver = record->comsolver;
+    return group;
+}
+
+// adds a record to its group
+static void stat_add(struct mmloggroup *group, const struct mmlogrecord *record) {
+    const struct mmlogguess *guesses = (const struct mmlogguess *)(record + 1);
+    unsigned int n;
+    group->games++;
+    if (record->status == MMSESSION_WON) {
+        group->won++;
+        group->guesses[record->attempt]++;
+    }
+    else if (record->status == MMSESSION_LOST)
+        group->lost++;
+    else
+        group->abandoned++;
+    group->guess_count += record->attempt;
+    for (n = 0; n < record->attempt; n++) {
+        group->times[stat_bucket(guesses[n].micros)]++;
+        if (guesses[n].micros > group->max_time)
+            group->max_time = guesses[n].micros;
+    }
+}
+
+// sorts the groups by preferences, the player last
+static int stat_compare(const void *a, const void *b) {
+    const struct mmloggroup *x = a, *y = b;
+    if (x->code_length != y->code_length)
+        return x->code_length - y->code_length;
+    if (x->color_count != y->color_count)
+        return x->color_count - y->color_count;
+    if (x->attempt_count != y->attempt_count)
+        return x->attempt_count - y->attempt_count;
+    if (x->multiple_colors != y->multiple_colors)
+        return x->multiple_colors - y->multiple_colors;
+    if (x->hints_position_based != y->hints_position_based)
+        return x->hints_position_based - y->hints_position_based;
+    return x->comsolver - y->comsolver;
+}
+
+// prints the groups as text
+static void stat_print(const struct mmloggroup *groups, unsigned int count) {
+    unsigned int n, m;
+    for (n = 0; n < count; n++) {
+        const struct mmloggroup *group = &groups[n];
+        uint64_t guesses = 0;
+        for (m = 1; m <= MMPREFS_MAX_ATTEMPT_COUNT; m++)
+            guesses += m * group->guesses[m];
+        printf("\n%u pegs, %u colors, %u attempts, multiple colors %u, position based hints %u, played by %s\n",
+            group->code_length, group->color_count, group->attempt_count, group->multiple_colors,
+            group->hints_position_based, group->comsolver ? "the COMSOLVER" : "a player");
+        printf("games:         %llu (won %llu, lost %llu, abandoned %llu)\n", (unsigned long long)group->games,
+            (unsigned long long)group->won, (unsigned long long)group->lost, (unsigned long long)group->abandoned);
+        printf("win rate:      %.4f %%\n", 100.0 * group->won / group->games);
+        printf("avg. guesses:  %.4f (won games)\n", group->won ? (double)guesses / group->won : 0.0);
+        printf("guesses:");
+        for (m = 1; m <= group->attempt_count && m <= MMPREFS_MAX_ATTEMPT_COUNT; m++) {
+            if (group->guesses[m])
+                printf(" %u:%llu", m, (unsigned long long)group->guesses[m]);
+        }
+        printf("\n");
+        printf("guess time:    p50 %llu us, p90 %llu us, p99 %llu us, max %lu us\n",
+            (unsigned long long)stat_percentile(group, 50), (unsigned long long)stat_percentile(group, 90),
+            (unsigned long long)stat_percentile(group, 99), (unsigned long)group->max_time);
+    }
+}
+
+// prints the groups as JSON
+static void stat_print_json(const struct mmloggroup *groups, unsigned int count) {
+    unsigned int n, m;
+    printf(",\"groups\":[");
+    for (n = 0; n < count; n++) {
+        const struct mmloggroup *group = &groups[n];
+        printf("%s{\"code_length\":%u,\"color_count\":%u,\"attempt_count\":%u,\"multiple_colors\":%u,"
+            "\"hints_position_based\":%u,\"comsolver\":%s,\"games\":%llu,\"won\":%llu,\"lost\":%llu,"
+            "\"abandoned\":%llu,\"guesses\":[", n ? "," : "", group->code_length, group->color_count,
+            group->attempt_count, group->multiple_colors, group->hints_position_based,
+            group->comsolver ? "true" : "false", (unsigned long long)group->games, (unsigned long long)group->won,
+            (unsigned long long)group->lost, (unsigned long long)group->abandoned);
+        for (m = 1; m <= group->attempt_count && m <= MMPREFS_MAX_ATTEMPT_COUNT; m++)
+            printf("%s%llu", m > 1 ? "," : "", (unsigned long long)group->guesses[m]);
+        printf("],\"guess_us\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%lu}}",
+            (unsigned long long)stat_percentile(group, 50), (unsigned long long)stat_percentile(group, 90),
+            (unsigned long long)stat_percentile(group, 99), (unsigned long)group->max_time);
+    }
+    printf("]}\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = "mastermind.log";
+    const struct mmlogheader *header;
+    struct mmloggroup *groups = NULL;
+    unsigned int n, group_count = 0;
+    uint64_t games = 0;
+    size_t offset, size;
+    bool json = false;
+    const char *data, *problem = NULL;
+    struct stat info;
+    double start = mmtime_now(), seconds;
+    int fd;
+    for (n = 1; n < (unsigned int)argc; n++) {
+        if (strcmp(argv[n], "--json") == 0)
+            json = true;
+        else if (n + 1 == (unsigned int)argc)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--log") == 0)
+            path = argv[++n];
+        else
+            return usage(argv[0]);
+    }
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(struct mmlogheader)) {
+        fprintf(stderr, "cannot read the game log '%s'\n", path);
+        return 1;
+    }
+    size = (size_t)info.st_size;
+    data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "cannot map the game log '%s'\n", path);
+        return 1;
+    }
+    madvise((void *)data, size, MADV_SEQUENTIAL); // read ahead, drop pages behind
+    header = (const struct mmlogheader *)data;
+    if (memcmp(header->magic, MMLOG_MAGIC, 8) != 0 || header->version != MMLOG_VERSION) {
+        fprintf(stderr, "'%s' is no game log of this version\n", path);
+        return 1;
+    }
+    for (offset = sizeof(struct mmlogheader); offset < size; games++) {
+        const struct mmlogrecord *record = (const struct mmlogrecord *)(data + offset);
+        struct mmloggroup *group;
+        if (size - offset < sizeof(struct mmlogrecord) || size - offset < MMLOG_RECORD_SIZE(record->attempt)) {
+            problem = "cut off";
+            break;
+        }
+        if (!mmlog_record_valid(record)) {
+            problem = "damaged";
+            break;
+        }
+        if (!(group = stat_group(&groups, &group_count, record))) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        stat_add(group, record);
+        offset += MMLOG_RECORD_SIZE(record->attempt);
+    }
+    seconds = mmtime_now() - start;
+    qsort(groups, group_count, sizeof(struct mmloggroup), stat_compare);
+    if (problem)
+        fprintf(stderr, "the game log is %s at byte %llu, the rest is ignored\n", problem, (unsigned long long)offset);
+    if (json) {
+        printf("{\"games\":%llu,\"bytes\":%llu,\"seconds\":%.6f", (unsigned long long)games,
+            (unsigned long long)offset, seconds);
+        stat_print_json(groups, group_count);
+    }
+    else {
+        printf("log:           %s, %llu games, %.1f MB read in %.3f s\n", path, (unsigned long long)games,
+            offset / 1e6, seconds);
+        stat_print(groups, group_count);
+    }
+    munmap((void *)data, size);
+    free(groups);
+    return 0;
+}
+
+
+
+// End of source file 'mmlogstat.c'
@@ -0,0 +1,589 @@
+/*!mmoptimal.c
+ * Exact optimal strategy search for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Finds the strategy with the minimum expected number of guesses (the
+ * minimum total over all secret codes) which solves every game within
+ * attempt_count guesses. Depth-first branch-and-bound: every guess gets a
+ * lower bound from the sizes of the partitions it creates, guesses are
+ * tried best bound first and cut off as soon as they cannot beat the best
+ * strategy so far. Solved sets are kept in a shared transposition table.
+ *
+ * The partitions of each first guess are solved in parallel. Every solved
+ * partition and every rated first guess is appended to a checkpoint file,
+ * an interrupted run continues from there. The result is written as a
+ * tree of an opening book, so the COMSOLVER of the game plays it.
+ */
+
+#include "mastermind.h"
+#include "mmbook.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// cost of an impossible strategy
+#define MMOPT_INF UINT32_MAX
+// max. number of codes an exact search is started for
+#define MMOPT_MAX_CODES (1u << 16)
+// entries of the transposition table (power of 2) and its number of locks
+#define MMOPT_MEMO_SIZE (1u << 20)
+#define MMOPT_MEMO_LOCKS 64
+
+// result of one solved set in the transposition table
+struct mmoptmemo {
+    uint64_t key, // hash of the set and the attempts left, 0 = empty
+        check; // second hash against collisions
+    uint32_t cost, // exact cost, or a lower bound if !exact
+        guess; // rank of the best guess (exact only)
+    bool exact;
+};
+
+// one guess and its lower bound
+struct mmoptguess {
+    uint64_t bound;
+    uint32_t rank;
+    bool consistent; // the guess may be the secret code
+};
+
+// partitions of a first guess which are solved in parallel
+struct mmoptpart {
+    unsigned int index; // feedback index
+    const uint32_t *set;
+    uint32_t count,
+        bound, // lower bound of the partition
+        cutoff, // the first guess loses if the partition costs that much
+        cost; // MMOPT_INF until solved
+};
+
+// state of the search
+struct mmopt {
+    MASTERMIND_PREFERENCES prefs;
+    MASTERMIND_SCORETABLE *table;
+    uint32_t code_count;
+    unsigned int classes,
+        solved, // feedback index of a solved game
+        branching; // max. number of unsolved partitions of a guess
+    uint64_t *hashes, // two random values per rank, the hash of a set is their xor
+        *checks;
+    struct mmoptmemo *memo;
+    MMMUTEX locks[MMOPT_MEMO_LOCKS];
+    unsigned int thread_count;
+    // the first guess which is being rated
+    struct mmoptpart *parts;
+    unsigned int part_count;
+    uint32_t guess;
+    volatile uint64_t next_part,
+        excess, // sum of (cost - bound) of the solved partitions
+        abort; // 1 if the guess is lost, the running searches stop then
+    uint64_t limit; // the guess is lost if set size + sum of bounds + excess reaches it
+    FILE *checkpoint;
+    MMMUTEX checkpoint_lock;
+};
+
+// prints the command line options
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --code-length N           preferences of the game (default: 4 pegs, 6 colors,\n"
+        "  --color-count N           7 attempts, no multiple colors, position based hints)\n"
+        "  --attempt-count N\n"
+        "  --multiple-colors 0|1\n"
+        "  --hints-position-based 0|1\n"
+        "  --threads N               threads (0 = all cores, default)\n"
+        "  --checkpoint FILE         progress file, continued if it exists (default: mmoptimal-*.ckpt)\n"
+        "  --book FILE               book the strategy is added to (default: " MMBOOK_DEFAULT_PATH ")\n", name);
+    return 1;
+}
+
+// gets the smallest possible cost of a set of count codes: one code can be solved
+// with the first guess, branching codes with the second one and so on
+static uint64_t opt_bound(const struct mmopt *opt, uint64_t count, unsigned int attempts) {
+    uint64_t rt = 0, width = 1; // rt means return value
+    unsigned int level;
+    for (level = 1; count; level++) {
+        uint64_t take = count < width ? count : width;
+        if (level > attempts)
+            return MMOPT_INF;
+        rt += take * level;
+        count -= take;
+        width = width * opt->branching < MMOPT_MAX_CODES ? width * opt->branching : MMOPT_MAX_CODES;
+    }
+    return rt;
+}
+
+// checks if a first guess is the representative of its color pattern (e.g. aabc, not abca)
+static bool opt_canonical(const MASTERMIND_PREFERENCES *prefs, MMCODE code) {
+    unsigned int n, color = 0, run = 0, last_run = MMPREFS_MAX_CODE_LENGTH;
+    for (n = 0; n < prefs->code_length; n++, code >>= MMCODE_PEG_BITS) {
+        unsigned int peg = code & MMCODE_PEG_MASK;
+        if (peg == color)
+            run++;
+        else if (peg == color + 1 && run <= last_run) {
+            last_run = run;
+            run = 1;
+            color++;
+        }
+        else
+            return false;
+    }
+    return run <= last_run;
+}
+
+// orders guesses by bound, consistent guesses and rank
+static int opt_compare_guess(const void *a, const void *b) {
+    const struct mmoptguess *x = a, *y = b;
+    if (x->bound != y->bound)
+        return x->bound < y->bound ? -1 : 1;
+    if (x->consistent != y->consistent)
+        return x->consistent ? -1 : 1;
+    return x->rank < y->rank ? -1 : x->rank > y->rank;
+}
+
+// rates all guesses (or only the canonical first guesses) against set, returns their count
+static uint32_t opt_rate(const struct mmopt *opt, const uint32_t *set, uint32_t count, unsigned int attempts,
+    uint64_t limit, bool first, uint32_t *histogram, struct mmoptguess *out) {
+    uint32_t guess, n, rt = 0; // rt means return value
+    for (guess = 0; guess < opt->code_count; guess++) {
+        unsigned int parts = 0;
+        uint64_t bound = count;
+        bool consistent = false;
+        if (first && !opt_canonical(&opt->prefs, mastermind_code_unrank(&opt->prefs, guess)))
+            continue;
+        for (n = 0; n < count; n++)
+            histogram[mastermind_scoretable_index(opt->table, guess, set[n])]++;
+        for (n = 0; n < count; n++) {
+            unsigned int index = mastermind_scoretable_index(opt->table, guess, set[n]);
+            if (!histogram[index])
+                continue; // already counted
+            if (index != opt->solved) {
+                parts++;
+                bound += opt_bound(opt, histogram[index], attempts - 1);
+            }
+            consistent = consistent || index == opt->solved;
+            histogram[index] = 0;
+        }
+        // a guess which does not split the set only wastes an attempt
+        if ((parts > 1 || consistent) && bound < limit) {
+            out[rt].rank = guess;
+            out[rt].bound = bound;
+            out[rt++].consistent = consistent;
+        }
+    }
+    qsort(out, rt, sizeof(struct mmoptguess), opt_compare_guess);
+    return rt;
+}
+
+// sorts set into the partitions of guess (by feedback index), offsets[index] is where partition index starts
+static void opt_partition(const struct mmopt *opt, uint32_t guess, const uint32_t *set, uint32_t count,
+    uint32_t *offsets, uint32_t *out) {
+    uint32_t n, sum = 0;
+    memset(offsets, 0, (opt->classes + 1) * sizeof(uint32_t));
+    for (n = 0; n < count; n++)
+        offsets[mastermind_scoretable_index(opt->table, guess, set[n]) + 1]++;
+    for (n = 0; n <= opt->classes; n++) {
+        sum += offsets[n];
+        offsets[n] = sum;
+    }
+    for (n = 0; n < count; n++)
+        out[offsets[mastermind_scoretable_index(opt->table, guess, set[n])]++] = set[n];
+    // offsets[n] is the end of partition n now, shift back to the starts
+    memmove(offsets + 1, offsets, opt->classes * sizeof(uint32_t));
+    offsets[0] = 0;
+}
+
+// gets the transposition table entry of a set
+static struct mmoptmemo *opt_memo(struct mmopt *opt, const uint32_t *set, uint32_t count, unsigned int attempts,
+    uint64_t *key, uint64_t *check) {
+    uint32_t n;
+    *key = attempts * 0x9E3779B97F4A7C15ull;
+    *check = count;
+    for (n = 0; n < count; n++) {
+        *key ^= opt->hashes[set[n]];
+        *check ^= opt->checks[set[n]];
+    }
+    *key |= 1; // 0 marks empty entries
+    return &opt->memo[*key & (MMOPT_MEMO_SIZE - 1)];
+}
+
+// gets the minimum cost of set within attempts guesses if it is below limit (then *guess is set),
+// otherwise returns a value >= limit
+static uint32_t opt_search(struct mmopt *opt, const uint32_t *set, uint32_t count, unsigned int attempts,
+    uint64_t limit, uint32_t *guess) {
+    struct mmoptmemo *memo;
+    MMMUTEX *lock;
+    struct mmoptguess *guesses;
+    uint32_t *histogram, *offsets, *sorted, n, m, guess_count;
+    uint64_t key, check, best = limit;
+    uint32_t best_guess = MMOPT_INF;
+    if (mmatomic_load(&opt->abort))
+        return MMOPT_INF;
+    if (count == 0)
+        return 0;
+    if (count == 1 && attempts > 0) {
+        *guess = set[0];
+        return 1;
+    }
+    if (opt_bound(opt, count, attempts) >= limit)
+        return (uint32_t)(limit < MMOPT_INF ? limit : MMOPT_INF);
+    if (count == 2) { // the first code, then the second one
+        *guess = set[0];
+        return 3;
+    }
+    memo = opt_memo(opt, set, count, attempts, &key, &check);
+    lock = &opt->locks[(key >> 32) % MMOPT_MEMO_LOCKS];
+    mmmutex_lock(lock);
+    if (memo->key == key && memo->check == check && (memo->exact || memo->cost >= limit)) {
+        uint32_t cost = memo->cost;
+        if (memo->exact)
+            *guess = memo->guess;
+        mmmutex_unlock(lock);
+        return cost;
+    }
+    mmmutex_unlock(lock);
+    guesses = malloc(opt->code_count * sizeof(struct mmoptguess));
+    histogram = calloc(opt->classes, sizeof(uint32_t));
+    offsets = malloc((opt->classes + 1) * sizeof(uint32_t));
+    sorted = malloc(count * sizeof(uint32_t));
+    if (!guesses || !histogram || !offsets || !sorted) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    guess_count = opt_rate(opt, set, count, attempts, best, false, histogram, guesses);
+    for (n = 0; n < guess_count && guesses[n].bound < best; n++) {
+        uint64_t total = count, rest = guesses[n].bound - count;
+        uint32_t next;
+        opt_partition(opt, guesses[n].rank, set, count, offsets, sorted);
+        for (m = 0; m < opt->classes && total + rest < best; m++) {
+            uint32_t size = offsets[m + 1] - offsets[m];
+            if (!size || m == opt->solved)
+                continue;
+            rest -= opt_bound(opt, size, attempts - 1);
+            total += opt_search(opt, sorted + offsets[m], size, attempts - 1, best - total - rest, &next);
+        }
+        if (total + rest < best) {
+            best = total;
+            best_guess = guesses[n].rank;
+        }
+    }
+    free(sorted);
+    free(offsets);
+    free(histogram);
+    free(guesses);
+    if (mmatomic_load(&opt->abort)) // the result may be incomplete
+        return MMOPT_INF;
+    mmmutex_lock(lock);
+    memo->key = key;
+    memo->check = check;
+    memo->exact = best < limit;
+    memo->cost = (uint32_t)(best < MMOPT_INF ? best : MMOPT_INF);
+    memo->guess = best_guess;
+    mmmutex_unlock(lock);
+    if (best < limit)
+        *guess = best_guess;
+    return (uint32_t)(best < MMOPT_INF ? best : MMOPT_INF);
+}
+
+// solves the partitions of the current first guess until none are left or the guess is lost
+static void opt_worker(void *arg) {
+    struct mmopt *opt = arg;
+    uint64_t n;
+    while ((n = mmatomic_add(&opt->next_part, 1)) < opt->part_count && !mmatomic_load(&opt->abort)) {
+        struct mmoptpart *part = &opt->parts[n];
+        uint32_t guess;
+        if (part->cost == MMOPT_INF) { // not in the checkpoint yet
+            uint32_t cost = opt_search(opt, part->set, part->count, opt->prefs.attempt_count - 1, part->cutoff, &guess);
+            if (mmatomic_load(&opt->abort))
+                break;
+            part->cost = cost;
+            if (cost < part->cutoff) {
+                mmmutex_lock(&opt->checkpoint_lock);
+                fprintf(opt->checkpoint, "part %u %u %u\n", opt->guess, part->index, cost);
+                fflush(opt->checkpoint);
+                mmmutex_unlock(&opt->checkpoint_lock);
+            }
+        }
+        if (part->cost >= part->cutoff ||
+            mmatomic_add(&opt->excess, part->cost - part->bound) + part->cost - part->bound >= opt->limit)
+            mmatomic_store(&opt->abort, 1);
+    }
+}
+
+// rates a first guess with all threads, returns its cost or MMOPT_INF if it does not beat best
+static uint64_t opt_first_guess(struct mmopt *opt, const uint32_t *set, uint32_t count, const struct mmoptguess *guess,
+    uint64_t best, FILE *resume) {
+    uint32_t *offsets = malloc((opt->classes + 1) * sizeof(uint32_t)), *sorted = malloc(count * sizeof(uint32_t));
+    MMTHREAD *threads = calloc(opt->thread_count, sizeof(MMTHREAD));
+    uint64_t rt = count; // rt means return value
+    unsigned int n, started = 0;
+    char line[128];
+    opt->parts = calloc(opt->classes, sizeof(struct mmoptpart));
+    if (!offsets || !sorted || !threads || !opt->parts) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    opt_partition(opt, guess->rank, set, count, offsets, sorted);
+    opt->part_count = 0;
+    for (n = 0; n < opt->classes; n++) {
+        struct mmoptpart *part = &opt->parts[opt->part_count];
+        if (n == opt->solved || offsets[n + 1] == offsets[n])
+            continue;
+        part->index = n;
+        part->set = sorted + offsets[n];
+        part->count = offsets[n + 1] - offsets[n];
+        part->bound = (uint32_t)opt_bound(opt, part->count, opt->prefs.attempt_count - 1);
+        part->cost = MMOPT_INF;
+        opt->part_count++;
+    }
+    for (n = 0; n < opt->part_count; n++) {
+        uint64_t others = guess->bound - opt->parts[n].bound;
+        opt->parts[n].cutoff = best > others ? (uint32_t)(best - others < MMOPT_INF ? best - others : MMOPT_INF) : 0;
+    }
+    // partitions of this guess which are already solved
+    rewind(resume);
+    while (fgets(line, sizeof(line), resume)) {
+        unsigned int rank, index, cost;
+        if (sscanf(line, "part %u %u %u", &rank, &index, &cost) != 3 || rank != guess->rank)
+            continue;
+        for (n = 0; n < opt->part_count; n++) {
+            if (opt->parts[n].index == index)
+                opt->parts[n].cost = cost;
+        }
+    }
+    fseek(resume, 0, SEEK_END); // the workers append to it
+    opt->guess = guess->rank;
+    opt->next_part = 0;
+    opt->excess = 0;
+    opt->abort = 0;
+    opt->limit = best - guess->bound;
+    // the largest partitions first, they take longest
+    for (n = 1; n < opt->part_count; n++) {
+        struct mmoptpart part = opt->parts[n];
+        unsigned int m;
+        for (m = n; m > 0 && opt->parts[m - 1].count < part.count; m--)
+            opt->parts[m] = opt->parts[m - 1];
+        opt->parts[m] = part;
+    }
+    for (n = 1; n < opt->thread_count; n++) {
+        if (mmthread_create(&threads[started], opt_worker, opt))
+            started++;
+    }
+    opt_worker(opt);
+    for (n = 0; n < started; n++)
+        mmthread_join(threads[n]);
+    for (n = 0; n < opt->part_count && !opt->abort; n++)
+        rt += opt->parts[n].cost;
+    if (opt->abort || rt >= best)
+        rt = MMOPT_INF;
+    free(opt->parts);
+    free(threads);
+    free(sorted);
+    free(offsets);
+    return rt;
+}
+
+// writes the strategy for set into node of the book, returns its max. number of guesses
+static unsigned int opt_build(struct mmopt *opt, struct mmbookwriter *writer, uint32_t node,
+    const uint32_t *set, uint32_t count, unsigned int attempts, uint32_t guess) {
+    uint32_t *offsets = malloc((opt->classes + 1) * sizeof(uint32_t)), *sorted = malloc(count * sizeof(uint32_t));
+    uint32_t children = 0, n;
+    unsigned int rt = 1; // rt means return value
+    if (!offsets || !sorted) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    writer->nodes[node].guess = (uint32_t)mastermind_code_unrank(&opt->prefs, guess);
+    opt_partition(opt, guess, set, count, offsets, sorted);
+    for (n = 0; n < opt->classes; n++) {
+        uint32_t size = offsets[n + 1] - offsets[n], next;
+        unsigned int depth;
+        if (!size || n == opt->solved)
+            continue;
+        if (!children && !(children = writer->nodes[node].children = mmbook_writer_nodes(writer, opt->classes))) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        opt_search(opt, sorted + offsets[n], size, attempts - 1, MMOPT_INF, &next);
+        depth = 1 + opt_build(opt, writer, children + n, sorted + offsets[n], size, attempts - 1, next);
+        if (depth > rt)
+            rt = depth;
+    }
+    free(sorted);
+    free(offsets);
+    return rt;
+}
+
+int main(int argc, char *argv[]) {
+    static struct mmopt opt;
+    MASTERMIND_PREFERENCES prefs = { 4, 6, 7, false, true };
+    const char *book_path = MMBOOK_DEFAULT_PATH, *checkpoint_path = NULL;
+    char default_checkpoint[64], line[128];
+    struct mmbookwriter writer = { NULL, 0, 0, NULL, 0, 0 };
+    struct mmbookentry *entry;
+    MASTERMIND_BOOK *book;
+    struct mmoptguess *guesses;
+    uint32_t *set, *histogram, count = 0, guess_count, rank, best_guess = MMOPT_INF;
+    uint64_t best = MMOPT_INF;
+    unsigned int threads = 0, depth, n;
+    double start = mmtime_now();
+    for (n = 1; n < (unsigned int)argc; n++) {
+        const char *value = n + 1 < (unsigned int)argc ? argv[n + 1] : NULL;
+        if (!value)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--code-length") == 0)
+            prefs.code_length = atoi(value);
+        else if (strcmp(argv[n], "--color-count") == 0)
+            prefs.color_count = atoi(value);
+        else if (strcmp(argv[n], "--attempt-count") == 0)
+            prefs.attempt_count = atoi(value);
+        else if (strcmp(argv[n], "--multiple-colors") == 0)
+            prefs.multiple_colors = atoi(value) != 0;
+        else if (strcmp(argv[n], "--hints-position-based") == 0)
+            prefs.hints_position_based = atoi(value) != 0;
+        else if (strcmp(argv[n], "--threads") == 0)
+            threads = atoi(value);
+        else if (strcmp(argv[n], "--checkpoint") == 0)
+            checkpoint_path = value;
+        else if (strcmp(argv[n], "--book") == 0)
+            book_path = value;
+        else
+            return usage(argv[0]);
+        n++;
+    }
+    if (!mastermind_prefs_valid(&prefs))
+        return usage(argv[0]);
+    opt.prefs = prefs;
+    if (!mastermind_prefs_enumerable(&prefs)) {
+        fprintf(stderr, "the codes cannot be enumerated for an exact search\n");
+        return 1;
+    }
+    opt.code_count = mastermind_code_count(&prefs);
+    if (opt.code_count > MMOPT_MAX_CODES) {
+        fprintf(stderr, "%u codes are too many for an exact search (max. %u)\n", opt.code_count, MMOPT_MAX_CODES);
+        return 1;
+    }
+    opt.classes = mastermind_feedback_classes(&prefs);
+    opt.solved = mastermind_feedback_index(&prefs, prefs.hints_position_based ?
+        MMFEEDBACK_MAKE((1u << prefs.code_length) - 1, 0) : MMFEEDBACK_MAKE(prefs.code_length, 0));
+    // feedbacks except the solved one: all 3^n masks or all (blacks, whites) pairs, without (n - 1, 1)
+    opt.branching = prefs.hints_position_based ? opt.classes - 1 :
+        (prefs.code_length + 1) * (prefs.code_length + 2) / 2 - 2;
+    opt.thread_count = threads ? threads : mmthread_cpu_count();
+    opt.table = mastermind_scoretable_create(&prefs);
+    opt.hashes = malloc(opt.code_count * sizeof(uint64_t));
+    opt.checks = malloc(opt.code_count * sizeof(uint64_t));
+    opt.memo = calloc(MMOPT_MEMO_SIZE, sizeof(struct mmoptmemo));
+    set = malloc(opt.code_count * sizeof(uint32_t));
+    histogram = calloc(opt.classes, sizeof(uint32_t));
+    guesses = malloc(opt.code_count * sizeof(struct mmoptguess));
+    if (!opt.table || !opt.hashes || !opt.checks || !opt.memo || !set || !histogram || !guesses) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (n = 0; n < MMOPT_MEMO_LOCKS; n++)
+        mmmutex_init(&opt.locks[n]);
+    mmmutex_init(&opt.checkpoint_lock);
+    for (rank = 0; rank < opt.code_count; rank++) {
+        MMCODE code = mastermind_code_unrank(&prefs, rank);
+        unsigned int peg, used = 0;
+        bool valid = true;
+        opt.hashes[rank] = mastermind_mix64(2 * (uint64_t)rank);
+        opt.checks[rank] = mastermind_mix64(2 * (uint64_t)rank + 1);
+        for (peg = 0; peg < prefs.code_length && !prefs.multiple_colors; peg++, code >>= MMCODE_PEG_BITS) {
+            valid = valid && !(used >> (code & MMCODE_PEG_MASK) & 1);
+            used |= 1u << (code & MMCODE_PEG_MASK);
+        }
+        if (valid)
+            set[count++] = rank;
+    }
+    // the checkpoint starts with the preferences, then one line per solved partition or first guess
+    if (!checkpoint_path) {
+        snprintf(default_checkpoint, sizeof(default_checkpoint), "mmoptimal-%ux%u-a%u-m%d-p%d.ckpt",
+            prefs.code_length, prefs.color_count, prefs.attempt_count, prefs.multiple_colors, prefs.hints_position_based);
+        checkpoint_path = default_checkpoint;
+    }
+    if (!(opt.checkpoint = fopen(checkpoint_path, "a+"))) {
+        fprintf(stderr, "cannot open '%s'\n", checkpoint_path);
+        return 1;
+    }
+    rewind(opt.checkpoint);
+    snprintf(line, sizeof(line), "mmoptimal 1 %u %u %u %d %d\n", prefs.code_length,
+        prefs.color_count, prefs.attempt_count, prefs.multiple_colors, prefs.hints_position_based);
+    {
+        char first[128];
+        if (!fgets(first, sizeof(first), opt.checkpoint))
+            fputs(line, opt.checkpoint);
+        else if (strcmp(first, line) != 0) {
+            fprintf(stderr, "'%s' is the checkpoint of other preferences\n", checkpoint_path);
+            return 1;
+        }
+        else
+            fprintf(stderr, "continuing from '%s'\n", checkpoint_path);
+    }
+    fflush(opt.checkpoint);
+    guess_count = opt_rate(&opt, set, count, prefs.attempt_count, MMOPT_INF, true, histogram, guesses);
+    for (n = 0; n < guess_count && guesses[n].bound < best; n++) {
+        double guess_start = mmtime_now();
+        char code[MMPREFS_MAX_CODE_LENGTH + 1] = { 0 };
+        long long recorded = -2;
+        uint64_t cost;
+        // first guesses which are already rated
+        rewind(opt.checkpoint);
+        while (fgets(line, sizeof(line), opt.checkpoint)) {
+            unsigned int guess;
+            long long total;
+            if (sscanf(line, "guess %u %lld", &guess, &total) == 2 && guess == guesses[n].rank)
+                recorded = total;
+        }
+        if (recorded >= -1)
+            cost = recorded < 0 ? MMOPT_INF : (uint64_t)recorded;
+        else {
+            cost = opt_first_guess(&opt, set, count, &guesses[n], best, opt.checkpoint);
+            fseek(opt.checkpoint, 0, SEEK_END);
+            fprintf(opt.checkpoint, "guess %u %lld\n", guesses[n].rank, cost < MMOPT_INF ? (long long)cost : -1ll);
+            fflush(opt.checkpoint);
+        }
+        mastermind_code_unpack(&prefs, mastermind_code_unrank(&prefs, guesses[n].rank), code);
+        if (cost < best) {
+            best = cost;
+            best_guess = guesses[n].rank;
+        }
+        fprintf(stderr, "first guess %s: bound %llu, cost %s%llu, best %llu (%.1f s)\n", code,
+            (unsigned long long)guesses[n].bound, cost < MMOPT_INF ? "" : ">= ",
+            (unsigned long long)(cost < MMOPT_INF ? cost : best), (unsigned long long)best, mmtime_now() - guess_start);
+    }
+    if (best_guess == MMOPT_INF) {
+        fprintf(stderr, "no strategy solves every game within %u attempts\n", prefs.attempt_count);
+        return 1;
+    }
+    // the strategy goes into the book, the trees of the other preferences are kept
+    opt.abort = 0;
+    if ((book = mastermind_book_open(book_path)) && !mmbook_writer_import(&writer, book, &prefs)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    mastermind_book_close(book);
+    if (!(entry = mmbook_writer_entry(&writer, &prefs, 0)) || !(rank = mmbook_writer_nodes(&writer, 1))) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    entry->root = rank;
+    depth = opt_build(&opt, &writer, rank, set, count, prefs.attempt_count, best_guess);
+    writer.entries[writer.entry_count - 1].depth = depth;
+    if (!mmbook_writer_save(&writer, book_path)) {
+        fprintf(stderr, "cannot write '%s'\n", book_path);
+        return 1;
+    }
+    printf("optimal strategy: %llu guesses for %u codes, %.4f on average, max. %u guesses (%.1f s)\n",
+        (unsigned long long)best, count, (double)best / count, depth, mmtime_now() - start);
+    printf("written to '%s'\n", book_path);
+    mmbook_writer_free(&writer);
+    fclose(opt.checkpoint);
+    return 0;
+}
+
+
+
+// End of source file 'mmoptimal.c'
@@ -0,0 +1,276 @@
+/*!mmpropagate.c
+ * Constraint propagation of the COMSOLVER for game MasterMind (see mmpropagate.h).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * A guess peg with X fixes the color of its peg, any other guess peg rules
+ * its color out at its peg. The + of a color goes to its first pegs of the
+ * guess which are not X, as many as the secret code has pegs of that color
+ * which are not X. So if some pegs of a color got no +, the secret code has
+ * exactly (X + +) pegs of that color, otherwise at least that many. The
+ * propagation rules are: a color no peg may have anymore has at most that
+ * many pegs, a color which has reached its max. is removed from the other
+ * pegs, a color which needs all pegs it may have takes them, and the
+ * bounds of all colors must add up to code_length.
+ */
+
+#include "mastermind.h"
+#include "mmpropagate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// max. number of search nodes of a consistent code, far more than it ever needs
+#define MMPROPAGATE_NODES 4096
+// max. number of consistent codes the guess is selected from
+#define MMPROPAGATE_ELIGIBLE 32
+// searches for them stop after finding this many codes twice, there are probably no more
+#define MMPROPAGATE_REPEATS 4
+
+// colors every peg may have and bounds of the number of pegs of every color
+struct mmdomains {
+    uint32_t colors[MMPREFS_MAX_CODE_LENGTH]; // bit c = peg may have color c
+    unsigned char min[MMPREFS_MAX_COLOR_COUNT],
+        max[MMPREFS_MAX_COLOR_COUNT];
+};
+
+// state of the search for one game
+struct mmpropagate {
+    MASTERMIND_PREFERENCES prefs;
+    const MASTERMIND_SCORER *scorer; // kernels for prefs
+    MASTERMIND_RANDOM random;
+    struct mmdomains domains; // constraints of all feedbacks so far, at their fixed point
+    unsigned int applied, // number of feedbacks in domains
+        nodes, // search nodes left for the current code
+        eligible_count;
+    MMCODE eligible[MMPROPAGATE_ELIGIBLE]; // consistent codes the guess is selected from
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// counts the set bits of value
+static unsigned int nex_propagate_popcount(uint32_t value) {
+    unsigned int rt = 0; // rt means return value
+    for (; value; value &= value - 1)
+        rt++;
+    return rt;
+}
+// gets the color of a peg
+static unsigned int nex_propagate_peg(MMCODE code, unsigned int peg) {
+    return code >> (MMCODE_PEG_BITS * peg) & MMCODE_PEG_MASK;
+}
+// propagates the constraints until nothing changes, returns false if no code is consistent anymore
+static bool nex_propagate_fixpoint(const MASTERMIND_PREFERENCES *prefs, struct mmdomains *d) {
+    unsigned int n, c, length = prefs->code_length;
+    bool changed = true;
+    while (changed) {
+        unsigned int sum_min = 0, sum_max = 0,
+            possibles[MMPREFS_MAX_COLOR_COUNT] = { 0 }, // pegs which may have a color
+            fixeds[MMPREFS_MAX_COLOR_COUNT] = { 0 }; // pegs which have it for sure
+        changed = false;
+        for (n = 0; n < length; n++) {
+            uint32_t colors = d->colors[n];
+            if (!colors)
+                return false;
+            if (!(colors & (colors - 1)))
+                fixeds[__builtin_ctz(colors)]++;
+            for (; colors; colors &= colors - 1)
+                possibles[__builtin_ctz(colors)]++;
+        }
+        for (c = 0; c < prefs->color_count; c++) {
+            uint32_t bit = 1u << c;
+            unsigned int possible = possibles[c], fixed = fixeds[c];
+            if (possible < d->max[c])
+                d->max[c] = possible;
+            if (fixed > d->min[c])
+                d->min[c] = fixed;
+            if (d->min[c] > d->max[c])
+                return false;
+            if (fixed == d->max[c] && possible > fixed) { // all pegs of the color are known
+                for (n = 0; n < length; n++) {
+                    if (d->colors[n] != bit)
+                        d->colors[n] &= ~bit;
+                }
+                changed = true;
+            }
+            else if (possible == d->min[c] && fixed < possible) { // every peg which may have the color has it
+                for (n = 0; n < length; n++) {
+                    if (d->colors[n] & bit)
+                        d->colors[n] = bit;
+                }
+                changed = true;
+            }
+            sum_min += d->min[c];
+            sum_max += d->max[c];
+        }
+        if (sum_min > length || sum_max < length)
+            return false;
+        for (c = 0; c < prefs->color_count; c++) { // the other colors need or leave pegs
+            unsigned int max = length - (sum_min - d->min[c]), min = sum_max - d->max[c] < length ? length - (sum_max - d->max[c]) : 0;
+            if (max < d->max[c]) {
+                d->max[c] = max;
+                changed = true;
+            }
+            if (min > d->min[c]) {
+                d->min[c] = min;
+                changed = true;
+            }
+        }
+    }
+    for (n = 0; n < length; n++) { // the last changes may have emptied a peg
+        if (!d->colors[n])
+            return false;
+    }
+    return true;
+}
+// adds the constraints of the feedback of a guess
+static void nex_propagate_feedback(const MASTERMIND_PREFERENCES *prefs, struct mmdomains *d,
+    MMCODE guess, MMFEEDBACK feedback) {
+    unsigned int blacks[MMPREFS_MAX_COLOR_COUNT] = { 0 }, // X pegs of every color
+        others[MMPREFS_MAX_COLOR_COUNT] = { 0 }, // other pegs of every color
+        whites[MMPREFS_MAX_COLOR_COUNT] = { 0 }; // + pegs of every color
+    unsigned int n, c;
+    for (n = 0; n < prefs->code_length; n++) {
+        c = nex_propagate_peg(guess, n);
+        if (MMFEEDBACK_BLACKS(feedback) >> n & 1) {
+            d->colors[n] &= 1u << c;
+            blacks[c]++;
+        }
+        else {
+            d->colors[n] &= ~(1u << c);
+            others[c]++;
+            whites[c] += MMFEEDBACK_WHITES(feedback) >> n & 1;
+        }
+    }
+    for (c = 0; c < prefs->color_count; c++) {
+        if (blacks[c] + whites[c] > d->min[c])
+            d->min[c] = blacks[c] + whites[c];
+        if (whites[c] < others[c] && blacks[c] + whites[c] < d->max[c]) // a peg without + ran out of the color
+            d->max[c] = blacks[c] + whites[c];
+    }
+}
+// searches a code within the domains depth first, the colors of a peg are tried from a random one on
+static bool nex_propagate_search(struct mmpropagate *propagate, struct mmdomains *d, MMCODE *code) {
+    unsigned int n, c, peg = MMPREFS_MAX_CODE_LENGTH, size = MMPREFS_MAX_COLOR_COUNT + 1, start;
+    if (!propagate->nodes || !nex_propagate_fixpoint(&propagate->prefs, d))
+        return false;
+    propagate->nodes--;
+    for (n = 0; n < propagate->prefs.code_length; n++) { // the peg with the fewest colors left
+        unsigned int count = nex_propagate_popcount(d->colors[n]);
+        if (count > 1 && count < size) {
+            peg = n;
+            size = count;
+        }
+    }
+    if (peg == MMPREFS_MAX_CODE_LENGTH) { // every peg has one color left and the bounds hold
+        *code = 0;
+        for (n = 0; n < propagate->prefs.code_length; n++)
+            *code |= (MMCODE)__builtin_ctz(d->colors[n]) << (MMCODE_PEG_BITS * n);
+        return true;
+    }
+    start = mastermind_random_below(&propagate->random, propagate->prefs.color_count);
+    for (n = 0; n < propagate->prefs.color_count; n++) {
+        struct mmdomains next = *d;
+        c = (start + n) % propagate->prefs.color_count;
+        if (!(d->colors[peg] >> c & 1))
+            continue;
+        next.colors[peg] = 1u << c;
+        if (nex_propagate_search(propagate, &next, code))
+            return true;
+    }
+    return false;
+}
+// selects the consistent code which splits the others into the most partitions (first one on a tie)
+static MMCODE nex_propagate_select(struct mmpropagate *propagate) {
+    MMFEEDBACK scores[MMPROPAGATE_ELIGIBLE];
+    unsigned int n, m, best = 0, best_parts = 0;
+    for (n = 0; n < propagate->eligible_count && propagate->eligible_count > 2; n++) {
+        unsigned int parts = 0;
+        propagate->scorer->batch(&propagate->prefs, propagate->eligible[n], propagate->eligible, scores,
+            propagate->eligible_count);
+        for (m = 0; m < propagate->eligible_count; m++) { // counts the first code of every partition
+            unsigned int k;
+            for (k = 0; k < m && scores[k] != scores[m]; k++);
+            parts += k == m;
+        }
+        if (parts > best_parts) {
+            best = n;
+            best_parts = parts;
+        }
+    }
+    return propagate->eligible[best];
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+struct mmpropagate *mmpropagate_create(const MASTERMIND_PREFERENCES *prefs) {
+    struct mmpropagate *propagate = calloc(1, sizeof(struct mmpropagate));
+    if (!propagate)
+        return NULL;
+    propagate->prefs = *prefs;
+    propagate->scorer = mastermind_scorer(prefs);
+    mmpropagate_reset(propagate);
+    return propagate;
+}
+
+void mmpropagate_reset(struct mmpropagate *propagate) {
+    unsigned int n;
+    for (n = 0; n < propagate->prefs.code_length; n++)
+        propagate->domains.colors[n] = (1u << propagate->prefs.color_count) - 1;
+    for (n = 0; n < propagate->prefs.color_count; n++) {
+        propagate->domains.min[n] = 0;
+        propagate->domains.max[n] = propagate->prefs.multiple_colors ? propagate->prefs.code_length : 1;
+    }
+    propagate->applied = 0;
+}
+
+MMCODE mmpropagate_guess(struct mmpropagate *propagate, const MMCODE *guesses, const MMFEEDBACK *feedbacks,
+    unsigned int attempt) {
+    MMCODE rt = 0; // rt means return value
+    unsigned int n, m, repeats = 0;
+    uint64_t seed = propagate->prefs.seed;
+    // the search depends only on the game so far, not on the searches before (a replayed solver guesses the same)
+    for (n = 0; n < attempt; n++)
+        seed = mastermind_mix64(mastermind_mix64(seed ^ guesses[n]) ^ feedbacks[n]);
+    mastermind_random_seed(&propagate->random, seed);
+    for (; propagate->applied < attempt; propagate->applied++)
+        nex_propagate_feedback(&propagate->prefs, &propagate->domains,
+            guesses[propagate->applied], feedbacks[propagate->applied]);
+    nex_propagate_fixpoint(&propagate->prefs, &propagate->domains);
+    propagate->eligible_count = 0;
+    while (propagate->eligible_count < MMPROPAGATE_ELIGIBLE && repeats < MMPROPAGATE_REPEATS) {
+        struct mmdomains search = propagate->domains;
+        propagate->nodes = MMPROPAGATE_NODES;
+        if (!nex_propagate_search(propagate, &search, &rt))
+            break;
+        for (m = 0; m < propagate->eligible_count && propagate->eligible[m] != rt; m++);
+        if (m == propagate->eligible_count)
+            propagate->eligible[propagate->eligible_count++] = rt;
+        else
+            repeats++;
+    }
+    if (propagate->eligible_count)
+        return nex_propagate_select(propagate);
+    // out of nodes (or the feedbacks contradict each other): any color left at every peg
+    for (rt = 0, n = 0; n < propagate->prefs.code_length; n++) {
+        if (propagate->domains.colors[n])
+            rt |= (MMCODE)__builtin_ctz(propagate->domains.colors[n]) << (MMCODE_PEG_BITS * n);
+    }
+    return rt;
+}
+
+void mmpropagate_destroy(struct mmpropagate *propagate) {
+    free(propagate);
+}
+
+
+
+// End of source file 'mmpropagate.c'
@@ -0,0 +1,40 @@
+/*!mmpropagate.h
+ * Constraint propagation of the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Position based hints tell exactly which pegs are right (X) and which
+ * colors are somewhere else (+). Together they are the same as a set of
+ * colors every peg may still have and bounds of the number of pegs of every
+ * color, so the codes consistent with all feedbacks so far are described by
+ * a few bitmasks instead of a candidate set. mmsolver.c hands every guess to
+ * this search beyond enumeration (and with MMSTRATEGY_PROPAGATE): the
+ * constraints are propagated to a fixed point after every feedback, a few
+ * consistent codes are searched depth first within the remaining domains
+ * and the one which splits the others into the most partitions is guessed.
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMPROPAGATE_H
+#define MMPROPAGATE_H
+
+#include "mastermind.h"
+
+// state of the search for one game
+struct mmpropagate;
+
+// creates a search for games with prefs (position based hints only), returns NULL if out of memory
+struct mmpropagate *mmpropagate_create(const MASTERMIND_PREFERENCES *prefs);
+// starts a new game: every code is possible
+void mmpropagate_reset(struct mmpropagate *propagate);
+// adds the feedbacks since the last call and selects a consistent code as the next guess, the search is seeded
+// with prefs.seed and the guesses and feedbacks so far
+MMCODE mmpropagate_guess(struct mmpropagate *propagate, const MMCODE *guesses, const MMFEEDBACK *feedbacks,
+    unsigned int attempt);
+// frees a search, may be NULL
+void mmpropagate_destroy(struct mmpropagate *propagate);
+
+// end of MMPROPAGATE_H include guard
+#endif
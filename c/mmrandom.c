@@ -0,0 +1,142 @@
+/*!mmrandom.c
+ * Pseudo random generator and secret codes for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * A secret code needs a single 32 bit draw x: Lemire's method makes
+ * floor(x * N / 2^32) uniform over the N valid codes, and the digits of
+ * that index (one color or swap position per peg) are taken off x with one
+ * multiplication each. Codes without repeated colors are a partial
+ * Fisher-Yates shuffle of the colors, so no draw is ever retried for a
+ * repeated color.
+ */
+
+#include "mastermind.h"
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// rotates a 64 bit value left
+static uint64_t nex_rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+// gets the number of valid codes of prefs, 0 if there are more than UINT32_MAX
+static uint32_t nex_random_total(const MASTERMIND_PREFERENCES *prefs) {
+    uint64_t rt = 1; // rt means return value
+    unsigned int n;
+    for (n = 0; n < prefs->code_length && rt <= UINT32_MAX; n++)
+        rt *= prefs->multiple_colors ? prefs->color_count : prefs->color_count - n;
+    return rt <= UINT32_MAX ? (uint32_t)rt : 0;
+}
+// draws x so that floor(x * total / 2^32) is uniform below total,
+// threshold = 2^32 mod total (Lemire's nearly divisionless method)
+static uint32_t nex_random_draw(MASTERMIND_RANDOM *random, uint32_t total, uint32_t threshold) {
+    uint32_t rt; // rt means return value
+    do rt = (uint32_t)(mastermind_random_next(random) >> 32);
+    while ((uint32_t)((uint64_t)rt * total) < threshold);
+    return rt;
+}
+// creates the code of a draw of nex_random_draw() with total = nex_random_total(prefs)
+static MMCODE nex_random_decode(const MASTERMIND_PREFERENCES *prefs, uint32_t x) {
+    MMCODE rt = 0; // rt means return value
+    unsigned int n;
+    if (prefs->multiple_colors) {
+        for (n = 0; n < prefs->code_length; n++) {
+            uint64_t product = (uint64_t)x * prefs->color_count;
+            rt |= (MMCODE)(product >> 32) << (MMCODE_PEG_BITS * n);
+            x = (uint32_t)product;
+        }
+    }
+    else { // partial Fisher-Yates shuffle, peg n takes one of the colors not used yet
+        unsigned char colors[MMPREFS_MAX_COLOR_COUNT];
+        for (n = 0; n < prefs->color_count; n++)
+            colors[n] = n;
+        for (n = 0; n < prefs->code_length; n++) {
+            uint64_t product = (uint64_t)x * (prefs->color_count - n);
+            unsigned int pick = n + (unsigned int)(product >> 32);
+            unsigned char color = colors[pick];
+            colors[pick] = colors[n];
+            colors[n] = color;
+            rt |= (MMCODE)color << (MMCODE_PEG_BITS * n);
+            x = (uint32_t)product;
+        }
+    }
+    return rt;
+}
+// creates a code with one draw per peg, for more codes than one draw can cover
+static MMCODE nex_random_pegs(const MASTERMIND_PREFERENCES *prefs, MASTERMIND_RANDOM *random) {
+    unsigned char colors[MMPREFS_MAX_COLOR_COUNT];
+    MMCODE rt = 0; // rt means return value
+    unsigned int n;
+    for (n = 0; n < prefs->color_count; n++)
+        colors[n] = n;
+    for (n = 0; n < prefs->code_length; n++) {
+        if (prefs->multiple_colors)
+            rt |= (MMCODE)mastermind_random_below(random, prefs->color_count) << (MMCODE_PEG_BITS * n);
+        else { // partial Fisher-Yates shuffle like nex_random_decode()
+            unsigned int pick = n + mastermind_random_below(random, prefs->color_count - n);
+            unsigned char color = colors[pick];
+            colors[pick] = colors[n];
+            colors[n] = color;
+            rt |= (MMCODE)color << (MMCODE_PEG_BITS * n);
+        }
+    }
+    return rt;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+void mastermind_random_seed(MASTERMIND_RANDOM *random, uint64_t seed) {
+    int n;
+    for (n = 0; n < 4; n++, seed += 0x9E3779B97F4A7C15ull) // splitmix64, never gives four zeros
+        random->state[n] = mastermind_mix64(seed);
+}
+
+uint64_t mastermind_random_next(MASTERMIND_RANDOM *random) {
+    uint64_t *s = random->state;
+    uint64_t rt = nex_rotl(s[1] * 5, 7) * 9, t = s[1] << 17; // rt means return value
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = nex_rotl(s[3], 45);
+    return rt;
+}
+
+uint32_t mastermind_random_below(MASTERMIND_RANDOM *random, uint32_t bound) {
+    uint32_t x = nex_random_draw(random, bound, (uint32_t)-bound % bound);
+    return (uint32_t)(((uint64_t)x * bound) >> 32);
+}
+
+MMCODE mastermind_random_code(const MASTERMIND_PREFERENCES *prefs, MASTERMIND_RANDOM *random) {
+    uint32_t total = nex_random_total(prefs);
+    if (!total)
+        return nex_random_pegs(prefs, random);
+    return nex_random_decode(prefs, nex_random_draw(random, total, (uint32_t)-total % total));
+}
+
+void mastermind_random_codes(const MASTERMIND_PREFERENCES *prefs, MASTERMIND_RANDOM *random,
+    MMCODE *codes, size_t count) {
+    uint32_t total = nex_random_total(prefs), threshold;
+    size_t n;
+    if (!total) {
+        for (n = 0; n < count; n++)
+            codes[n] = nex_random_pegs(prefs, random);
+        return;
+    }
+    threshold = (uint32_t)-total % total;
+    for (n = 0; n < count; n++)
+        codes[n] = nex_random_decode(prefs, nex_random_draw(random, total, threshold));
+}
+
+
+
+// End of source file 'mmrandom.c'
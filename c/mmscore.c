@@ -0,0 +1,435 @@
+/*!mmscore.c
+ * Scoring of codes for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * The kernels below take the code length and the kind of hints as
+ * parameters. MMSCORE_KERNELS() instantiates them for every code length
+ * with both kinds of hints as constants, so the compiler unrolls all loops
+ * over the pegs, and mastermind_scorer() hands out the instance for the
+ * preferences of a game. The color count needs no instances: the colors
+ * are counted in byte lanes (or vector lanes) without a loop over them.
+ * The generic instance with runtime parameters remains for preferences
+ * without an instance and for builds with MMSCORE_GENERIC defined.
+ *
+ * Codes of up to 8 pegs fit into 32 bits, so the vector path scores them
+ * in 32 bit lanes; longer codes are scored one after another.
+ */
+
+#include "mastermind.h"
+#include "mmstats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// the vector path uses GCC/Clang vector extensions, which compile to SSE2
+// on every x86 CPU and to AVX2 where the CPU supports it (checked at runtime)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define __mmscoresimd__ 1
+#endif
+
+// kernels called with constant parameters must be inlined to be specialized
+#if defined(__GNUC__)
+    #define MMSCORE_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+    #define MMSCORE_INLINE __forceinline
+#else
+    #define MMSCORE_INLINE inline
+#endif
+
+// one bit (the lowest) of every peg of a code with MMPREFS_MAX_CODE_LENGTH pegs
+#define MMCODE_LOW_BITS 0x1111111111111111ull
+// max. code length of the vector path (32 bit lanes)
+#define MMSCORE_VEC_MAX_CODE_LENGTH 8
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// counts the set bits of value
+static unsigned int nex_popcount(uint64_t value) {
+    #if defined(__GNUC__)
+    return __builtin_popcountll(value);
+    #else
+    unsigned int rt = 0; // rt means return value
+    for (; value; value &= value - 1)
+        rt++;
+    return rt;
+    #endif
+}
+// gets the lowest bit of every peg of a code with code_length pegs (1 - 16)
+static MMCODE nex_lowbits(unsigned int code_length) {
+    return MMCODE_LOW_BITS >> (MMCODE_PEG_BITS * (MMPREFS_MAX_CODE_LENGTH - code_length));
+}
+// gets the color counts of a code, one byte per color: colors 0 - 7 in counts[0], 8 - 15 in counts[1]
+static MMSCORE_INLINE void nex_colorcounts(unsigned int code_length, MMCODE code, uint64_t *counts) {
+    unsigned int n;
+    counts[0] = counts[1] = 0;
+    for (n = 0; n < code_length; n++, code >>= MMCODE_PEG_BITS)
+        counts[code >> 3 & 1] += 1ull << (8 * (code & 7));
+}
+// sums up min(a, b) of every byte of the color counts a and b
+static unsigned int nex_colorcounts_minsum(uint64_t a, uint64_t b) {
+    const uint64_t high = 0x8080808080808080ull;
+    // counts are <= 16, so the high bit of each byte survives exactly if a >= b
+    uint64_t ge = (((a | high) - b) & high) >> 7;
+    ge *= 0xFF;
+    return (unsigned int)((((b & ge) | (a & ~ge)) * 0x0101010101010101ull) >> 56);
+}
+// scores guess against secret, the actual kernel behind every scorer
+static MMSCORE_INLINE MMFEEDBACK nex_score(unsigned int code_length, bool position_based, MMCODE guess, MMCODE secret) {
+    MMCODE x = guess ^ secret;
+    // a peg matches if all of its bits are equal, so fold every peg into its lowest bit
+    x = ~(x | x >> 1 | x >> 2 | x >> 3) & nex_lowbits(code_length);
+    if (!position_based) { // counts only: whites are sum of min(color counts) - blacks
+        uint64_t a[2], b[2];
+        unsigned int blacks = nex_popcount(x), whites;
+        nex_colorcounts(code_length, guess, a);
+        nex_colorcounts(code_length, secret, b);
+        whites = nex_colorcounts_minsum(a[0], b[0]) + nex_colorcounts_minsum(a[1], b[1]) - blacks;
+        return MMFEEDBACK_MAKE(blacks, whites);
+    }
+    // position based: the + goes to the first unmatched peg of the guess with that color
+    unsigned char avail[1 << MMCODE_PEG_BITS] = { 0 };
+    unsigned int n, blacks = 0, whites = 0;
+    for (n = 0; n < code_length; n++) {
+        if (x >> (MMCODE_PEG_BITS * n) & 1)
+            blacks |= 1u << n;
+        else
+            avail[secret >> (MMCODE_PEG_BITS * n) & MMCODE_PEG_MASK]++;
+    }
+    for (n = 0; n < code_length; n++) {
+        unsigned int color = guess >> (MMCODE_PEG_BITS * n) & MMCODE_PEG_MASK;
+        if (!(blacks >> n & 1) && avail[color]) {
+            avail[color]--;
+            whites |= 1u << n;
+        }
+    }
+    return MMFEEDBACK_MAKE(blacks, whites);
+}
+
+#if defined(__mmscoresimd__)
+typedef uint64_t nex_vec8q __attribute__((vector_size(64)));
+typedef uint32_t nex_vec8u __attribute__((vector_size(32)));
+typedef int32_t nex_vec8i __attribute__((vector_size(32)));
+
+// scores guess against 8 codes of at most MMSCORE_VEC_MAX_CODE_LENGTH pegs at once,
+// inlined into the SSE and AVX2 batch loops
+static MMSCORE_INLINE void nex_score_vec8(unsigned int code_length,
+    bool position_based, MMCODE guess, const MMCODE *secrets, MMFEEDBACK *out) {
+    nex_vec8q wide;
+    nex_vec8u s, x, blacks = { 0 }, whites = { 0 };
+    nex_vec8i avail[MMSCORE_VEC_MAX_CODE_LENGTH];
+    unsigned int colors[MMSCORE_VEC_MAX_CODE_LENGTH], color_idx[MMSCORE_VEC_MAX_CODE_LENGTH];
+    unsigned int n, m, color_count = 0;
+    memcpy(&wide, secrets, sizeof(wide));
+    s = __builtin_convertvector(wide, nex_vec8u); // the codes fit into the low 32 bits
+    x = s ^ (uint32_t)guess;
+    x = ~(x | x >> 1 | x >> 2 | x >> 3) & (uint32_t)nex_lowbits(code_length);
+    // distinct colors of the guess, only these can produce whites
+    for (n = 0; n < code_length; n++) {
+        unsigned int color = guess >> (MMCODE_PEG_BITS * n) & MMCODE_PEG_MASK;
+        for (m = 0; m < color_count && colors[m] != color; m++);
+        if (m == color_count)
+            colors[color_count++] = color;
+        color_idx[n] = m;
+    }
+    for (m = 0; m < color_count; m++)
+        avail[m] = (nex_vec8i){ 0 };
+    // count the colors of the unmatched pegs of the codes (comparisons give -1 for true)
+    for (n = 0; n < code_length; n++) {
+        nex_vec8u peg = s >> (MMCODE_PEG_BITS * n) & MMCODE_PEG_MASK;
+        nex_vec8i unmatched = (nex_vec8i)((x >> (MMCODE_PEG_BITS * n) & 1) == 0);
+        for (m = 0; m < color_count; m++)
+            avail[m] += (peg == colors[m]) & unmatched;
+    }
+    // the counts are negative, hand out the whites in order of the guess positions
+    for (n = 0; n < code_length; n++) {
+        nex_vec8u matched = x >> (MMCODE_PEG_BITS * n) & 1;
+        nex_vec8i white = (nex_vec8i)(matched == 0) & (avail[color_idx[n]] < 0);
+        avail[color_idx[n]] -= white;
+        if (position_based) {
+            blacks |= matched << n;
+            whites |= (nex_vec8u)white & (1u << n);
+        }
+        else {
+            blacks += matched;
+            whites -= (nex_vec8u)white;
+        }
+    }
+    for (n = 0; n < 8; n++)
+        out[n] = MMFEEDBACK_MAKE(blacks[n], whites[n]);
+}
+#endif
+// scores guess against count codes, inlined into the batch function of every scorer
+static MMSCORE_INLINE void nex_score_loop(unsigned int code_length,
+    bool position_based, MMCODE guess, const MMCODE *secrets, MMFEEDBACK *out, size_t count) {
+    size_t i = 0;
+    #if defined(__mmscoresimd__)
+    for (; code_length <= MMSCORE_VEC_MAX_CODE_LENGTH && i + 8 <= count; i += 8)
+        nex_score_vec8(code_length, position_based, guess, secrets + i, out + i);
+    #endif
+    for (; i < count; i++)
+        out[i] = nex_score(code_length, position_based, guess, secrets[i]);
+}
+// checks once if the CPU supports AVX2
+static bool nex_has_avx2(void) {
+    #if defined(__mmscoresimd__)
+    static int rt = -1; // rt means return value
+    if (rt < 0) {
+        __builtin_cpu_init();
+        rt = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return rt;
+    #else
+    return false;
+    #endif
+}
+
+// the generic scorer, parameters are read from prefs
+static MMFEEDBACK nex_score_generic(const MASTERMIND_PREFERENCES *prefs, MMCODE guess, MMCODE secret) {
+    return nex_score(prefs->code_length, prefs->hints_position_based, guess, secret);
+}
+static void nex_batch_generic(const MASTERMIND_PREFERENCES *prefs, MMCODE guess,
+    const MMCODE *secrets, MMFEEDBACK *out, size_t count) {
+    MMSTATS_START(timer);
+    nex_score_loop(prefs->code_length, prefs->hints_position_based, guess, secrets, out, count);
+    MMSTATS_STOP(MMSTATS_SCORE, timer);
+}
+
+// defines the scorer of code length L and position based hints P (0 or 1)
+#define MMSCORE_KERNELS(L, P) \
+    static MMFEEDBACK nex_score_##L##_##P(const MASTERMIND_PREFERENCES *prefs, MMCODE guess, MMCODE secret) { \
+        (void)prefs; \
+        return nex_score(L, P, guess, secret); \
+    } \
+    static void nex_batch_##L##_##P(const MASTERMIND_PREFERENCES *prefs, MMCODE guess, \
+        const MMCODE *secrets, MMFEEDBACK *out, size_t count) { \
+        MMSTATS_START(timer); \
+        (void)prefs; \
+        nex_score_loop(L, P, guess, secrets, out, count); \
+        MMSTATS_STOP(MMSTATS_SCORE, timer); \
+    } \
+    MMSCORE_KERNELS_AVX2(L, P)
+#if defined(__mmscoresimd__)
+    // the same batch loop compiled for CPUs with AVX2
+    #define MMSCORE_KERNELS_AVX2(L, P) \
+        __attribute__((target("avx2"))) static void nex_batch_avx2_##L##_##P(const MASTERMIND_PREFERENCES *prefs, \
+            MMCODE guess, const MMCODE *secrets, MMFEEDBACK *out, size_t count) { \
+            MMSTATS_START(timer); \
+            (void)prefs; \
+            nex_score_loop(L, P, guess, secrets, out, count); \
+            MMSTATS_STOP(MMSTATS_SCORE, timer); \
+        }
+    __attribute__((target("avx2"))) static void nex_batch_avx2_generic(const MASTERMIND_PREFERENCES *prefs,
+        MMCODE guess, const MMCODE *secrets, MMFEEDBACK *out, size_t count) {
+        MMSTATS_START(timer);
+        nex_score_loop(prefs->code_length, prefs->hints_position_based, guess, secrets, out, count);
+        MMSTATS_STOP(MMSTATS_SCORE, timer);
+    }
+#else
+    #define MMSCORE_KERNELS_AVX2(L, P)
+#endif
+// calls X(L, P) for every valid code length
+#define MMSCORE_LENGTHS(X, P) X(2, P) X(3, P) X(4, P) X(5, P) X(6, P) X(7, P) X(8, P) \
+    X(9, P) X(10, P) X(11, P) X(12, P) X(13, P) X(14, P) X(15, P) X(16, P)
+
+MMSCORE_LENGTHS(MMSCORE_KERNELS, 0)
+MMSCORE_LENGTHS(MMSCORE_KERNELS, 1)
+
+// table entries of the scorers, indexed by code length
+#define MMSCORE_ENTRY(L, P) [L] = { nex_score_##L##_##P, nex_batch_##L##_##P, #L "/" #P },
+#define MMSCORE_ENTRY_AVX2(L, P) [L] = { nex_score_##L##_##P, nex_batch_avx2_##L##_##P, #L "/" #P "/avx2" },
+
+// scorers by hints_position_based and code_length
+static const MASTERMIND_SCORER scorers[2][MMPREFS_MAX_CODE_LENGTH + 1] = {
+    { MMSCORE_LENGTHS(MMSCORE_ENTRY, 0) },
+    { MMSCORE_LENGTHS(MMSCORE_ENTRY, 1) }
+};
+static const MASTERMIND_SCORER scorer_generic = { nex_score_generic, nex_batch_generic, "generic" };
+#if defined(__mmscoresimd__)
+static const MASTERMIND_SCORER scorers_avx2[2][MMPREFS_MAX_CODE_LENGTH + 1] = {
+    { MMSCORE_LENGTHS(MMSCORE_ENTRY_AVX2, 0) },
+    { MMSCORE_LENGTHS(MMSCORE_ENTRY_AVX2, 1) }
+};
+static const MASTERMIND_SCORER scorer_generic_avx2 = { nex_score_generic, nex_batch_avx2_generic, "generic/avx2" };
+#endif
+
+// sums up 3^n of every set bit n of mask (base-3 digit 1 at every set position)
+static unsigned int nex_pow3bits(uint32_t mask) {
+    unsigned int rt = 0, pow3 = 1; // rt means return value
+    for (; mask; mask >>= 1, pow3 *= 3) {
+        if (mask & 1)
+            rt += pow3;
+    }
+    return rt;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+bool mastermind_prefs_valid(const MASTERMIND_PREFERENCES *prefs) {
+    return 
+        !(prefs->code_length < MMPREFS_MIN_CODE_LENGTH || prefs->code_length > MMPREFS_MAX_CODE_LENGTH ||
+        prefs->color_count < MMPREFS_MIN_COLOR_COUNT || prefs->color_count > MMPREFS_MAX_COLOR_COUNT ||
+        prefs->attempt_count < MMPREFS_MIN_ATTEMPT_COUNT || prefs->attempt_count > MMPREFS_MAX_ATTEMPT_COUNT ||
+        (prefs->color_count < prefs->code_length && !prefs->multiple_colors));
+}
+
+bool mastermind_prefs_enumerable(const MASTERMIND_PREFERENCES *prefs) {
+    uint64_t count = 1; // at most 16 ^ 8
+    unsigned int n;
+    if (prefs->code_length > MMPREFS_ENUM_MAX_CODE_LENGTH)
+        return false;
+    for (n = 0; n < prefs->code_length; n++)
+        count *= prefs->color_count;
+    return count <= MMPREFS_ENUM_MAX_CODES;
+}
+
+MMCODE mastermind_code_pack(const MASTERMIND_PREFERENCES *prefs, const char *code) {
+    MMCODE rt = 0; // rt means return value
+    unsigned int n;
+    for (n = 0; n < prefs->code_length; n++)
+        rt |= (MMCODE)((code[n] - 'a') & MMCODE_PEG_MASK) << (MMCODE_PEG_BITS * n);
+    return rt;
+}
+
+void mastermind_code_unpack(const MASTERMIND_PREFERENCES *prefs, MMCODE code, char *out) {
+    unsigned int n;
+    for (n = 0; n < prefs->code_length; n++, code >>= MMCODE_PEG_BITS)
+        out[n] = 'a' + (code & MMCODE_PEG_MASK);
+}
+
+const MASTERMIND_SCORER *mastermind_scorer(const MASTERMIND_PREFERENCES *prefs) {
+    bool specialized = prefs->code_length >= MMPREFS_MIN_CODE_LENGTH && prefs->code_length <= MMPREFS_MAX_CODE_LENGTH;
+    #if defined(MMSCORE_GENERIC)
+    specialized = false;
+    #endif
+    #if defined(__mmscoresimd__)
+    if (nex_has_avx2())
+        return specialized ? &scorers_avx2[prefs->hints_position_based][prefs->code_length] : &scorer_generic_avx2;
+    #endif
+    return specialized ? &scorers[prefs->hints_position_based][prefs->code_length] : &scorer_generic;
+}
+
+MMFEEDBACK mastermind_score(const MASTERMIND_PREFERENCES *prefs, MMCODE guess, MMCODE secret) {
+    // a single score is not worth the lookup of the kernels and an indirect call
+    return nex_score(prefs->code_length, prefs->hints_position_based, guess, secret);
+}
+
+void mastermind_score_batch(const MASTERMIND_PREFERENCES *prefs, MMCODE guess,
+    const MMCODE *secrets, MMFEEDBACK *out, size_t count) {
+    mastermind_scorer(prefs)->batch(prefs, guess, secrets, out, count);
+}
+
+unsigned int mastermind_feedback_blacks(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK feedback) {
+    return prefs->hints_position_based ?
+        nex_popcount(MMFEEDBACK_BLACKS(feedback)) : MMFEEDBACK_BLACKS(feedback);
+}
+
+unsigned int mastermind_feedback_whites(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK feedback) {
+    return prefs->hints_position_based ?
+        nex_popcount(MMFEEDBACK_WHITES(feedback)) : MMFEEDBACK_WHITES(feedback);
+}
+
+
+unsigned int mastermind_feedback_classes(const MASTERMIND_PREFERENCES *prefs) {
+    if (prefs->hints_position_based)
+        return nex_pow3bits((1u << prefs->code_length) - 1) * 2 + 1; // 3^code_length
+    return (prefs->code_length + 1) * (prefs->code_length + 1);
+}
+
+unsigned int mastermind_feedback_index(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK feedback) {
+    if (prefs->hints_position_based) // base-3 digits: '.' = 0, 'X' = 1, '+' = 2
+        return nex_pow3bits(MMFEEDBACK_BLACKS(feedback)) + 2 * nex_pow3bits(MMFEEDBACK_WHITES(feedback));
+    return MMFEEDBACK_BLACKS(feedback) * (prefs->code_length + 1) + MMFEEDBACK_WHITES(feedback);
+}
+
+MMFEEDBACK mastermind_feedback_from_index(const MASTERMIND_PREFERENCES *prefs, unsigned int index) {
+    unsigned int n, blacks = 0, whites = 0;
+    if (!prefs->hints_position_based)
+        return MMFEEDBACK_MAKE(index / (prefs->code_length + 1), index % (prefs->code_length + 1));
+    for (n = 0; n < prefs->code_length; n++, index /= 3) {
+        if (index % 3 == 1)
+            blacks |= 1u << n;
+        else if (index % 3 == 2)
+            whites |= 1u << n;
+    }
+    return MMFEEDBACK_MAKE(blacks, whites);
+}
+
+uint32_t mastermind_code_count(const MASTERMIND_PREFERENCES *prefs) {
+    uint32_t rt = 1; // rt means return value
+    unsigned int n;
+    for (n = 0; n < prefs->code_length; n++)
+        rt *= prefs->color_count;
+    return rt;
+}
+
+uint32_t mastermind_code_rank(const MASTERMIND_PREFERENCES *prefs, MMCODE code) {
+    uint32_t rt = 0; // rt means return value
+    int n;
+    for (n = prefs->code_length - 1; n >= 0; n--)
+        rt = rt * prefs->color_count + (code >> (MMCODE_PEG_BITS * n) & MMCODE_PEG_MASK);
+    return rt;
+}
+
+MMCODE mastermind_code_unrank(const MASTERMIND_PREFERENCES *prefs, uint32_t rank) {
+    MMCODE rt = 0; // rt means return value
+    unsigned int n;
+    for (n = 0; n < prefs->code_length; n++, rank /= prefs->color_count)
+        rt |= (MMCODE)(rank % prefs->color_count) << (MMCODE_PEG_BITS * n);
+    return rt;
+}
+
+MASTERMIND_SCORETABLE *mastermind_scoretable_create(const MASTERMIND_PREFERENCES *prefs) {
+    MASTERMIND_SCORETABLE *table = malloc(sizeof(MASTERMIND_SCORETABLE));
+    size_t limit = prefs->scoretable_limit ? prefs->scoretable_limit : MMSCORETABLE_DEFAULT_LIMIT;
+    if (!table)
+        return NULL;
+    table->prefs = *prefs;
+    table->code_count = 0;
+    table->feedback = NULL;
+    if (!mastermind_prefs_enumerable(prefs))
+        return table;
+    table->code_count = mastermind_code_count(prefs);
+    // one byte per pair: stay empty if the indices don't fit or the cap is exceeded
+    if (mastermind_feedback_classes(prefs) > 256 ||
+        (uint64_t)table->code_count * table->code_count > limit)
+        return table;
+    MMCODE *codes = malloc(table->code_count * sizeof(MMCODE));
+    MMFEEDBACK *row = malloc(table->code_count * sizeof(MMFEEDBACK));
+    table->feedback = malloc((size_t)table->code_count * table->code_count);
+    if (codes && row && table->feedback) {
+        uint32_t g, s;
+        for (s = 0; s < table->code_count; s++)
+            codes[s] = mastermind_code_unrank(prefs, s);
+        for (g = 0; g < table->code_count; g++) {
+            uint8_t *dst = table->feedback + (size_t)g * table->code_count;
+            mastermind_score_batch(prefs, codes[g], codes, row, table->code_count);
+            for (s = 0; s < table->code_count; s++)
+                dst[s] = mastermind_feedback_index(prefs, row[s]);
+        }
+    }
+    else { // not enough memory, fall back to computing
+        free(table->feedback);
+        table->feedback = NULL;
+    }
+    free(codes);
+    free(row);
+    return table;
+}
+
+void mastermind_scoretable_destroy(MASTERMIND_SCORETABLE *table) {
+    if (!table)
+        return;
+    free(table->feedback);
+    free(table);
+}
+
+// End of source file 'mmscore.c'
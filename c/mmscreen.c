@@ -0,0 +1,192 @@
+/*!mmscreen.c
+ * Off-screen frame buffer of the user interface for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mastermind.h"
+#include "mmscreen.h"
+#include "mmscript.h"
+#include "mmstats.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+// state of the screen, there is only one terminal
+struct mmscreen {
+    struct mmcell cells[MMSCREEN_HEIGHT][MMSCREEN_WIDTH], // the frame being drawn
+        shown[MMSCREEN_HEIGHT][MMSCREEN_WIDTH]; // the frame on the terminal
+    int origin_x, origin_y, // terminal position of cell (0, 0)
+        cursor_x, cursor_y; // relative to the origin
+    unsigned char color;
+    bool ready; // false until the buffers are initialized
+    const struct mmterminal *terminal; // NULL while closed
+    struct mmscript *script; // source of the keys, NULL = terminal
+};
+
+static struct mmscreen screen;
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// fills both buffers with blanks, the terminal is expected to be blank as well
+static void nex_screen_init(void) {
+    int x, y;
+    for (y = 0; y < MMSCREEN_HEIGHT; y++) {
+        for (x = 0; x < MMSCREEN_WIDTH; x++) {
+            screen.cells[y][x].ch = screen.shown[y][x].ch = ' ';
+            screen.cells[y][x].color = screen.shown[y][x].color = 0x0F;
+        }
+    }
+    screen.color = 0x0F;
+    screen.ready = true;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+const struct mmterminal *mmscreen_find(const char *name) {
+    int n;
+    if (!name)
+        return mmterminals[0];
+    for (n = 0; mmterminals[n]; n++) {
+        if (strcmp(mmterminals[n]->name, name) == 0)
+            return mmterminals[n];
+    }
+    return NULL;
+}
+
+bool mmscreen_open(const struct mmterminal *terminal, const char *capture) {
+    if (screen.terminal || (capture && !terminal->capture) ||
+        !terminal->open(capture, &screen.origin_x, &screen.origin_y))
+        return false;
+    nex_screen_init(); // the terminal is cleared (or the widget starts on a new line)
+    screen.cursor_x = screen.cursor_y = 0;
+    screen.terminal = terminal;
+    return true;
+}
+
+void mmscreen_close(void) {
+    if (!screen.terminal)
+        return;
+    mmscreen_present();
+    screen.terminal->close();
+    screen.terminal = NULL;
+}
+
+void mmscreen_input(struct mmscript *script) {
+    screen.script = script;
+}
+
+void mmscreen_getcursor(int *x, int *y) {
+    *x = screen.origin_x + screen.cursor_x;
+    *y = screen.origin_y + screen.cursor_y;
+}
+
+void mmscreen_move(int column, int row) {
+    screen.cursor_x = column - screen.origin_x;
+    screen.cursor_y = row - screen.origin_y;
+}
+
+void mmscreen_setcolor(int color) {
+    screen.color = (unsigned char)color;
+}
+
+void mmscreen_putchar(int c) {
+    if (!screen.ready)
+        nex_screen_init();
+    if (c == '\n') {
+        screen.cursor_x = 0;
+        screen.cursor_y++;
+    }
+    else if (c == '\r')
+        screen.cursor_x = 0;
+    else if (c == '\b') {
+        if (screen.cursor_x > 0)
+            screen.cursor_x--;
+    }
+    else {
+        if (screen.cursor_x >= 0 && screen.cursor_x < MMSCREEN_WIDTH &&
+            screen.cursor_y >= 0 && screen.cursor_y < MMSCREEN_HEIGHT) {
+            screen.cells[screen.cursor_y][screen.cursor_x].ch = (char)c;
+            screen.cells[screen.cursor_y][screen.cursor_x].color = screen.color;
+        }
+        screen.cursor_x++;
+    }
+}
+
+void mmscreen_printf(const char *format, ...) {
+    char text[256];
+    va_list args;
+    int n, length;
+    va_start(args, format);
+    length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length > (int)sizeof(text) - 1)
+        length = sizeof(text) - 1;
+    for (n = 0; n < length; n++)
+        mmscreen_putchar((unsigned char)text[n]);
+}
+
+size_t mmscreen_present(void) {
+    size_t rt = 0, bytes; // rt means return value
+    int x, y;
+    if (!screen.terminal)
+        return 0;
+    MMSTATS_START(timer);
+    for (y = 0; y < MMSCREEN_HEIGHT; y++) {
+        struct mmcell *cells = screen.cells[y], *shown = screen.shown[y];
+        for (x = 0; x < MMSCREEN_WIDTH; x++) {
+            int start, end, gap;
+            if (cells[x].ch == shown[x].ch && cells[x].color == shown[x].color)
+                continue;
+            // a run ends after MMSCREEN_RUN_GAP unchanged cells, shorter gaps are rewritten
+            for (start = x, end = x + 1, gap = 0; x < MMSCREEN_WIDTH && gap <= MMSCREEN_RUN_GAP; x++) {
+                if (cells[x].ch == shown[x].ch && cells[x].color == shown[x].color)
+                    gap++;
+                else {
+                    gap = 0;
+                    end = x + 1;
+                }
+            }
+            screen.terminal->write(screen.origin_x + start, screen.origin_y + y, cells + start, end - start);
+            memcpy(shown + start, cells + start, (end - start) * sizeof(struct mmcell));
+            rt += end - start;
+            x = end;
+        }
+    }
+    bytes = screen.terminal->flush(screen.origin_x + screen.cursor_x, screen.origin_y + screen.cursor_y, screen.color);
+    MMSTATS_STOP(MMSTATS_RENDER, timer);
+    if (screen.script)
+        mmscript_frame(screen.script, bytes);
+    return rt;
+}
+
+int mmscreen_getkey(void) {
+    return mmscreen_waitkey(-1);
+}
+
+int mmscreen_waitkey(int timeout_ms) {
+    int rt; // rt means return value
+    mmscreen_present();
+    MMSTATS_START(timer);
+    if (!screen.terminal)
+        rt = 'q';
+    else if (screen.script)
+        rt = mmscript_getkey(screen.script, timeout_ms);
+    else
+        rt = screen.terminal->getkey(timeout_ms);
+    MMSTATS_STOP(MMSTATS_INPUT, timer);
+    return rt;
+}
+
+
+
+// End of source file 'mmscreen.c'
@@ -0,0 +1,87 @@
+/*!mmscreen.h
+ * Off-screen frame buffer of the user interface for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * The UI draws into a buffer of (character, color) cells. Nothing reaches
+ * the terminal until mmscreen_present(), which compares the buffer with the
+ * last presented frame and writes only the changed runs, followed by a
+ * single flush. The game presents once before it waits for a key.
+ *
+ * The terminal itself is a backend (struct mmterminal, see mmterminal.c):
+ * curses, a raw ANSI/VT100 writer or a virtual terminal on Linux or the
+ * Windows console. The keys may come from a script instead (mmscript.h).
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMSCREEN_H
+#define MMSCREEN_H
+
+#include "mastermind.h"
+
+struct mmscript;
+
+// size of the buffer, enough for the widest and highest widget
+#define MMSCREEN_WIDTH 80
+#define MMSCREEN_HEIGHT 25
+// unchanged cells between two changed runs which are rewritten instead of moving the cursor
+#define MMSCREEN_RUN_GAP 4
+// returned by mmscreen_waitkey() if no key arrived in time
+#define MMKEY_NONE (-1)
+
+// one character cell
+struct mmcell {
+    char ch;
+    unsigned char color; // console color attribute, e.g. MM_COLOR_BGFG
+};
+
+// a terminal backend, all positions are terminal coordinates
+struct mmterminal {
+    const char *name; // selected with mastermind_terminal()
+    bool capture; // output can be copied to a file
+    // prepares the terminal and gets the position of the top left cell, returns false if unusable
+    bool (*open)(const char *capture, int *origin_x, int *origin_y);
+    // writes count cells starting at column x of row y, may be buffered until flush
+    void (*write)(int x, int y, const struct mmcell *cells, int count);
+    // moves the cursor, sets the color of following output and makes everything visible,
+    // returns the bytes written since the last flush, 0 if unknown
+    size_t (*flush)(int x, int y, unsigned char color);
+    // waits for a key, MMKEY_ENTER and MMKEY_BACKSPACE are translated, 'q' at end of input,
+    // MMKEY_NONE if none arrives within timeout_ms (negative = forever)
+    int (*getkey)(int timeout_ms);
+    // restores the terminal
+    void (*close)(void);
+};
+
+// the backends of mmterminal.c, NULL-terminated, the first is the default
+extern const struct mmterminal *const mmterminals[];
+
+// finds a backend by name, NULL means the default
+const struct mmterminal *mmscreen_find(const char *name);
+// opens the terminal and clears the buffer, returns false if the terminal cannot be used
+bool mmscreen_open(const struct mmterminal *terminal, const char *capture);
+// presents the frame and restores the terminal
+void mmscreen_close(void);
+// takes the keys from script instead of the terminal and counts the frames for it, NULL = terminal
+void mmscreen_input(struct mmscript *script);
+// gets the cursor position in terminal coordinates
+void mmscreen_getcursor(int *x, int *y);
+// moves the cursor to column and row (terminal coordinates)
+void mmscreen_move(int column, int row);
+// sets the color of the following characters
+void mmscreen_setcolor(int color);
+// writes a character at the cursor, '\n', '\r' and '\b' move the cursor
+void mmscreen_putchar(int c);
+// writes formatted text at the cursor
+void mmscreen_printf(const char *format, ...);
+// writes the changed cells to the terminal and moves its cursor, returns the number of cells written
+size_t mmscreen_present(void);
+// presents the frame and waits for a key
+int mmscreen_getkey(void);
+// presents the frame and waits at most timeout_ms for a key (negative = forever), MMKEY_NONE if none arrived
+int mmscreen_waitkey(int timeout_ms);
+
+// end of MMSCREEN_H include guard
+#endif
@@ -0,0 +1,208 @@
+/*!mmscript.c
+ * Scripted keys of the user interface for game MasterMind (see mmscript.h).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mastermind.h"
+#include "mmscreen.h"
+#include "mmscript.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// keys of a script
+struct mmscript {
+    int *keys;
+    unsigned int *waits; // milliseconds before every key, besides the delay
+    double *latencies; // microseconds of every replayed key which was followed by a frame
+    size_t count, // number of keys
+        next, // index of the next key
+        latency_count;
+    unsigned int delay_ms;
+    double first, // time of the first key, 0 = none yet
+        last; // time of the last key
+    bool pending; // the last key waits for its frame
+    uint64_t frames,
+        games,
+        bytes;
+};
+
+// names of the keys which are not written as themselves
+static const struct {
+    const char *name;
+    int key;
+} script_names[] = {
+    { "ENTER", MMKEY_ENTER }, { "BACKSPACE", MMKEY_BACKSPACE }, { "ESC", 27 }, { "SPACE", ' ' }, { "LT", '<' }
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// reads the whole file, returns NULL if it cannot be read
+static char *nex_script_read(const char *path) {
+    FILE *file = fopen(path, "rb");
+    char *rt = NULL; // rt means return value
+    long size;
+    if (!file)
+        return NULL;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0 &&
+        (rt = malloc(size + 1))) {
+        if (fread(rt, 1, size, file) == (size_t)size)
+            rt[size] = '\0';
+        else {
+            free(rt);
+            rt = NULL;
+        }
+    }
+    fclose(file);
+    return rt;
+}
+// parses the keys of text, stores them if keys is not NULL, returns the number of keys or -1 if a <KEY> is unknown
+static long nex_script_parse(const char *text, int *keys, unsigned int *waits) {
+    long rt = 0; // rt means return value
+    unsigned int wait = 0, n;
+    while (*text) {
+        int key = (unsigned char)*text++;
+        if (key == '#') { // comment up to the end of the line
+            while (*text && *text != '\n')
+                text++;
+            continue;
+        }
+        if (key == ' ' || key == '\t' || key == '\r' || key == '\n')
+            continue;
+        if (key == '<') {
+            const char *end = strchr(text, '>');
+            size_t length = end ? (size_t)(end - text) : 0;
+            if (!end)
+                return -1;
+            if (length > 5 && strncmp(text, "WAIT ", 5) == 0) { // wait, no key
+                wait += (unsigned int)strtoul(text + 5, NULL, 10);
+                text = end + 1;
+                continue;
+            }
+            for (n = 0; n < sizeof(script_names) / sizeof(script_names[0]); n++) {
+                if (strlen(script_names[n].name) == length && strncmp(text, script_names[n].name, length) == 0)
+                    break;
+            }
+            if (n == sizeof(script_names) / sizeof(script_names[0]))
+                return -1;
+            key = script_names[n].key;
+            text = end + 1;
+        }
+        if (keys) {
+            keys[rt] = key;
+            waits[rt] = wait;
+        }
+        wait = 0;
+        rt++;
+    }
+    return rt;
+}
+// orders latencies ascending
+static int nex_script_compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+struct mmscript *mmscript_load(const char *path, unsigned int delay_ms) {
+    struct mmscript *script;
+    char *text = nex_script_read(path);
+    long count = text ? nex_script_parse(text, NULL, NULL) : -1;
+    if (count < 0 || !(script = calloc(1, sizeof(struct mmscript)))) {
+        free(text);
+        return NULL;
+    }
+    script->count = count;
+    script->delay_ms = delay_ms;
+    script->keys = malloc((count + 1) * sizeof(int));
+    script->waits = malloc((count + 1) * sizeof(unsigned int));
+    script->latencies = malloc((count + 1) * sizeof(double));
+    if (!script->keys || !script->waits || !script->latencies) {
+        free(text);
+        mmscript_destroy(script);
+        return NULL;
+    }
+    nex_script_parse(text, script->keys, script->waits);
+    free(text);
+    return script;
+}
+
+int mmscript_getkey(struct mmscript *script, int timeout_ms) {
+    double now = mmtime_now(), due;
+    if (script->next == script->count) // end of the script
+        return 'q';
+    if (!script->first)
+        script->first = script->last = now;
+    due = script->last + (script->delay_ms + script->waits[script->next]) / 1000.0;
+    if (now < due) {
+        if (timeout_ms >= 0 && now + timeout_ms / 1000.0 < due) {
+            mmtime_sleep(timeout_ms / 1000.0);
+            return MMKEY_NONE;
+        }
+        mmtime_sleep(due - now);
+    }
+    script->last = mmtime_now();
+    script->pending = true;
+    return script->keys[script->next++];
+}
+
+void mmscript_frame(struct mmscript *script, size_t bytes) {
+    script->frames++;
+    script->bytes += bytes;
+    if (script->pending)
+        script->latencies[script->latency_count++] = (mmtime_now() - script->last) * 1e6;
+    script->pending = false;
+}
+
+void mmscript_game(struct mmscript *script) {
+    script->games++;
+}
+
+void mmscript_report(const struct mmscript *script, MASTERMIND_UIREPORT *report) {
+    double *sorted = malloc((script->latency_count + 1) * sizeof(double)), sum = 0;
+    size_t n, count = script->latency_count;
+    memset(report, 0, sizeof(MASTERMIND_UIREPORT));
+    report->keys = script->next;
+    report->frames = script->frames;
+    report->games = script->games;
+    report->bytes = script->bytes;
+    report->seconds = script->first ? script->last - script->first : 0;
+    if (!sorted || !count) {
+        free(sorted);
+        return;
+    }
+    memcpy(sorted, script->latencies, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), nex_script_compare);
+    for (n = 0; n < count; n++)
+        sum += sorted[n];
+    report->latency_mean = sum / count;
+    report->latency_p50 = sorted[(count - 1) * 50 / 100];
+    report->latency_p99 = sorted[(count - 1) * 99 / 100];
+    report->latency_max = sorted[count - 1];
+    free(sorted);
+}
+
+void mmscript_destroy(struct mmscript *script) {
+    if (!script)
+        return;
+    free(script->keys);
+    free(script->waits);
+    free(script->latencies);
+    free(script);
+}
+
+
+
+// End of source file 'mmscript.c'
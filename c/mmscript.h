@@ -0,0 +1,43 @@
+/*!mmscript.h
+ * Scripted keys of the user interface for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * A script replaces the keyboard of any terminal backend (see mmscreen.h),
+ * e.g. of the virtual one, so the UI can be driven and timed without a
+ * person. Every character of the file is a key, whitespace is skipped and
+ * '#' comments out the rest of the line. Other keys are written as <ENTER>,
+ * <BACKSPACE>, <ESC>, <SPACE> and <LT> ('<'), <WAIT MS> waits MS more
+ * milliseconds before the next key. At the end of the script every key is
+ * 'q', like at the end of redirected input.
+ *
+ * Every key is timed until the end of the next frame written to the
+ * terminal, which includes the game logic and the rendering.
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMSCRIPT_H
+#define MMSCRIPT_H
+
+#include "mastermind.h"
+
+// keys of a script and their measurements
+struct mmscript;
+
+// loads a script with delay_ms between two keys, returns NULL if the file cannot be read or has an unknown <KEY>
+struct mmscript *mmscript_load(const char *path, unsigned int delay_ms);
+// gets the next key when it is due, MMKEY_NONE if it is not due within timeout_ms (negative = forever)
+int mmscript_getkey(struct mmscript *script, int timeout_ms);
+// counts a frame of bytes written to the terminal, the first one after a key ends its latency
+void mmscript_frame(struct mmscript *script, size_t bytes);
+// counts a started game
+void mmscript_game(struct mmscript *script);
+// gets the measurements so far
+void mmscript_report(const struct mmscript *script, MASTERMIND_UIREPORT *report);
+// frees a script, may be NULL
+void mmscript_destroy(struct mmscript *script);
+
+// end of MMSCRIPT_H include guard
+#endif
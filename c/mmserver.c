@@ -0,0 +1,388 @@
+/*!mmserver.c
+ * Multi-session game server for game MasterMind (Linux).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Hosts one game per connection on a Unix domain socket or on TCP port of
+ * localhost. Every worker thread runs its own epoll loop: the listening
+ * socket is shared (EPOLLEXCLUSIVE wakes one worker per connection) and a
+ * connection stays with the worker which accepted it, so sessions need no
+ * locks. The games are MASTERMIND_SESSIONs of a pool per worker.
+ * Protocol, one line per request and response:
+ *   new L C A M P     -> ok                  (preferences like the settings)
+ *   guess abcd        -> feedback X+.. N      (hints as on the board, attempt N)
+ *                     -> won N | lost abcd    (game over, secret code)
+ *   quit              -> bye                  (the connection is closed)
+ *   anything invalid  -> error TEXT
+ */
+
+#define _GNU_SOURCE // accept4()
+#include "mastermind.h"
+#include "mmthread.h"
+#include "mmstats.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// longest request line (including '\n'), longest response and room for pending responses
+#define MMSERVER_LINE 32
+#define MMSERVER_REPLY 48
+#define MMSERVER_OUTPUT 128
+// events handled per epoll_wait() call
+#define MMSERVER_EVENTS 256
+// max. worker threads
+#define MMSERVER_MAX_THREADS 64
+
+// one client, kept small for tens of thousands of sessions
+struct mmconnection {
+    int fd;
+    MASTERMIND_SESSION *game; // NULL until the first new request
+    uint8_t input_used,
+        output_used,
+        closing; // close after the pending output is sent
+    char input[MMSERVER_LINE], // incomplete request
+        output[MMSERVER_OUTPUT]; // responses the socket did not take yet
+};
+
+// state of a worker thread
+struct mmworker {
+    int epoll, listener;
+    MASTERMIND_POOL *pool; // the games of the connections of this worker
+    MASTERMIND_RANDOM random;
+    uint64_t connections, requests; // served so far
+};
+
+// set by SIGINT and SIGTERM
+static volatile sig_atomic_t stopping;
+
+// prints the command line options
+static int usage(const char *name) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --socket PATH             Unix domain socket to listen on (default: mastermind.sock)\n"
+        "  --port N                  listen on TCP port N of 127.0.0.1 instead\n"
+        "  --threads N               worker threads (0 = all cores)\n"
+        "  --sessions N              max. sessions per worker thread (default: 65536)\n"
+        "  --seed N                  seed of the secret codes (default: time)\n", name);
+    return 1;
+}
+
+static void server_signal(int signal_number) {
+    stopping = 1;
+}
+
+// appends a response, there is always room for MMSERVER_REPLY bytes (see server_receive())
+static void server_reply(struct mmconnection *connection, const char *text) {
+    size_t length = strlen(text);
+    memcpy(connection->output + connection->output_used, text, length);
+    connection->output[connection->output_used + length] = '\n';
+    connection->output_used += length + 1;
+}
+
+// writes the hints of a feedback as the board shows them, e.g. "X+.."
+static void server_hints(const MASTERMIND_PREFERENCES *prefs, MMFEEDBACK feedback, char *out) {
+    unsigned int n, blacks = mastermind_feedback_blacks(prefs, feedback),
+        whites = mastermind_feedback_whites(prefs, feedback);
+    for (n = 0; n < prefs->code_length; n++) {
+        if (prefs->hints_position_based)
+            out[n] = (MMFEEDBACK_BLACKS(feedback) >> n & 1) ? 'X' : (MMFEEDBACK_WHITES(feedback) >> n & 1) ? '+' : '.';
+        else
+            out[n] = n < blacks ? 'X' : n < blacks + whites ? '+' : '.';
+    }
+    out[n] = '\0';
+}
+
+// handles one request line (without '\n')
+static void server_request(struct mmworker *worker, struct mmconnection *connection, char *line) {
+    char text[MMSERVER_OUTPUT];
+    worker->requests++;
+    if (strncmp(line, "guess ", 6) == 0) {
+        const char *code = line + 6;
+        MASTERMIND_STATE state;
+        MMFEEDBACK feedback;
+        unsigned int n;
+        if (connection->game)
+            mastermind_session_state(connection->game, &state);
+        if (!connection->game || state.status != MMSESSION_PLAYING) {
+            server_reply(connection, "error no game, start one with: new L C A M P");
+            return;
+        }
+        for (n = 0; n < state.prefs.code_length && code[n] >= 'a' && code[n] < 'a' + (int)state.prefs.color_count; n++);
+        if (n != state.prefs.code_length || code[n] != '\0') {
+            server_reply(connection, "error invalid code");
+            return;
+        }
+        mastermind_session_guess(connection->game, mastermind_code_pack(&state.prefs, code), &feedback);
+        mastermind_session_state(connection->game, &state);
+        if (state.status == MMSESSION_WON)
+            snprintf(text, sizeof(text), "won %u", state.attempt);
+        else if (state.status == MMSESSION_LOST) {
+            char secret[MMPREFS_MAX_CODE_LENGTH + 1] = { 0 };
+            mastermind_code_unpack(&state.prefs, state.secret, secret);
+            snprintf(text, sizeof(text), "lost %s", secret);
+        }
+        else {
+            char hints[MMPREFS_MAX_CODE_LENGTH + 1];
+            server_hints(&state.prefs, feedback, hints);
+            snprintf(text, sizeof(text), "feedback %s %u", hints, state.attempt);
+        }
+        server_reply(connection, text);
+    }
+    else if (strncmp(line, "new ", 4) == 0) {
+        unsigned int length, colors, attempts, multiple, position;
+        MASTERMIND_PREFERENCES prefs;
+        if (sscanf(line + 4, "%u %u %u %u %u", &length, &colors, &attempts, &multiple, &position) != 5 ||
+            multiple > 1 || position > 1) {
+            server_reply(connection, "error usage: new L C A M P");
+            return;
+        }
+        prefs = (MASTERMIND_PREFERENCES) { length, colors, attempts, multiple, position };
+        if (!mastermind_prefs_valid(&prefs)) {
+            server_reply(connection, "error invalid preferences");
+            return;
+        }
+        mastermind_session_destroy(worker->pool, connection->game);
+        connection->game = mastermind_session_create(worker->pool, &prefs, mastermind_random_code(&prefs, &worker->random));
+        server_reply(connection, connection->game ? "ok" : "error too many sessions");
+    }
+    else if (strcmp(line, "quit") == 0) {
+        server_reply(connection, "bye");
+        connection->closing = 1;
+    }
+    else
+        server_reply(connection, "error unknown request, use new, guess or quit");
+}
+
+// closes a connection and frees its session
+static void server_close(struct mmworker *worker, struct mmconnection *connection) {
+    close(connection->fd); // also removes it from the epoll set
+    mastermind_session_destroy(worker->pool, connection->game);
+    free(connection);
+}
+
+// sends the pending output, returns false if the connection is broken
+static bool server_send(struct mmworker *worker, struct mmconnection *connection) {
+    ssize_t sent;
+    if (!connection->output_used)
+        return true;
+    sent = send(connection->fd, connection->output, connection->output_used, MSG_NOSIGNAL);
+    if (sent < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    memmove(connection->output, connection->output + sent, connection->output_used - sent);
+    connection->output_used -= sent;
+    return true;
+}
+
+// answers the requests of a connection, returns false if it has to be closed
+static bool server_receive(struct mmworker *worker, struct mmconnection *connection) {
+    bool waiting = connection->output_used > 0; // EPOLLOUT is on
+    while (1) {
+        char *line = connection->input, *end;
+        ssize_t received;
+        // answer the complete lines while their responses fit, the output is sent once per read
+        while (!connection->closing && connection->output_used + MMSERVER_REPLY <= MMSERVER_OUTPUT &&
+            (end = memchr(line, '\n', connection->input + connection->input_used - line))) {
+            MMSTATS_START(timer);
+            *end = '\0';
+            if (end > line && end[-1] == '\r')
+                end[-1] = '\0';
+            server_request(worker, connection, line);
+            MMSTATS_STOP(MMSTATS_REQUEST, timer);
+            line = end + 1;
+        }
+        connection->input_used -= line - connection->input;
+        memmove(connection->input, line, connection->input_used);
+        if (connection->input_used == MMSERVER_LINE && !memchr(connection->input, '\n', MMSERVER_LINE))
+            return false; // no request is that long
+        if (!server_send(worker, connection))
+            return false;
+        if (connection->closing || connection->output_used) // done or the socket is full
+            break;
+        if (memchr(connection->input, '\n', connection->input_used)) // the output was full, answer the rest first
+            continue;
+        received = recv(connection->fd, connection->input + connection->input_used, MMSERVER_LINE - connection->input_used, 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            return false;
+        if (received < 0)
+            break;
+        connection->input_used += received;
+    }
+    if (connection->closing && !connection->output_used)
+        return false;
+    if (waiting != (connection->output_used > 0)) { // wait for room in the socket instead of reading
+        struct epoll_event event = { .events = connection->output_used ? EPOLLOUT : EPOLLIN, .data.ptr = connection };
+        epoll_ctl(worker->epoll, EPOLL_CTL_MOD, connection->fd, &event);
+    }
+    return true;
+}
+
+// accepts all waiting connections
+static void server_accept(struct mmworker *worker) {
+    while (1) {
+        struct mmconnection *connection;
+        struct epoll_event event;
+        int fd = accept4(worker->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC), one = 1;
+        if (fd < 0)
+            return; // EAGAIN, another worker took it or out of descriptors
+        if (!(connection = calloc(1, sizeof(struct mmconnection)))) {
+            close(fd);
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // fails harmlessly on Unix sockets
+        connection->fd = fd;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            server_close(worker, connection);
+            continue;
+        }
+        worker->connections++;
+    }
+}
+
+// main function of a worker thread
+static void server_main(void *arg) {
+    struct mmworker *worker = arg;
+    struct epoll_event events[MMSERVER_EVENTS];
+    while (!stopping) {
+        int count = epoll_wait(worker->epoll, events, MMSERVER_EVENTS, 200), n;
+        for (n = 0; n < count; n++) {
+            struct mmconnection *connection = events[n].data.ptr;
+            if (!connection)
+                server_accept(worker);
+            else if (events[n].events & (EPOLLERR | EPOLLHUP) && !(events[n].events & EPOLLIN))
+                server_close(worker, connection);
+            else if (!server_receive(worker, connection))
+                server_close(worker, connection);
+        }
+    }
+}
+
+// creates the listening socket, returns -1 on failure
+static int server_listen(const char *path, int port) {
+    int fd;
+    if (port) {
+        struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port) };
+        int one = 1;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    else {
+        struct sockaddr_un address = { .sun_family = AF_UNIX };
+        if (strlen(path) >= sizeof(address.sun_path))
+            return -1;
+        strcpy(address.sun_path, path);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        unlink(path); // a socket file left by a previous server
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    static struct mmworker workers[MMSERVER_MAX_THREADS];
+    MMTHREAD threads[MMSERVER_MAX_THREADS];
+    const char *path = "mastermind.sock";
+    unsigned long long seed = (unsigned long long)time(NULL), connections = 0, requests = 0;
+    unsigned int thread_count = 0, session_count = 65536, n;
+    int port = 0, listener;
+    struct rlimit limit;
+    for (n = 1; n < (unsigned int)argc; n++) {
+        const char *value = n + 1 < (unsigned int)argc ? argv[n + 1] : NULL;
+        if (!value)
+            return usage(argv[0]);
+        else if (strcmp(argv[n], "--socket") == 0)
+            path = value;
+        else if (strcmp(argv[n], "--port") == 0)
+            port = atoi(value);
+        else if (strcmp(argv[n], "--threads") == 0)
+            thread_count = atoi(value);
+        else if (strcmp(argv[n], "--sessions") == 0)
+            session_count = atoi(value);
+        else if (strcmp(argv[n], "--seed") == 0)
+            seed = strtoull(value, NULL, 10);
+        else
+            return usage(argv[0]);
+        n++;
+    }
+    if (!thread_count)
+        thread_count = mmthread_cpu_count();
+    if (thread_count > MMSERVER_MAX_THREADS)
+        thread_count = MMSERVER_MAX_THREADS;
+    // every connection is a descriptor
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if ((listener = server_listen(path, port)) < 0) {
+        fprintf(stderr, "cannot listen on %s\n", port ? "the TCP port" : path);
+        return 1;
+    }
+    signal(SIGINT, server_signal);
+    signal(SIGTERM, server_signal);
+    for (n = 0; n < thread_count; n++) {
+        struct epoll_event event = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL };
+        workers[n].listener = listener;
+        mastermind_random_seed(&workers[n].random, seed + n);
+        if (!(workers[n].pool = mastermind_pool_create(session_count)) ||
+            (workers[n].epoll = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+            epoll_ctl(workers[n].epoll, EPOLL_CTL_ADD, listener, &event) != 0 ||
+            !mmthread_create(&threads[n], server_main, &workers[n])) {
+            fprintf(stderr, "cannot start worker %u\n", n);
+            stopping = 1;
+            break;
+        }
+    }
+    if (!stopping) {
+        if (port)
+            fprintf(stderr, "listening on 127.0.0.1:%d", port);
+        else
+            fprintf(stderr, "listening on %s", path);
+        fprintf(stderr, " with %u workers, %u bytes per connection plus its pooled session and kernel socket\n",
+            n, (unsigned int)sizeof(struct mmconnection));
+    }
+    thread_count = n;
+    for (n = 0; n < thread_count; n++) {
+        mmthread_join(threads[n]);
+        connections += workers[n].connections;
+        requests += workers[n].requests;
+    }
+    for (n = 0; n < MMSERVER_MAX_THREADS; n++)
+        mastermind_pool_destroy(workers[n].pool);
+    close(listener);
+    if (!port)
+        unlink(path);
+    fprintf(stderr, "served %llu connections, %llu requests\n", connections, requests);
+    return 0;
+}
+
+
+
+// End of source file 'mmserver.c'
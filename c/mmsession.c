@@ -0,0 +1,141 @@
+/*!mmsession.c
+ * Game sessions without UI and their pool for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mastermind.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// one game, the preferences are stored as bytes to keep it small
+struct mmsession {
+    uint8_t code_length,
+        color_count,
+        attempt_count,
+        multiple_colors,
+        hints_position_based,
+        status, // MMSESSION_STATUS
+        attempt; // attempts done
+    MMCODE secret;
+    MMCODE guesses[MMPREFS_MAX_ATTEMPT_COUNT];
+    MMFEEDBACK feedbacks[MMPREFS_MAX_ATTEMPT_COUNT];
+};
+
+// preallocated sessions and a stack of the free ones
+struct mmpool {
+    struct mmsession *sessions;
+    uint32_t *free; // indices of the free sessions
+    size_t capacity,
+        free_count;
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// gets the preferences of the game of a session
+static MASTERMIND_PREFERENCES nex_session_prefs(const struct mmsession *session) {
+    MASTERMIND_PREFERENCES rt = { session->code_length, session->color_count, session->attempt_count,
+        session->multiple_colors, session->hints_position_based }; // rt means return value
+    return rt;
+}
+// checks that every peg of a code is one of the colors
+static bool nex_session_code_valid(const MASTERMIND_PREFERENCES *prefs, MMCODE code) {
+    unsigned int n;
+    if (prefs->code_length < MMPREFS_MAX_CODE_LENGTH && code >> (MMCODE_PEG_BITS * prefs->code_length))
+        return false;
+    for (n = 0; n < prefs->code_length; n++, code >>= MMCODE_PEG_BITS) {
+        if ((code & MMCODE_PEG_MASK) >= prefs->color_count)
+            return false;
+    }
+    return true;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+MASTERMIND_POOL *mastermind_pool_create(size_t capacity) {
+    struct mmpool *pool;
+    size_t n;
+    if (!capacity || capacity > UINT32_MAX || !(pool = calloc(1, sizeof(struct mmpool))))
+        return NULL;
+    pool->sessions = malloc(capacity * sizeof(struct mmsession));
+    pool->free = malloc(capacity * sizeof(uint32_t));
+    if (!pool->sessions || !pool->free) {
+        mastermind_pool_destroy(pool);
+        return NULL;
+    }
+    pool->capacity = pool->free_count = capacity;
+    for (n = 0; n < capacity; n++) // the first session is handed out first
+        pool->free[n] = (uint32_t)(capacity - 1 - n);
+    return pool;
+}
+
+void mastermind_pool_destroy(MASTERMIND_POOL *pool) {
+    if (!pool)
+        return;
+    free(pool->sessions);
+    free(pool->free);
+    free(pool);
+}
+
+MASTERMIND_SESSION *mastermind_session_create(MASTERMIND_POOL *pool, const MASTERMIND_PREFERENCES *prefs, MMCODE secret) {
+    struct mmsession *rt; // rt means return value
+    if (!pool || !pool->free_count || !mastermind_prefs_valid(prefs) || !nex_session_code_valid(prefs, secret))
+        return NULL;
+    rt = &pool->sessions[pool->free[--pool->free_count]];
+    memset(rt, 0, sizeof(struct mmsession));
+    rt->code_length = prefs->code_length;
+    rt->color_count = prefs->color_count;
+    rt->attempt_count = prefs->attempt_count;
+    rt->multiple_colors = prefs->multiple_colors;
+    rt->hints_position_based = prefs->hints_position_based;
+    rt->status = MMSESSION_PLAYING;
+    rt->secret = secret;
+    return rt;
+}
+
+bool mastermind_session_guess(MASTERMIND_SESSION *session, MMCODE guess, MMFEEDBACK *feedback) {
+    MASTERMIND_PREFERENCES prefs = nex_session_prefs(session);
+    MMFEEDBACK score;
+    if (session->status != MMSESSION_PLAYING || !nex_session_code_valid(&prefs, guess))
+        return false;
+    score = mastermind_score(&prefs, guess, session->secret);
+    session->guesses[session->attempt] = guess;
+    session->feedbacks[session->attempt] = score;
+    session->attempt++;
+    if (guess == session->secret)
+        session->status = MMSESSION_WON;
+    else if (session->attempt == session->attempt_count)
+        session->status = MMSESSION_LOST;
+    if (feedback)
+        *feedback = score;
+    return true;
+}
+
+void mastermind_session_state(const MASTERMIND_SESSION *session, MASTERMIND_STATE *state) {
+    memset(state, 0, sizeof(MASTERMIND_STATE));
+    state->prefs = nex_session_prefs(session);
+    state->status = session->status;
+    state->attempt = session->attempt;
+    state->secret = session->status == MMSESSION_PLAYING ? 0 : session->secret;
+    memcpy(state->guesses, session->guesses, session->attempt * sizeof(MMCODE));
+    memcpy(state->feedbacks, session->feedbacks, session->attempt * sizeof(MMFEEDBACK));
+}
+
+void mastermind_session_destroy(MASTERMIND_POOL *pool, MASTERMIND_SESSION *session) {
+    if (!session)
+        return;
+    pool->free[pool->free_count++] = (uint32_t)(session - pool->sessions);
+}
+
+
+
+// End of source file 'mmsession.c'
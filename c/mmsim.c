@@ -0,0 +1,168 @@
+/*!mmsim.c
+ * Headless simulation of games played by the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mastermind.h"
+#include "mmthread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// number of games a thread takes at once from the shared game counter
+#define MMSIM_BATCH 64
+
+// state shared by all simulation threads
+struct mmsim {
+    MASTERMIND_PREFERENCES prefs; // solver prefs (single-threaded)
+    const MASTERMIND_SCORETABLE *table;
+    uint64_t games, seed;
+    volatile uint64_t next_game; // next game index to hand out
+    // counters aggregated lock-free by all threads
+    volatile uint64_t played, won, failed;
+    volatile uint64_t guesses[MMPREFS_MAX_ATTEMPT_COUNT + 1];
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// creates the secret codes of a batch, they only depend on seed and the index of the first game
+static void nex_sim_secrets(const MASTERMIND_PREFERENCES *prefs, uint64_t seed, uint64_t game,
+    MMCODE *secrets, size_t count) {
+    MASTERMIND_RANDOM random;
+    mastermind_random_seed(&random, seed ^ mastermind_mix64(game));
+    mastermind_random_codes(prefs, &random, secrets, count);
+}
+// plays one game with the solver, returns the number of guesses or 0 if the game was lost,
+// the guesses and their times are stored in game unless it is NULL (no log)
+static unsigned int nex_sim_play(MASTERMIND_SOLVER *solver, const MASTERMIND_PREFERENCES *prefs, MMCODE secret,
+    MASTERMIND_GAMELOG *game) {
+    unsigned int attempt;
+    double last = game ? mmtime_now() : 0, now; // one clock read per guess, the time includes the last feedback
+    if (!mastermind_solver_reset(solver))
+        return 0;
+    for (attempt = 1; attempt <= prefs->attempt_count; attempt++) {
+        MMCODE guess = mastermind_solver_guess(solver);
+        MMFEEDBACK feedback = mastermind_score(prefs, guess, secret);
+        if (game) {
+            now = mmtime_now();
+            game->state.guesses[attempt - 1] = guess;
+            game->state.feedbacks[attempt - 1] = feedback;
+            game->micros[attempt - 1] = (uint32_t)((now - last) * 1e6);
+            game->state.attempt = attempt;
+            last = now;
+        }
+        if (guess == secret)
+            return attempt;
+        mastermind_solver_feedback(solver, guess, feedback);
+    }
+    return 0;
+}
+// main function of a simulation thread: plays batches of games until all are done
+static void nex_sim_main(void *arg) {
+    struct mmsim *sim = arg;
+    MASTERMIND_SOLVER *solver = mastermind_solver_create(&sim->prefs, sim->table);
+    // games of a batch, appended to the log at once
+    MASTERMIND_GAMELOG *games = sim->prefs.log ? calloc(MMSIM_BATCH, sizeof(MASTERMIND_GAMELOG)) : NULL;
+    uint64_t guesses[MMPREFS_MAX_ATTEMPT_COUNT + 1];
+    MMCODE secrets[MMSIM_BATCH];
+    unsigned int n;
+    if (!solver || (sim->prefs.log && !games)) {
+        mastermind_solver_destroy(solver);
+        free(games);
+        return;
+    }
+    while (1) {
+        uint64_t game = mmatomic_add(&sim->next_game, MMSIM_BATCH), end, won = 0, failed = 0;
+        if (game >= sim->games)
+            break;
+        end = game + MMSIM_BATCH < sim->games ? game + MMSIM_BATCH : sim->games;
+        memset(guesses, 0, sizeof(guesses));
+        nex_sim_secrets(&sim->prefs, sim->seed, game, secrets, (size_t)(end - game));
+        for (n = 0; game < end; game++, n++) {
+            unsigned int count = nex_sim_play(solver, &sim->prefs, secrets[n], games ? &games[n] : NULL);
+            if (count) {
+                won++;
+                guesses[count]++;
+            }
+            else
+                failed++;
+            if (games) {
+                games[n].state.prefs = sim->prefs;
+                games[n].state.status = count ? MMSESSION_WON : MMSESSION_LOST;
+                games[n].state.secret = secrets[n];
+                games[n].seed = sim->seed;
+                games[n].game = game;
+                games[n].comsolver = true;
+            }
+        }
+        mastermind_log_games(sim->prefs.log, games, n);
+        // publish the batch, the counters are only ever added to
+        for (n = 0; n <= MMPREFS_MAX_ATTEMPT_COUNT; n++) {
+            if (guesses[n])
+                mmatomic_add(&sim->guesses[n], guesses[n]);
+        }
+        mmatomic_add(&sim->won, won);
+        mmatomic_add(&sim->failed, failed);
+        mmatomic_add(&sim->played, won + failed);
+    }
+    mastermind_solver_destroy(solver);
+    free(games);
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+bool mastermind_simulate(const MASTERMIND_PREFERENCES *prefs, uint64_t games, uint64_t seed,
+    MASTERMIND_SIMREPORT *report) {
+    struct mmsim sim;
+    MMTHREAD *threads;
+    MASTERMIND_SCORETABLE *table;
+    unsigned int n, started, thread_count = prefs->thread_count ? prefs->thread_count : mmthread_cpu_count();
+    double start = mmtime_now();
+    memset(&sim, 0, sizeof(sim));
+    memset(report, 0, sizeof(*report));
+    if (!mastermind_prefs_valid(prefs))
+        return false;
+    // the games run in parallel, so every solver works on a single thread
+    sim.prefs = *prefs;
+    sim.prefs.thread_count = 1;
+    sim.games = games;
+    sim.seed = seed;
+    table = mastermind_scoretable_create(prefs);
+    threads = malloc(thread_count * sizeof(MMTHREAD));
+    if (!table || !threads) {
+        mastermind_scoretable_destroy(table);
+        free(threads);
+        return false;
+    }
+    sim.table = table;
+    for (started = 0; started + 1 < thread_count; started++) {
+        if (!mmthread_create(&threads[started], nex_sim_main, &sim))
+            break;
+    }
+    nex_sim_main(&sim); // the calling thread plays as well
+    for (n = 0; n < started; n++)
+        mmthread_join(threads[n]);
+    free(threads);
+    mastermind_scoretable_destroy(table);
+    report->games = sim.played;
+    report->won = sim.won;
+    report->failed = sim.failed;
+    for (n = 0; n <= MMPREFS_MAX_ATTEMPT_COUNT; n++)
+        report->guesses[n] = sim.guesses[n];
+    report->threads = started + 1;
+    report->seconds = mmtime_now() - start;
+    return report->games == games;
+}
+
+
+
+// End of source file 'mmsim.c'
@@ -0,0 +1,647 @@
+/*!mmsolver.c
+ * COMSOLVER (computer solver) for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Every guess is rated by the partitions it splits the candidates into.
+ * Minimax wants the biggest partition as small as possible. Entropy wants
+ * the most expected information, log2(N) - sum(c * log2(c)) / N for N
+ * candidates and partitions of size c: the sum is the same as adding up
+ * log2 of the partition size of every candidate, so it is computed per
+ * candidate from a table without looking at the partitions themselves.
+ */
+
+#include "mastermind.h"
+#include "mmgenetic.h"
+#include "mmpropagate.h"
+#include "mmthread.h"
+#include "mmstats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// max. number of candidates the partitions of a guess are rated with, bigger
+// candidate sets are represented by an evenly spread sample of them
+#define MMSOLVER_SAMPLE_MAX (1u << 14)
+// max. number of scores computed for one guess selection (guesses x candidates)
+#define MMSOLVER_WORK_BUDGET (1u << 22)
+// step for spreading samples over all ranks, coprime to every color_count ^ code_length
+#define MMSOLVER_SAMPLE_STEP 1000003u
+// max. number of candidates the exact endgame search is tried for
+#define MMSOLVER_ENDGAME_MAX 256
+// max. number of scores computed by one exact endgame search
+#define MMSOLVER_ENDGAME_BUDGET (1u << 22)
+// number of guesses a worker rates before it looks at its range again
+#define MMSOLVER_CHUNK 8
+// min. number of scores of a selection before it is split across the workers
+#define MMSOLVER_PARALLEL_MIN (1u << 16)
+// number of histogram buckets, indexed by table index or MMSOLVER_HISTOGRAM_INDEX()
+#define MMSOLVER_HISTOGRAM_SIZE (1u << (2 * MMPREFS_ENUM_MAX_CODE_LENGTH))
+// histogram bucket of a feedback, both parts of it fit into MMPREFS_ENUM_MAX_CODE_LENGTH bits
+#define MMSOLVER_HISTOGRAM_INDEX(feedback) \
+    (MMFEEDBACK_BLACKS(feedback) | MMFEEDBACK_WHITES(feedback) << MMPREFS_ENUM_MAX_CODE_LENGTH)
+// fraction bits of the log2 table of the entropy strategy
+#define MMSOLVER_LOG2_BITS 32
+
+// state of the solver for one game
+struct mmsolver {
+    MASTERMIND_PREFERENCES prefs;
+    const MASTERMIND_SCORER *scorer; // kernels for prefs
+    const MASTERMIND_SCORETABLE *table; // NULL if no filled table is available
+    uint32_t code_count; // color_count ^ code_length
+    MASTERMIND_CANDIDATES *candidates; // codes consistent with all feedbacks so far
+    uint32_t book_root, // tree of prefs in prefs.book, 0 = none
+        book_node; // book node of the current game state, 0 = beyond the book
+    MMCODE guesses[MMPREFS_MAX_ATTEMPT_COUNT]; // guesses of this game
+    MMFEEDBACK feedbacks[MMPREFS_MAX_ATTEMPT_COUNT]; // their feedbacks
+    unsigned int attempt; // number of guesses with feedback
+    MMCODE *sample; // rated candidates, an evenly spread part if there are more than MMSOLVER_SAMPLE_MAX
+    struct mmgenetic *genetic; // search of the guesses if prefs are beyond enumeration, NULL otherwise
+    struct mmpropagate *propagate; // search of the guesses with position based hints if prefs are beyond enumeration or by strategy, NULL otherwise
+    uint32_t *sample_ranks;
+    uint64_t *log2; // entropy: log2(n) with MMSOLVER_LOG2_BITS fraction bits for n <= MMSOLVER_SAMPLE_MAX
+    uint32_t solved; // histogram bucket of a solved game
+    // guess selection, workers[0] is the calling thread, the others are pool threads
+    struct mmworker *workers;
+    unsigned int worker_count;
+    const struct mmselection *job; // selection the workers are working on
+    MMMUTEX lock; // protects generation, done and shutdown
+    MMCOND wake, // signals a new generation (job) or shutdown
+        finished; // signals that a pool thread is done with the job
+    uint64_t generation;
+    unsigned int done;
+    bool shutdown;
+    volatile uint64_t cancel; // 1 = the selection running on another thread is not needed anymore
+};
+
+// guesses [0, guess_count) to rate against the sample in one selection
+struct mmselection {
+    const MMCODE *pool; // guess n is pool[n * pool_count / guess_count], NULL = code of rank n
+    const uint32_t *pool_ranks; // ranks of the pool (only with table)
+    size_t pool_count,
+        guess_count;
+    const MMCODE *codes; // the sample
+    const uint32_t *ranks;
+    size_t count;
+};
+
+// rating of one guess, smaller is better
+struct mmrating {
+    uint64_t cost; // minimax: size of the biggest partition, entropy: sum of log2(partition size) over the sample
+    bool consistent; // the guess itself may be the secret code
+    uint32_t index; // index of the guess in the selection
+};
+
+// one thread of the guess selection
+struct mmworker {
+    struct mmsolver *solver;
+    unsigned int index;
+    MMTHREAD thread;
+    volatile uint64_t range; // guesses left: begin (low 32 bits) and end (high 32 bits)
+    struct mmrating best; // best guess of this worker so far
+    MMFEEDBACK *scores; // scores of one guess against the sample, then their histogram buckets
+    uint32_t *histogram; // partition sizes of one guess
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// gets the feedback of a solved game
+static MMFEEDBACK nex_solved_feedback(const MASTERMIND_PREFERENCES *prefs) {
+    return prefs->hints_position_based ?
+        MMFEEDBACK_MAKE((1u << prefs->code_length) - 1, 0) : MMFEEDBACK_MAKE(prefs->code_length, 0);
+}
+// collects the candidates the guesses are rated with, returns their count
+static size_t nex_solver_sample(struct mmsolver *solver) {
+    size_t n;
+    if (mastermind_candidates_count(solver->candidates) == solver->code_count &&
+        solver->code_count > MMSOLVER_SAMPLE_MAX) {
+        // no feedback so far: spreading by rank would fix the low pegs, so step over all ranks
+        for (n = 0; n < MMSOLVER_SAMPLE_MAX; n++) {
+            uint32_t rank = (uint32_t)((uint64_t)n * MMSOLVER_SAMPLE_STEP % solver->code_count);
+            solver->sample[n] = mastermind_code_unrank(&solver->prefs, rank);
+            if (solver->table)
+                solver->sample_ranks[n] = rank;
+        }
+        return MMSOLVER_SAMPLE_MAX;
+    }
+    return mastermind_candidates_collect(solver->candidates, solver->sample,
+        solver->table ? solver->sample_ranks : NULL, MMSOLVER_SAMPLE_MAX);
+}
+// gets the log2 of n with MMSOLVER_LOG2_BITS fraction bits (n > 0), bit by bit by squaring
+static uint64_t nex_log2(uint32_t n) {
+    unsigned int exponent = 31 - __builtin_clz(n), bit;
+    uint64_t rt = (uint64_t)exponent << MMSOLVER_LOG2_BITS, // rt means return value
+        mantissa = (uint64_t)n << (31 - exponent); // 1.0 <= mantissa < 2.0 with 31 fraction bits
+    for (bit = MMSOLVER_LOG2_BITS; bit-- > 0;) {
+        mantissa = mantissa * mantissa >> 31;
+        if (mantissa >= 2ull << 31) {
+            mantissa >>= 1;
+            rt |= 1ull << bit;
+        }
+    }
+    return rt;
+}
+// gets the histogram bucket of every code of the sample for a guess into worker->scores,
+// a pass without dependencies between the codes, so the compiler can vectorize it
+static void nex_worker_buckets(struct mmworker *worker, MMCODE guess, uint32_t guess_rank,
+    const MMCODE *codes, const uint32_t *ranks, size_t count) {
+    const struct mmsolver *solver = worker->solver;
+    MMFEEDBACK *buckets = worker->scores;
+    size_t n;
+    if (solver->table) { // every score is a single load from the table
+        const uint8_t *row = solver->table->feedback + (size_t)guess_rank * solver->code_count;
+        for (n = 0; n < count; n++)
+            buckets[n] = row[ranks[n]];
+        return;
+    }
+    solver->scorer->batch(&solver->prefs, guess, codes, buckets, count);
+    for (n = 0; n < count; n++)
+        buckets[n] = MMSOLVER_HISTOGRAM_INDEX(buckets[n]);
+}
+// rates a guess by the partitions it splits the sample into
+static struct mmrating nex_worker_rate(struct mmworker *worker, MMCODE guess, uint32_t guess_rank,
+    const MMCODE *codes, const uint32_t *ranks, size_t count) {
+    const struct mmsolver *solver = worker->solver;
+    const MMFEEDBACK *buckets = worker->scores;
+    uint32_t *histogram = worker->histogram;
+    struct mmrating rt = { 0, false, 0 }; // rt means return value
+    size_t n;
+    nex_worker_buckets(worker, guess, guess_rank, codes, ranks, count);
+    if (solver->log2) { // entropy: every code adds log2 of the size of its partition
+        for (n = 0; n < count; n++)
+            histogram[buckets[n]]++;
+        for (n = 0; n < count; n++)
+            rt.cost += solver->log2[histogram[buckets[n]]];
+    }
+    else {
+        for (n = 0; n < count; n++) {
+            uint32_t size = ++histogram[buckets[n]];
+            if (size > rt.cost)
+                rt.cost = size;
+        }
+    }
+    rt.consistent = histogram[solver->solved] > 0;
+    for (n = 0; n < count; n++)
+        histogram[buckets[n]] = 0;
+    return rt;
+}
+// checks if rating a is better than rating b (on a tie the smaller guess index wins)
+static bool nex_rating_better(struct mmrating a, struct mmrating b) {
+    if (a.cost != b.cost)
+        return a.cost < b.cost;
+    if (a.consistent != b.consistent)
+        return a.consistent;
+    return a.index < b.index;
+}
+// rates the guesses [begin, end) of the current selection
+static void nex_worker_rate_range(struct mmworker *worker, uint32_t begin, uint32_t end) {
+    const struct mmselection *job = worker->solver->job;
+    uint32_t n;
+    for (n = begin; n < end; n++) {
+        struct mmrating rating;
+        if (job->pool) { // evenly spread part of the pool
+            size_t idx = (size_t)((uint64_t)n * job->pool_count / job->guess_count);
+            rating = nex_worker_rate(worker, job->pool[idx], job->pool_ranks ? job->pool_ranks[idx] : 0,
+                job->codes, job->ranks, job->count);
+        }
+        else // every code by rank
+            rating = nex_worker_rate(worker, mastermind_code_unrank(&worker->solver->prefs, n), n,
+                job->codes, job->ranks, job->count);
+        rating.index = n;
+        if (nex_rating_better(rating, worker->best))
+            worker->best = rating;
+    }
+}
+// takes the upper half of the guesses left to another worker, returns false if there are none
+static bool nex_worker_steal(struct mmworker *worker) {
+    struct mmsolver *solver = worker->solver;
+    unsigned int n;
+    for (n = 1; n < solver->worker_count; n++) {
+        struct mmworker *victim = &solver->workers[(worker->index + n) % solver->worker_count];
+        uint64_t range = mmatomic_load(&victim->range);
+        uint32_t begin = (uint32_t)range, end = (uint32_t)(range >> 32), middle;
+        if (begin >= end)
+            continue;
+        middle = begin + (end - begin) / 2;
+        if (mmatomic_cas(&victim->range, range, (uint64_t)middle << 32 | begin)) {
+            mmatomic_store(&worker->range, (uint64_t)end << 32 | middle);
+            return true;
+        }
+        n--; // the victim changed in the meantime, try it again
+    }
+    return false;
+}
+// rates chunks of the own guesses and steals guesses of others when done
+static void nex_worker_run(struct mmworker *worker) {
+    while (!mmatomic_load(&worker->solver->cancel)) {
+        uint64_t range = mmatomic_load(&worker->range);
+        uint32_t begin = (uint32_t)range, end = (uint32_t)(range >> 32), take;
+        if (begin >= end) {
+            if (!nex_worker_steal(worker))
+                return;
+            continue;
+        }
+        take = end - begin < MMSOLVER_CHUNK ? end - begin : MMSOLVER_CHUNK;
+        if (mmatomic_cas(&worker->range, range, (uint64_t)end << 32 | (begin + take)))
+            nex_worker_rate_range(worker, begin, begin + take);
+    }
+}
+// main function of the pool threads: waits for selections and works on them
+static void nex_worker_main(void *arg) {
+    struct mmworker *worker = arg;
+    struct mmsolver *solver = worker->solver;
+    uint64_t generation = 0;
+    mmmutex_lock(&solver->lock);
+    while (1) {
+        while (solver->generation == generation && !solver->shutdown)
+            mmcond_wait(&solver->wake, &solver->lock);
+        if (solver->shutdown)
+            break;
+        generation = solver->generation;
+        mmmutex_unlock(&solver->lock);
+        nex_worker_run(worker);
+        mmmutex_lock(&solver->lock);
+        if (++solver->done == solver->worker_count - 1)
+            mmcond_broadcast(&solver->finished);
+    }
+    mmmutex_unlock(&solver->lock);
+}
+// rates all guesses of a selection, on all workers if it is worth it
+static struct mmrating nex_solver_run(struct mmsolver *solver, const struct mmselection *job) {
+    struct mmrating rt = { UINT64_MAX, false, UINT32_MAX }; // rt means return value
+    unsigned int n, workers = solver->worker_count;
+    if ((uint64_t)job->guess_count * job->count < MMSOLVER_PARALLEL_MIN)
+        workers = 1;
+    solver->job = job;
+    for (n = 0; n < solver->worker_count; n++) { // split the guesses evenly, idle workers will steal
+        uint32_t begin = n < workers ? (uint32_t)((uint64_t)job->guess_count * n / workers) : 0,
+            end = n < workers ? (uint32_t)((uint64_t)job->guess_count * (n + 1) / workers) : 0;
+        solver->workers[n].best = rt;
+        mmatomic_store(&solver->workers[n].range, (uint64_t)end << 32 | begin);
+    }
+    if (workers == 1) {
+        nex_worker_run(&solver->workers[0]);
+        return solver->workers[0].best;
+    }
+    mmmutex_lock(&solver->lock);
+    solver->done = 0;
+    solver->generation++;
+    mmcond_broadcast(&solver->wake);
+    mmmutex_unlock(&solver->lock);
+    nex_worker_run(&solver->workers[0]);
+    mmmutex_lock(&solver->lock);
+    while (solver->done < solver->worker_count - 1)
+        mmcond_wait(&solver->finished, &solver->lock);
+    mmmutex_unlock(&solver->lock);
+    // reduce: the order of the guesses decides ties, so the result never depends on the threads
+    for (n = 0; n < solver->worker_count; n++) {
+        if (nex_rating_better(solver->workers[n].best, rt))
+            rt = solver->workers[n].best;
+    }
+    return rt;
+}
+// orders scored codes by feedback (high 32 bits) so that partitions are consecutive
+static int nex_compare_scored(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+static bool nex_solver_endgame(struct mmsolver *solver, const MMCODE *codes, size_t count,
+    unsigned int attempts, uint64_t *budget, MMCODE *guess);
+// checks if guess finds every code of codes within attempts guesses (guess included)
+static bool nex_solver_endgame_guess(struct mmsolver *solver, MMCODE guess, const MMCODE *codes,
+    size_t count, unsigned int attempts, uint64_t *budget) {
+    MMFEEDBACK solved = nex_solved_feedback(&solver->prefs);
+    uint64_t *scored;
+    MMCODE *group, next;
+    size_t n, m;
+    bool rt = true; // rt means return value
+    if (*budget < count)
+        return false;
+    *budget -= count;
+    scored = malloc(count * sizeof(uint64_t));
+    group = malloc(count * sizeof(MMCODE));
+    if (!scored || !group) {
+        free(scored);
+        free(group);
+        return false;
+    }
+    for (n = 0; n < count; n++) // codes of enumerable preferences fit into 32 bits
+        scored[n] = (uint64_t)solver->scorer->score(&solver->prefs, guess, codes[n]) << 32 | codes[n];
+    qsort(scored, count, sizeof(uint64_t), nex_compare_scored);
+    // every partition must be solvable with the attempts left
+    for (n = 0; n < count && rt; n = m) {
+        for (m = n; m < count && scored[m] >> 32 == scored[n] >> 32; m++)
+            group[m - n] = (MMCODE)scored[m];
+        if ((MMFEEDBACK)(scored[n] >> 32) == solved)
+            continue;
+        if (attempts < 2 || (attempts == 2 && m - n > 1))
+            rt = false;
+        else
+            rt = nex_solver_endgame(solver, group, m - n, attempts - 1, budget, &next);
+    }
+    free(scored);
+    free(group);
+    return rt;
+}
+// searches a guess which finds every code of codes within attempts guesses for sure
+static bool nex_solver_endgame(struct mmsolver *solver, const MMCODE *codes, size_t count,
+    unsigned int attempts, uint64_t *budget, MMCODE *guess) {
+    uint64_t n, pool_count = count;
+    if (count == 1 || attempts == 0) {
+        *guess = codes[0];
+        return count == 1 && attempts > 0;
+    }
+    // the candidates first, then every code if the budget allows it
+    if (attempts > 2 && (uint64_t)count * solver->code_count <= *budget)
+        pool_count += solver->code_count;
+    for (n = 0; n < pool_count && *budget >= count; n++) {
+        MMCODE g = n < count ? codes[n] : mastermind_code_unrank(&solver->prefs, (uint32_t)(n - count));
+        if (nex_solver_endgame_guess(solver, g, codes, count, attempts, budget)) {
+            *guess = g;
+            return true;
+        }
+    }
+    return false;
+}
+// creates the first guesses worth trying: with no feedback so far all codes with
+// the same color pattern are equal, so one code per partition of code_length is enough
+static size_t nex_first_guesses(const MASTERMIND_PREFERENCES *prefs, MMCODE *out) {
+    unsigned int parts[MMPREFS_MAX_CODE_LENGTH], part_count = 1;
+    size_t count = 0;
+    parts[0] = prefs->code_length;
+    while (1) {
+        if (part_count <= prefs->color_count) { // write the pattern, e.g. { 2, 1, 1 } -> aabc
+            MMCODE code = 0;
+            unsigned int n, m, peg = 0;
+            for (n = 0; n < part_count; n++) {
+                for (m = 0; m < parts[n]; m++, peg++)
+                    code |= (MMCODE)n << (MMCODE_PEG_BITS * peg);
+            }
+            out[count++] = code;
+        }
+        // next partition in reverse lexicographic order
+        unsigned int rest = 0;
+        while (part_count > 0 && parts[part_count - 1] == 1)
+            rest += parts[--part_count];
+        if (part_count == 0)
+            break;
+        unsigned int value = --parts[part_count - 1];
+        rest++;
+        while (rest > value) {
+            parts[part_count++] = value;
+            rest -= value;
+        }
+        parts[part_count++] = rest;
+    }
+    return count;
+}
+// gets the transposition table key of the game state: the candidates and everything else the selection depends on
+static uint64_t nex_solver_key(const struct mmsolver *solver) {
+    const MASTERMIND_PREFERENCES *prefs = &solver->prefs;
+    unsigned int attempts = prefs->attempt_count - solver->attempt;
+    uint64_t rt = prefs->code_length | prefs->color_count << 8 | prefs->multiple_colors << 16 | // rt means return value
+        prefs->hints_position_based << 17 | prefs->consistent_only << 18 | (uint64_t)prefs->strategy << 20 |
+        (uint64_t)(attempts < 4 ? attempts : 4) << 24 | (uint64_t)(solver->attempt == 0) << 28; // 4+ attempts are alike
+    return mastermind_mix64(rt) ^ mastermind_candidates_hash(solver->candidates);
+}
+// checks if the guesses are searched by constraint propagation: position based hints beyond enumeration or by strategy
+static bool nex_solver_propagates(const MASTERMIND_PREFERENCES *prefs) {
+    return prefs->hints_position_based &&
+        (prefs->strategy == MMSTRATEGY_PROPAGATE || !mastermind_prefs_enumerable(prefs));
+}
+// selects the guess with the best partitions: smallest worst case (Knuth's minimax) or max. entropy
+static MMCODE nex_solver_select(struct mmsolver *solver, uint64_t *cost) {
+    struct mmselection job = { NULL, NULL, 0, 0, NULL, NULL, 0 };
+    MMCODE patterns[32], best_guess;
+    uint32_t pattern_ranks[32];
+    size_t n;
+    unsigned int attempts = solver->prefs.attempt_count - solver->attempt;
+    struct mmrating best;
+    job.count = nex_solver_sample(solver);
+    job.codes = solver->sample;
+    job.ranks = solver->sample_ranks;
+    *cost = 0;
+    if (job.count <= 2) // nothing left to learn
+        return job.codes[0];
+    if (attempts <= 1) { // last attempt: only a candidate can win
+        job.pool = job.codes;
+        job.pool_ranks = job.ranks;
+        job.pool_count = job.guess_count = job.count;
+    }
+    else if (solver->attempt == 0) { // first guess: one code per color pattern
+        job.pool_count = job.guess_count = nex_first_guesses(&solver->prefs, patterns);
+        for (n = 0; n < job.pool_count && solver->table; n++)
+            pattern_ranks[n] = mastermind_code_rank(&solver->prefs, patterns[n]);
+        job.pool = patterns;
+        job.pool_ranks = solver->table ? pattern_ranks : NULL;
+    }
+    else if (!solver->prefs.consistent_only && (uint64_t)job.count * solver->code_count <= MMSOLVER_WORK_BUDGET) {
+        job.guess_count = solver->code_count; // every code may be the guess
+    }
+    else { // too expensive or not wanted: only an evenly spread part of the candidates may be the guess
+        job.pool = job.codes;
+        job.pool_ranks = job.ranks;
+        job.pool_count = job.count;
+        job.guess_count = MMSOLVER_WORK_BUDGET / job.count;
+        if (job.guess_count > job.count)
+            job.guess_count = job.count;
+    }
+    best = nex_solver_run(solver, &job);
+    if (mmatomic_load(&solver->cancel)) // the guess is not needed anymore, any code will do
+        return job.codes[0];
+    *cost = best.cost;
+    if (job.pool)
+        best_guess = job.pool[(size_t)((uint64_t)best.index * job.pool_count / job.guess_count)];
+    else
+        best_guess = mastermind_code_unrank(&solver->prefs, best.index);
+    // few attempts left: the rating does not know about them, so make sure the guess wins in time
+    if (attempts <= 3 && job.count == mastermind_candidates_count(solver->candidates) &&
+        job.count <= MMSOLVER_ENDGAME_MAX) {
+        uint64_t budget = MMSOLVER_ENDGAME_BUDGET;
+        MMCODE guess;
+        if (!nex_solver_endgame_guess(solver, best_guess, job.codes, job.count, attempts, &budget) &&
+            nex_solver_endgame(solver, job.codes, job.count, attempts, &budget, &guess))
+            best_guess = guess;
+    }
+    return best_guess;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+MASTERMIND_SOLVER *mastermind_solver_create(const MASTERMIND_PREFERENCES *prefs, const MASTERMIND_SCORETABLE *table) {
+    struct mmsolver *solver = calloc(1, sizeof(struct mmsolver));
+    unsigned int n;
+    if (!solver)
+        return NULL;
+    solver->prefs = *prefs;
+    solver->scorer = mastermind_scorer(prefs);
+    mmmutex_init(&solver->lock);
+    mmcond_init(&solver->wake);
+    mmcond_init(&solver->finished);
+    if (nex_solver_propagates(prefs)) { // the feedbacks describe the consistent codes completely as domains
+        if (!(solver->propagate = mmpropagate_create(prefs))) {
+            mastermind_solver_destroy(solver);
+            return NULL;
+        }
+        return solver;
+    }
+    if (!mastermind_prefs_enumerable(prefs)) { // no candidate set possible, the guesses are searched
+        if (!(solver->genetic = mmgenetic_create(prefs))) {
+            mastermind_solver_destroy(solver);
+            return NULL;
+        }
+        return solver;
+    }
+    solver->table = table && table->feedback ? table : NULL;
+    solver->code_count = mastermind_code_count(prefs);
+    solver->sample = malloc(MMSOLVER_SAMPLE_MAX * sizeof(MMCODE));
+    solver->sample_ranks = solver->table ? malloc(MMSOLVER_SAMPLE_MAX * sizeof(uint32_t)) : NULL;
+    solver->candidates = mastermind_candidates_create(prefs);
+    if (prefs->strategy == MMSTRATEGY_MINIMAX && !prefs->consistent_only) // the book holds guesses of minimax
+        solver->book_root = mastermind_book_root(prefs->book, prefs);
+    if (prefs->strategy == MMSTRATEGY_ENTROPY && (solver->log2 = malloc((MMSOLVER_SAMPLE_MAX + 1) * sizeof(uint64_t)))) {
+        solver->log2[0] = 0;
+        for (n = 1; n <= MMSOLVER_SAMPLE_MAX; n++)
+            solver->log2[n] = nex_log2(n);
+    }
+    solver->solved = solver->table ? mastermind_feedback_index(prefs, nex_solved_feedback(prefs)) :
+        MMSOLVER_HISTOGRAM_INDEX(nex_solved_feedback(prefs));
+    solver->worker_count = prefs->thread_count ? prefs->thread_count : mmthread_cpu_count();
+    solver->workers = calloc(solver->worker_count, sizeof(struct mmworker));
+    if (!solver->candidates || !solver->sample || (solver->table && !solver->sample_ranks) || !solver->workers ||
+        (prefs->strategy == MMSTRATEGY_ENTROPY && !solver->log2)) {
+        solver->worker_count = 0;
+        mastermind_solver_destroy(solver);
+        return NULL;
+    }
+    for (n = 0; n < solver->worker_count; n++) {
+        struct mmworker *worker = &solver->workers[n];
+        worker->solver = solver;
+        worker->index = n;
+        worker->scores = malloc(MMSOLVER_SAMPLE_MAX * sizeof(MMFEEDBACK));
+        worker->histogram = calloc(MMSOLVER_HISTOGRAM_SIZE, sizeof(uint32_t));
+        if (!worker->scores || !worker->histogram || (n > 0 && !mmthread_create(&worker->thread, nex_worker_main, worker))) {
+            free(worker->scores);
+            free(worker->histogram);
+            solver->worker_count = n; // only the workers before are running
+            mastermind_solver_destroy(solver);
+            return NULL;
+        }
+    }
+    if (!mastermind_solver_reset(solver)) {
+        mastermind_solver_destroy(solver);
+        return NULL;
+    }
+    return solver;
+}
+
+bool mastermind_solver_reset(MASTERMIND_SOLVER *solver) {
+    solver->attempt = 0;
+    solver->book_node = solver->book_root;
+    if (solver->propagate)
+        mmpropagate_reset(solver->propagate);
+    else if (solver->genetic)
+        mmgenetic_reset(solver->genetic);
+    else
+        mastermind_candidates_reset(solver->candidates);
+    return true;
+}
+
+MMCODE mastermind_solver_guess(MASTERMIND_SOLVER *solver) {
+    MMCODE rt = MMBOOK_NO_GUESS; // rt means return value
+    MMSTATS_START(timer);
+    if (solver->book_node) // known opening: no computation at all
+        rt = mastermind_book_guess(solver->prefs.book, solver->book_node);
+    if (solver->propagate)
+        rt = mmpropagate_guess(solver->propagate, solver->guesses, solver->feedbacks, solver->attempt);
+    else if (solver->genetic)
+        rt = mmgenetic_guess(solver->genetic, solver->guesses, solver->feedbacks, solver->attempt);
+    else if (rt == MMBOOK_NO_GUESS) { // another game may have had the same candidates before
+        MASTERMIND_TTABLE *ttable = solver->prefs.ttable;
+        uint64_t key = ttable ? nex_solver_key(solver) : 0, cost;
+        if (!ttable || !mastermind_ttable_lookup(ttable, key, &rt, &cost)) {
+            rt = nex_solver_select(solver, &cost);
+            if (ttable && !mmatomic_load(&solver->cancel))
+                mastermind_ttable_store(ttable, key, rt, cost);
+        }
+    }
+    MMSTATS_STOP(MMSTATS_SOLVER, timer);
+    return rt;
+}
+
+bool mastermind_solver_feedback(MASTERMIND_SOLVER *solver, MMCODE guess, MMFEEDBACK feedback) {
+    if (solver->attempt >= MMPREFS_MAX_ATTEMPT_COUNT)
+        return false;
+    solver->guesses[solver->attempt] = guess;
+    solver->feedbacks[solver->attempt++] = feedback;
+    if (solver->propagate || solver->genetic) // the next search takes all feedbacks into account
+        return true;
+    // the book only knows the states after its own guesses
+    if (solver->book_node && mastermind_book_guess(solver->prefs.book, solver->book_node) == guess)
+        solver->book_node = mastermind_book_child(solver->prefs.book, solver->book_node,
+            mastermind_feedback_index(&solver->prefs, feedback));
+    else
+        solver->book_node = 0;
+    // keep only the candidates which would have given the same feedback
+    mastermind_candidates_prune(solver->candidates, guess, feedback);
+    return true;
+}
+
+const char *mastermind_solver_name(const MASTERMIND_PREFERENCES *prefs) {
+    if (nex_solver_propagates(prefs))
+        return "propagate";
+    if (!mastermind_prefs_enumerable(prefs))
+        return "genetic";
+    return prefs->strategy == MMSTRATEGY_ENTROPY ? "entropy" : "minimax";
+}
+
+void mastermind_solver_cancel(MASTERMIND_SOLVER *solver, bool cancel) {
+    mmatomic_store(&solver->cancel, cancel);
+}
+
+size_t mastermind_solver_remaining(const MASTERMIND_SOLVER *solver) {
+    if (solver->propagate) // the domains do not tell how many codes they hold
+        return 0;
+    if (solver->genetic)
+        return mmgenetic_found(solver->genetic);
+    return mastermind_candidates_count(solver->candidates);
+}
+
+void mastermind_solver_destroy(MASTERMIND_SOLVER *solver) {
+    unsigned int n;
+    if (!solver)
+        return;
+    mmmutex_lock(&solver->lock);
+    solver->shutdown = true;
+    mmcond_broadcast(&solver->wake);
+    mmmutex_unlock(&solver->lock);
+    for (n = 0; n < solver->worker_count; n++) {
+        if (n > 0)
+            mmthread_join(solver->workers[n].thread);
+        free(solver->workers[n].scores);
+        free(solver->workers[n].histogram);
+    }
+    mmcond_destroy(&solver->finished);
+    mmcond_destroy(&solver->wake);
+    mmmutex_destroy(&solver->lock);
+    free(solver->workers);
+    mastermind_candidates_destroy(solver->candidates);
+    mmgenetic_destroy(solver->genetic);
+    mmpropagate_destroy(solver->propagate);
+    free(solver->sample);
+    free(solver->sample_ranks);
+    free(solver->log2);
+    free(solver);
+}
+
+
+
+// End of source file 'mmsolver.c'
@@ -0,0 +1,217 @@
+/*!mmstats.c
+ * Hot path instrumentation for game MasterMind (see mmstats.h).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mmstats.h"
+
+#if defined(MMSTATS)
+
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <string.h>
+#if defined(__usinglinux__)
+    #include <signal.h>
+#endif
+
+// histogram buckets, bucket n counts the measurements of [2^(n-1), 2^n) ticks
+#define MMSTATS_BUCKETS 65
+
+// counters of one phase
+struct mmstatsphase {
+    uint64_t count,
+        ticks,
+        max;
+    uint64_t histogram[MMSTATS_BUCKETS];
+};
+
+// buffer of one thread, never freed so that the stats of finished threads are kept
+struct mmstatsthread {
+    struct mmstatsthread *next;
+    struct mmstatsphase phases[MMSTATS_PHASE_COUNT];
+};
+
+static const char *const stats_names[MMSTATS_PHASE_COUNT] = {
+    "input", "render", "score", "prune", "solver", "request"
+};
+
+// shared state, the buffers are a list every thread pushes itself onto
+static struct {
+    volatile uint64_t threads, // struct mmstatsthread * of the last registered thread
+        started, // 1 once the first thread has set up the rest
+        requested; // 1 after SIGUSR1 until the stats are written
+    uint64_t start_ticks;
+    double start_time;
+    bool json;
+    const char *file; // NULL = stderr
+} stats;
+
+static _Thread_local struct mmstatsthread *stats_local;
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// gets the index of the highest set bit plus one, 0 for 0
+static unsigned int nex_stats_bucket(uint64_t ticks) {
+    #if defined(__GNUC__)
+    return ticks ? 64 - __builtin_clzll(ticks) : 0;
+    #else
+    unsigned int rt = 0; // rt means return value
+    for (; ticks; ticks >>= 1)
+        rt++;
+    return rt;
+    #endif
+}
+// gets the number of ticks per nanosecond, measured since the first record
+static double nex_stats_rate(void) {
+    double seconds = mmtime_now() - stats.start_time;
+    if (seconds <= 0)
+        return 1;
+    return (double)(mmstats_ticks() - stats.start_ticks) / (seconds * 1e9);
+}
+// gets the upper end of the bucket a quantile of phase falls into (at most the max.), in ticks
+static double nex_stats_quantile(const struct mmstatsphase *phase, double quantile) {
+    uint64_t rank = (uint64_t)(quantile * phase->count), seen = 0;
+    unsigned int n;
+    if (!phase->count)
+        return 0;
+    for (n = 0; n < MMSTATS_BUCKETS; n++) {
+        if ((seen += phase->histogram[n]) > rank)
+            break;
+    }
+    if (n >= 64 || (1ull << n) > phase->max)
+        return (double)phase->max;
+    return (double)(1ull << n);
+}
+// writes the sum of all thread buffers, the counters of running threads may be a bit off
+static void nex_stats_dump(void) {
+    struct mmstatsphase sum[MMSTATS_PHASE_COUNT];
+    const struct mmstatsthread *thread;
+    unsigned int threads = 0, n, m;
+    double rate = nex_stats_rate();
+    FILE *file = stats.file ? fopen(stats.file, "a") : stderr;
+    if (!file)
+        return;
+    memset(sum, 0, sizeof(sum));
+    for (thread = (const struct mmstatsthread *)(uintptr_t)mmatomic_load(&stats.threads); thread; thread = thread->next) {
+        for (n = 0; n < MMSTATS_PHASE_COUNT; n++) {
+            const struct mmstatsphase *phase = &thread->phases[n];
+            sum[n].count += phase->count;
+            sum[n].ticks += phase->ticks;
+            if (phase->max > sum[n].max)
+                sum[n].max = phase->max;
+            for (m = 0; m < MMSTATS_BUCKETS; m++)
+                sum[n].histogram[m] += phase->histogram[m];
+        }
+        threads++;
+    }
+    if (stats.json) {
+        fprintf(file, "{\"threads\":%u,\"ticks_per_ns\":%.4f,\"phases\":{", threads, rate);
+        for (n = 0; n < MMSTATS_PHASE_COUNT; n++) {
+            const char *separator = "";
+            fprintf(file, "%s\"%s\":{\"count\":%llu,\"total_ns\":%.0f,\"mean_ns\":%.1f,\"p50_ns\":%.0f,"
+                "\"p99_ns\":%.0f,\"max_ns\":%.0f,\"histogram\":[", n ? "," : "", stats_names[n],
+                (unsigned long long)sum[n].count, sum[n].ticks / rate,
+                sum[n].count ? sum[n].ticks / rate / sum[n].count : 0.0, nex_stats_quantile(&sum[n], 0.5) / rate,
+                nex_stats_quantile(&sum[n], 0.99) / rate, sum[n].max / rate);
+            for (m = 0; m < MMSTATS_BUCKETS; m++) { // [upper end in ns, count] of the used buckets
+                if (!sum[n].histogram[m])
+                    continue;
+                fprintf(file, "%s[%.0f,%llu]", separator, (m < 64 ? (double)(1ull << m) : (double)UINT64_MAX) / rate,
+                    (unsigned long long)sum[n].histogram[m]);
+                separator = ",";
+            }
+            fprintf(file, "]}");
+        }
+        fprintf(file, "}}\n");
+    }
+    else {
+        fprintf(file, "mmstats: %u threads, %.3f ticks/ns, quantiles are upper ends of power of two buckets\n",
+            threads, rate);
+        fprintf(file, "%-8s %12s %12s %10s %10s %10s %10s\n",
+            "phase", "count", "total ms", "mean us", "p50 us", "p99 us", "max us");
+        for (n = 0; n < MMSTATS_PHASE_COUNT; n++) {
+            if (!sum[n].count)
+                continue;
+            fprintf(file, "%-8s %12llu %12.3f %10.3f %10.3f %10.3f %10.3f\n", stats_names[n],
+                (unsigned long long)sum[n].count, sum[n].ticks / rate * 1e-6, sum[n].ticks / rate / sum[n].count * 1e-3,
+                nex_stats_quantile(&sum[n], 0.5) / rate * 1e-3, nex_stats_quantile(&sum[n], 0.99) / rate * 1e-3,
+                sum[n].max / rate * 1e-3);
+        }
+    }
+    if (file == stderr)
+        fflush(file);
+    else
+        fclose(file);
+}
+#if defined(__usinglinux__)
+// asks the next recording thread to write the stats (SIGUSR1)
+static void nex_stats_signal(int signal_number) {
+    (void)signal_number;
+    stats.requested = 1;
+}
+#endif
+// sets up the output on the first record of the process
+static void nex_stats_start(void) {
+    const char *format = getenv("MMSTATS_FORMAT");
+    stats.start_time = mmtime_now();
+    stats.start_ticks = mmstats_ticks();
+    stats.json = format && strcmp(format, "json") == 0;
+    stats.file = getenv("MMSTATS_FILE");
+    atexit(nex_stats_dump);
+    #if defined(__usinglinux__)
+    signal(SIGUSR1, nex_stats_signal);
+    #endif
+}
+// creates the buffer of the calling thread, returns NULL if out of memory
+static struct mmstatsthread *nex_stats_register(void) {
+    struct mmstatsthread *thread = calloc(1, sizeof(struct mmstatsthread));
+    uint64_t head;
+    if (!thread)
+        return NULL;
+    if (mmatomic_cas(&stats.started, 0, 1))
+        nex_stats_start();
+    do {
+        head = mmatomic_load(&stats.threads);
+        thread->next = (struct mmstatsthread *)(uintptr_t)head;
+    } while (!mmatomic_cas(&stats.threads, head, (uint64_t)(uintptr_t)thread));
+    return stats_local = thread;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+#if !defined(mmstats_ticks)
+uint64_t mmstats_ticks(void) {
+    return (uint64_t)(mmtime_now() * 1e9);
+}
+#endif
+
+void mmstats_record(MMSTATS_PHASE phase, uint64_t ticks) {
+    struct mmstatsthread *thread = stats_local ? stats_local : nex_stats_register();
+    struct mmstatsphase *counters;
+    if (!thread)
+        return;
+    counters = &thread->phases[phase];
+    counters->count++;
+    counters->ticks += ticks;
+    if (ticks > counters->max)
+        counters->max = ticks;
+    counters->histogram[nex_stats_bucket(ticks)]++;
+    if (stats.requested && mmatomic_cas(&stats.requested, 1, 0))
+        nex_stats_dump();
+}
+
+#endif
+
+
+
+// End of source file 'mmstats.c'
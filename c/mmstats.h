@@ -0,0 +1,61 @@
+/*!mmstats.h
+ * Hot path instrumentation for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Built with MMSTATS defined (make STATS=1) every phase below is timed with
+ * the time stamp counter (clock_gettime() or QueryPerformanceCounter() on
+ * other processors). Every thread counts into its own buffer: number, total
+ * and max. ticks and a histogram with one bucket per power of two.
+ *
+ * The sum of all threads is written on exit and on SIGUSR1 (Linux, at the
+ * next measured event) to stderr or to the file $MMSTATS_FILE, as a table
+ * or with MMSTATS_FORMAT=json as one JSON object per line.
+ *
+ * Without MMSTATS the macros are empty and nothing is compiled in.
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMSTATS_H
+#define MMSTATS_H
+
+#include "mastermind.h"
+
+// measured phases
+typedef enum {
+    MMSTATS_INPUT, // waiting for a key
+    MMSTATS_RENDER, // writing the changed cells to the terminal
+    MMSTATS_SCORE, // batch function of a scorer (mastermind_score_batch())
+    MMSTATS_PRUNE, // removing the candidates inconsistent with a feedback
+    MMSTATS_SOLVER, // guess selection of the COMSOLVER
+    MMSTATS_REQUEST, // one request line of mmserver
+    MMSTATS_PHASE_COUNT
+} MMSTATS_PHASE;
+
+#if defined(MMSTATS)
+    #if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        #if defined(_MSC_VER)
+            #include <intrin.h>
+        #else
+            #include <x86intrin.h>
+        #endif
+        #define mmstats_ticks() ((uint64_t)__rdtsc())
+    #else
+        // gets a time stamp in ticks
+        uint64_t mmstats_ticks(void);
+    #endif
+    // adds one measurement of a phase to the buffer of the calling thread
+    void mmstats_record(MMSTATS_PHASE phase, uint64_t ticks);
+    // declares timer and starts it
+    #define MMSTATS_START(timer) uint64_t timer = mmstats_ticks()
+    // records the ticks since MMSTATS_START(timer) for phase
+    #define MMSTATS_STOP(phase, timer) mmstats_record(phase, mmstats_ticks() - (timer))
+#else
+    #define MMSTATS_START(timer)
+    #define MMSTATS_STOP(phase, timer)
+#endif
+
+// end of MMSTATS_H include guard
+#endif
@@ -0,0 +1,394 @@
+/*!mmterminal.c
+ * Terminal backends of the frame buffer for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#include "mastermind.h"
+#include "mmscreen.h"
+
+#if defined(__usingwindows__)
+    #include <stdio.h>
+    #include <conio.h>
+    #include <Windows.h>
+#elif defined(__usinglinux__)
+    // Note: curses.h auto-includes stdio.h !!
+    #include <curses.h>
+    #include <signal.h>
+    #include <sys/select.h>
+    #include <termios.h>
+    #include <unistd.h>
+#endif
+
+#include <string.h>
+
+// size of the output buffer of the ANSI backend, a full frame is about 4 KB
+#define MMANSI_BUFFER_SIZE 16384
+// how long the ANSI backend waits for the rest of an escape sequence
+#define MMANSI_ESCAPE_MS 25
+// returned by nex_ansi_read() if no byte arrived in time
+#define MMANSI_TIMEOUT (-2)
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// converts the red, green and blue bits of a console color nibble to the ANSI/curses color order
+static int nex_color_index(int nibble) {
+    return ((nibble & 4) ? 1 : 0) | ((nibble & 2) ? 2 : 0) | ((nibble & 1) ? 4 : 0);
+}
+
+#if defined(__usingwindows__)
+/*** Windows console ***/
+
+// the console is not cleared, the widget starts at the row of the cursor
+static bool nex_console_open(const char *capture, int *origin_x, int *origin_y) {
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+        return false;
+    *origin_x = 0;
+    *origin_y = info.dwCursorPosition.Y;
+    return true;
+}
+// one WriteConsoleA per color
+static void nex_console_write(int x, int y, const struct mmcell *cells, int count) {
+    HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
+    COORD pos = { .X = x, .Y = y };
+    char text[MMSCREEN_WIDTH];
+    DWORD written;
+    int n, start;
+    SetConsoleCursorPosition(hout, pos);
+    for (start = 0; start < count; start = n) {
+        for (n = start; n < count && cells[n].color == cells[start].color; n++)
+            text[n - start] = cells[n].ch;
+        SetConsoleTextAttribute(hout, cells[start].color);
+        WriteConsoleA(hout, text, n - start, &written, NULL);
+    }
+}
+// the console shows everything immediately, only the cursor is left
+static size_t nex_console_flush(int x, int y, unsigned char color) {
+    HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
+    COORD pos = { .X = x, .Y = y };
+    SetConsoleCursorPosition(hout, pos);
+    SetConsoleTextAttribute(hout, color);
+    return 0;
+}
+// reads a key without echo, polls the keyboard if the wait is limited
+static int nex_console_getkey(int timeout_ms) {
+    DWORD start = GetTickCount();
+    int rt; // rt means return value
+    while (timeout_ms >= 0 && !_kbhit()) {
+        if (GetTickCount() - start >= (DWORD)timeout_ms)
+            return MMKEY_NONE;
+        Sleep(10);
+    }
+    rt = _getch();
+    return rt == '\n' ? MMKEY_ENTER : rt;
+}
+// nothing to restore
+static void nex_console_close(void) {
+}
+
+static const struct mmterminal nex_console = {
+    "console", false, nex_console_open, nex_console_write, nex_console_flush, nex_console_getkey, nex_console_close
+};
+
+#elif defined(__usinglinux__)
+/*** curses ***/
+
+// color pair of every console color, 0 = not initialized yet
+static short curses_pairs[256];
+static short curses_pair_count;
+
+// gets the curses attribute of a console color
+static chtype nex_curses_attr(unsigned char color) {
+    int fg = color & 0x0F, bg = color >> 4;
+    chtype rt = 0; // rt means return value
+    if (!has_colors())
+        return 0;
+    if (!curses_pairs[color] && curses_pair_count + 1 < COLOR_PAIRS) {
+        // 8 color terminals show bright foregrounds bold and ignore bright backgrounds
+        bool bright = COLORS >= 16;
+        curses_pairs[color] = ++curses_pair_count;
+        init_pair(curses_pairs[color], nex_color_index(fg) + (bright && (fg & 8) ? 8 : 0),
+            nex_color_index(bg) + (bright && (bg & 8) ? 8 : 0));
+    }
+    if (curses_pairs[color])
+        rt |= COLOR_PAIR(curses_pairs[color]);
+    if (COLORS < 16 && (fg & 8))
+        rt |= A_BOLD;
+    return rt;
+}
+// initializes curses, which clears the terminal
+static bool nex_curses_open(const char *capture, int *origin_x, int *origin_y) {
+    initscr();
+    noecho();
+    keypad(stdscr, TRUE);
+    if (has_colors())
+        start_color();
+    memset(curses_pairs, 0, sizeof(curses_pairs));
+    curses_pair_count = 0;
+    *origin_x = *origin_y = 0;
+    return true;
+}
+// writes to the curses screen, which is compared with the terminal on refresh()
+static void nex_curses_write(int x, int y, const struct mmcell *cells, int count) {
+    int n;
+    move(y, x);
+    for (n = 0; n < count; n++)
+        addch((unsigned char)cells[n].ch | nex_curses_attr(cells[n].color));
+}
+// one refresh() per frame, curses does not tell how many bytes it writes
+static size_t nex_curses_flush(int x, int y, unsigned char color) {
+    move(y, x);
+    refresh();
+    return 0;
+}
+// reads a key with the keypad translated by curses
+static int nex_curses_getkey(int timeout_ms) {
+    int rt; // rt means return value
+    wtimeout(stdscr, timeout_ms);
+    rt = wgetch(stdscr);
+    if (rt == KEY_BACKSPACE || rt == 127)
+        return MMKEY_BACKSPACE;
+    if (rt == KEY_ENTER || rt == '\r')
+        return MMKEY_ENTER;
+    if (rt == ERR) // a blocking read only fails at end of input
+        return timeout_ms >= 0 ? MMKEY_NONE : 'q';
+    return rt;
+}
+// clean up screen for further use of the 'normal' shell
+static void nex_curses_close(void) {
+    endwin();
+}
+
+static const struct mmterminal nex_curses = {
+    "curses", false, nex_curses_open, nex_curses_write, nex_curses_flush, nex_curses_getkey, nex_curses_close
+};
+
+/*** raw ANSI/VT100 ***/
+
+// state of the ANSI backend
+struct mmansi {
+    char buffer[MMANSI_BUFFER_SIZE]; // escape sequences and text of the current frame
+    size_t used;
+    int x, y, // cursor after the buffered output, -1 = unknown
+        color; // color of the buffered output, -1 = unknown
+    int pending; // byte read ahead after an escape, -1 = none
+    size_t drained; // bytes written since the last flush
+    bool virtual, // nothing is written to the terminal (virtual backend)
+        raw; // termios has to be restored
+    struct termios saved;
+    FILE *capture; // gets a copy of the output or NULL
+};
+
+static struct mmansi ansi;
+
+// writes the whole buffer with one system call (and to the capture file)
+static void nex_ansi_drain(void) {
+    size_t done = 0;
+    while (!ansi.virtual && done < ansi.used) {
+        ssize_t n = write(STDOUT_FILENO, ansi.buffer + done, ansi.used - done);
+        if (n <= 0)
+            break; // the terminal is gone, nothing sensible left to do
+        done += n;
+    }
+    if (ansi.capture)
+        fwrite(ansi.buffer, 1, ansi.used, ansi.capture);
+    ansi.drained += ansi.used;
+    ansi.used = 0;
+}
+// appends bytes to the buffer
+static void nex_ansi_emit(const char *text, size_t length) {
+    if (ansi.used + length > sizeof(ansi.buffer))
+        nex_ansi_drain();
+    memcpy(ansi.buffer + ansi.used, text, length);
+    ansi.used += length;
+}
+// appends the cursor position sequence if the cursor is elsewhere
+static void nex_ansi_move(int x, int y) {
+    char text[16];
+    if (x == ansi.x && y == ansi.y)
+        return;
+    nex_ansi_emit(text, snprintf(text, sizeof(text), "\033[%d;%dH", y + 1, x + 1));
+    ansi.x = x;
+    ansi.y = y;
+}
+// appends the color sequence if the color changes
+static void nex_ansi_color(int color) {
+    char text[16];
+    int fg = color & 0x0F, bg = color >> 4;
+    if (color == ansi.color)
+        return;
+    nex_ansi_emit(text, snprintf(text, sizeof(text), "\033[%d;%dm",
+        ((fg & 8) ? 90 : 30) + nex_color_index(fg), ((bg & 8) ? 100 : 40) + nex_color_index(bg)));
+    ansi.color = color;
+}
+// leaves raw mode and the alternate screen
+static void nex_ansi_restore(void) {
+    static const char text[] = "\033[0m\033[?1049l";
+    nex_ansi_emit(text, sizeof(text) - 1);
+    nex_ansi_drain();
+    if (ansi.raw)
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &ansi.saved);
+    ansi.raw = false;
+}
+// restores the terminal if the game is interrupted, then dies of the signal as usual
+static void nex_ansi_signal(int signal_number) {
+    nex_ansi_restore();
+    signal(signal_number, SIG_DFL);
+    raise(signal_number);
+}
+// reads a byte, -1 at end of input or MMANSI_TIMEOUT if none arrives within timeout_ms (negative = forever)
+static int nex_ansi_read(int timeout_ms) {
+    unsigned char c;
+    if (timeout_ms >= 0) {
+        fd_set fds;
+        struct timeval timeout = { timeout_ms / 1000, timeout_ms % 1000 * 1000 };
+        FD_ZERO(&fds);
+        FD_SET(STDIN_FILENO, &fds);
+        if (select(STDIN_FILENO + 1, &fds, NULL, NULL, &timeout) <= 0)
+            return MMANSI_TIMEOUT;
+    }
+    return read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
+// switches to the alternate screen and to raw input, no terminfo is needed
+static bool nex_ansi_open(const char *capture, int *origin_x, int *origin_y) {
+    static const char text[] = "\033[?1049h\033[0m\033[2J";
+    struct termios raw;
+    memset(&ansi, 0, sizeof(ansi));
+    ansi.x = ansi.y = ansi.color = ansi.pending = -1;
+    if (capture && !(ansi.capture = fopen(capture, "wb")))
+        return false;
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &ansi.saved) == 0) {
+        raw = ansi.saved;
+        raw.c_iflag &= ~(ICRNL | IXON);
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        ansi.raw = tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0;
+    }
+    signal(SIGINT, nex_ansi_signal);
+    signal(SIGTERM, nex_ansi_signal);
+    nex_ansi_emit(text, sizeof(text) - 1);
+    *origin_x = *origin_y = 0;
+    return true;
+}
+// appends the cells, the terminal itself sees nothing before flush
+static void nex_ansi_write(int x, int y, const struct mmcell *cells, int count) {
+    int n;
+    nex_ansi_move(x, y);
+    for (n = 0; n < count; n++) {
+        nex_ansi_color(cells[n].color);
+        nex_ansi_emit(&cells[n].ch, 1);
+    }
+    ansi.x += count;
+}
+// positions the cursor and writes the frame at once
+static size_t nex_ansi_flush(int x, int y, unsigned char color) {
+    size_t rt; // rt means return value
+    nex_ansi_move(x, y);
+    nex_ansi_color(color);
+    nex_ansi_drain();
+    if (ansi.capture)
+        fflush(ansi.capture);
+    rt = ansi.drained;
+    ansi.drained = 0;
+    return rt;
+}
+// reads a key, escape sequences of unsupported keys (arrows, F1, ...) are skipped
+static int nex_ansi_getkey(int timeout_ms) {
+    int rt; // rt means return value
+    while (1) {
+        rt = ansi.pending >= 0 ? ansi.pending : nex_ansi_read(timeout_ms);
+        ansi.pending = -1;
+        if (rt == MMANSI_TIMEOUT)
+            return MMKEY_NONE;
+        if (rt == 27) {
+            int next = nex_ansi_read(MMANSI_ESCAPE_MS);
+            if (next != '[' && next != 'O') { // a plain escape key
+                ansi.pending = next;
+                return rt;
+            }
+            do // parameters end with a byte of 0x40-0x7E
+                next = nex_ansi_read(MMANSI_ESCAPE_MS);
+            while (next >= 0 && (next < 0x40 || next > 0x7E));
+            continue;
+        }
+        if (rt == 127 || rt == '\b')
+            return MMKEY_BACKSPACE;
+        if (rt == '\r')
+            return MMKEY_ENTER;
+        return rt < 0 ? 'q' : rt; // end of scripted input quits the game
+    }
+}
+// restores the terminal and closes the capture file
+static void nex_ansi_close(void) {
+    nex_ansi_restore();
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    if (ansi.capture)
+        fclose(ansi.capture);
+    ansi.capture = NULL;
+}
+
+static const struct mmterminal nex_ansi = {
+    "ansi", true, nex_ansi_open, nex_ansi_write, nex_ansi_flush, nex_ansi_getkey, nex_ansi_close
+};
+
+/*** virtual terminal ***/
+
+// the ANSI backend without a terminal: the output is only counted (and captured), there is no keyboard
+static bool nex_virtual_open(const char *capture, int *origin_x, int *origin_y) {
+    static const char text[] = "\033[?1049h\033[0m\033[2J";
+    memset(&ansi, 0, sizeof(ansi));
+    ansi.x = ansi.y = ansi.color = ansi.pending = -1;
+    ansi.virtual = true;
+    if (capture && !(ansi.capture = fopen(capture, "wb")))
+        return false;
+    nex_ansi_emit(text, sizeof(text) - 1);
+    *origin_x = *origin_y = 0;
+    return true;
+}
+// no keys without a script (see mmscript.h): waits out the timeout, then the input has ended
+static int nex_virtual_getkey(int timeout_ms) {
+    if (timeout_ms < 0)
+        return 'q';
+    usleep(timeout_ms * 1000);
+    return MMKEY_NONE;
+}
+// leaves the alternate screen and closes the capture file
+static void nex_virtual_close(void) {
+    nex_ansi_restore();
+    if (ansi.capture)
+        fclose(ansi.capture);
+    ansi.capture = NULL;
+}
+
+static const struct mmterminal nex_virtual = {
+    "virtual", true, nex_virtual_open, nex_ansi_write, nex_ansi_flush, nex_virtual_getkey, nex_virtual_close
+};
+#endif
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+const struct mmterminal *const mmterminals[] = {
+    #if defined(__usingwindows__)
+    &nex_console,
+    #elif defined(__usinglinux__)
+    &nex_curses,
+    &nex_ansi,
+    &nex_virtual,
+    #endif
+    NULL
+};
+
+
+
+// End of source file 'mmterminal.c'
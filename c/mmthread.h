@@ -0,0 +1,203 @@
+/*!mmthread.h
+ * Threads, locks, atomics and clocks for game MasterMind (Windows and Linux).
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ */
+
+#pragma once
+
+// include guard which prevents double including
+#ifndef MMTHREAD_H
+#define MMTHREAD_H
+
+#include "mastermind.h"
+
+#include <stdlib.h>
+
+#if defined(__usingwindows__)
+    #include <Windows.h>
+    typedef HANDLE MMTHREAD;
+    typedef SRWLOCK MMMUTEX;
+    typedef CONDITION_VARIABLE MMCOND;
+#elif defined(__usinglinux__)
+    #include <pthread.h>
+    #include <time.h>
+    #include <unistd.h>
+    typedef pthread_t MMTHREAD;
+    typedef pthread_mutex_t MMMUTEX;
+    typedef pthread_cond_t MMCOND;
+#endif
+
+// function run by a thread
+typedef void (*mmthread_fn)(void *arg);
+
+// start parameters of a thread (Windows and Linux use different signatures)
+struct mmthreadstart {
+    mmthread_fn fn;
+    void *arg;
+};
+
+#if defined(__usingwindows__)
+static DWORD WINAPI mmthread_trampoline(LPVOID param) {
+#else
+static void *mmthread_trampoline(void *param) {
+#endif
+    struct mmthreadstart start = *(struct mmthreadstart *)param;
+    free(param);
+    start.fn(start.arg);
+    return 0;
+}
+
+// starts fn(arg) in a new thread, returns false on failure
+static inline bool mmthread_create(MMTHREAD *thread, mmthread_fn fn, void *arg) {
+    struct mmthreadstart *start = malloc(sizeof(struct mmthreadstart));
+    if (!start)
+        return false;
+    start->fn = fn;
+    start->arg = arg;
+    #if defined(__usingwindows__)
+    *thread = CreateThread(NULL, 0, mmthread_trampoline, start, 0, NULL);
+    if (*thread)
+        return true;
+    #else
+    if (pthread_create(thread, NULL, mmthread_trampoline, start) == 0)
+        return true;
+    #endif
+    free(start);
+    return false;
+}
+// waits until a thread has finished
+static inline void mmthread_join(MMTHREAD thread) {
+    #if defined(__usingwindows__)
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+    #else
+    pthread_join(thread, NULL);
+    #endif
+}
+// gets the number of logical processors
+static inline unsigned int mmthread_cpu_count(void) {
+    #if defined(__usingwindows__)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+    #else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+    #endif
+}
+
+static inline void mmmutex_init(MMMUTEX *mutex) {
+    #if defined(__usingwindows__)
+    InitializeSRWLock(mutex);
+    #else
+    pthread_mutex_init(mutex, NULL);
+    #endif
+}
+static inline void mmmutex_destroy(MMMUTEX *mutex) {
+    #if defined(__usinglinux__)
+    pthread_mutex_destroy(mutex);
+    #endif
+}
+static inline void mmmutex_lock(MMMUTEX *mutex) {
+    #if defined(__usingwindows__)
+    AcquireSRWLockExclusive(mutex);
+    #else
+    pthread_mutex_lock(mutex);
+    #endif
+}
+static inline void mmmutex_unlock(MMMUTEX *mutex) {
+    #if defined(__usingwindows__)
+    ReleaseSRWLockExclusive(mutex);
+    #else
+    pthread_mutex_unlock(mutex);
+    #endif
+}
+
+static inline void mmcond_init(MMCOND *cond) {
+    #if defined(__usingwindows__)
+    InitializeConditionVariable(cond);
+    #else
+    pthread_cond_init(cond, NULL);
+    #endif
+}
+static inline void mmcond_destroy(MMCOND *cond) {
+    #if defined(__usinglinux__)
+    pthread_cond_destroy(cond);
+    #endif
+}
+// releases mutex, waits for a broadcast and locks mutex again
+static inline void mmcond_wait(MMCOND *cond, MMMUTEX *mutex) {
+    #if defined(__usingwindows__)
+    SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+    #else
+    pthread_cond_wait(cond, mutex);
+    #endif
+}
+static inline void mmcond_broadcast(MMCOND *cond) {
+    #if defined(__usingwindows__)
+    WakeAllConditionVariable(cond);
+    #else
+    pthread_cond_broadcast(cond);
+    #endif
+}
+
+// atomic operations on 64 bit values (sequentially consistent)
+static inline uint64_t mmatomic_load(volatile uint64_t *value) {
+    #if defined(__usingwindows__)
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)value, 0, 0);
+    #else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+    #endif
+}
+static inline void mmatomic_store(volatile uint64_t *value, uint64_t desired) {
+    #if defined(__usingwindows__)
+    InterlockedExchange64((volatile LONG64 *)value, (LONG64)desired);
+    #else
+    __atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+    #endif
+}
+// adds add to value, returns the previous value
+static inline uint64_t mmatomic_add(volatile uint64_t *value, uint64_t add) {
+    #if defined(__usingwindows__)
+    return (uint64_t)InterlockedExchangeAdd64((volatile LONG64 *)value, (LONG64)add);
+    #else
+    return __atomic_fetch_add(value, add, __ATOMIC_SEQ_CST);
+    #endif
+}
+// replaces value by desired if it equals expected, returns true on success
+static inline bool mmatomic_cas(volatile uint64_t *value, uint64_t expected, uint64_t desired) {
+    #if defined(__usingwindows__)
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)value,
+        (LONG64)desired, (LONG64)expected) == expected;
+    #else
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    #endif
+}
+
+// gets a monotonic time stamp in seconds
+static inline double mmtime_now(void) {
+    #if defined(__usingwindows__)
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double)count.QuadPart / frequency.QuadPart;
+    #else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+    #endif
+}
+
+// sleeps for the given seconds (at least a millisecond on Windows)
+static inline void mmtime_sleep(double seconds) {
+    #if defined(__usingwindows__)
+    Sleep(seconds > 0.001 ? (DWORD)(seconds * 1000) : 1);
+    #else
+    struct timespec wait = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+    nanosleep(&wait, NULL);
+    #endif
+}
+
+// end of MMTHREAD_H include guard
+#endif
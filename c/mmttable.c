@@ -0,0 +1,214 @@
+/*!mmttable.c
+ * Transposition table of the COMSOLVER for game MasterMind.
+ * (c) Feb 2018 Patrick Goldinger and Matthias Gehwolf
+ * License: MIT
+ *
+ * Games often reach the same set of candidates, and the guess selected for a
+ * set only depends on it, the preferences and the attempts left. The table
+ * maps a 64 bit key of them to the guess and its cost. It has a fixed size
+ * and no locks: an entry is three words, the first one is the key xor the
+ * other two, so an entry which is written by another thread at the same time
+ * (or was torn by two writers) just does not match. Every key has a bucket
+ * of MMTTABLE_WAYS entries, a full bucket replaces by the clock algorithm:
+ * entries which were found since the hand passed them get a second chance.
+ *
+ * File layout: struct mmttableheader, then the used entries. Tables of
+ * another MMSOLVER_REVISION are not loaded.
+ */
+
+#include "mastermind.h"
+#include "mmthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// entries per bucket
+#define MMTTABLE_WAYS 4
+// first bytes of a table file
+#define MMTTABLE_MAGIC "MMTTABLE"
+// layout of the file, increase it whenever it changes
+#define MMTTABLE_VERSION 1
+// max. number of entries, bigger tables are clamped (and then fail to allocate)
+#define MMTTABLE_MAX_ENTRIES (SIZE_MAX / 2 / sizeof(struct mmttableentry))
+
+// one entry, all zero if unused
+struct mmttableentry {
+    volatile uint64_t check, // key ^ guess ^ cost
+        guess,
+        cost;
+};
+
+// header of a table file
+struct mmttableheader {
+    char magic[8]; // MMTTABLE_MAGIC
+    uint32_t version, // MMTTABLE_VERSION
+        revision; // MMSOLVER_REVISION of the solver which selected the guesses
+    uint64_t count; // number of entries after the header
+};
+
+// state of a transposition table
+struct mmttable {
+    size_t entry_count, // power of 2, a multiple of MMTTABLE_WAYS
+        bucket_mask; // buckets - 1
+    struct mmttableentry *entries;
+    volatile uint64_t *referenced; // bit n set = entry n was found since the hand passed it
+    volatile uint64_t hand, // the clock hand starts at entry hand % MMTTABLE_WAYS of a bucket
+        lookups,
+        hits;
+};
+
+
+
+/**********************************/
+/*** NON-EXPORT FUNCTIONS (NEX) ***/
+/**********************************/
+
+// gets the first entry of the bucket of key
+static size_t nex_ttable_bucket(const struct mmttable *ttable, uint64_t key) {
+    return (size_t)((key ^ key >> 32) & ttable->bucket_mask) * MMTTABLE_WAYS;
+}
+// sets or clears the referenced bit of an entry
+static void nex_ttable_reference(struct mmttable *ttable, size_t entry, bool referenced) {
+    volatile uint64_t *word = &ttable->referenced[entry / 64];
+    uint64_t bit = 1ull << (entry % 64), old;
+    do {
+        old = mmatomic_load(word);
+        if (!(old & bit) == !referenced)
+            return;
+    } while (!mmatomic_cas(word, old, referenced ? old | bit : old & ~bit));
+}
+// reads an entry, returns its key or 0 if it is unused or torn
+static uint64_t nex_ttable_read(struct mmttableentry *entry, MMCODE *guess, uint64_t *cost) {
+    uint64_t check = mmatomic_load(&entry->check), g = mmatomic_load(&entry->guess), c = mmatomic_load(&entry->cost);
+    if (mmatomic_load(&entry->check) != check) // written meanwhile
+        return 0;
+    *guess = (MMCODE)g;
+    *cost = c;
+    return check ^ g ^ c;
+}
+
+
+
+/**************************/
+/*** EXPORT FUNCTIONS ***/
+/**************************/
+
+MASTERMIND_TTABLE *mastermind_ttable_create(size_t entries) {
+    struct mmttable *ttable = calloc(1, sizeof(struct mmttable));
+    if (!ttable)
+        return NULL;
+    for (ttable->entry_count = MMTTABLE_WAYS; ttable->entry_count < entries &&
+        ttable->entry_count <= MMTTABLE_MAX_ENTRIES / 2; ttable->entry_count *= 2);
+    ttable->bucket_mask = ttable->entry_count / MMTTABLE_WAYS - 1;
+    ttable->entries = calloc(ttable->entry_count, sizeof(struct mmttableentry));
+    ttable->referenced = calloc((ttable->entry_count + 63) / 64, sizeof(uint64_t));
+    if (!ttable->entries || !ttable->referenced) {
+        mastermind_ttable_destroy(ttable);
+        return NULL;
+    }
+    return ttable;
+}
+
+bool mastermind_ttable_load(MASTERMIND_TTABLE *ttable, const char *path) {
+    struct mmttableheader header;
+    struct mmttableentry entry;
+    FILE *file = fopen(path, "rb");
+    uint64_t n;
+    bool rt; // rt means return value
+    if (!file)
+        return false;
+    rt = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, MMTTABLE_MAGIC, 8) == 0 &&
+        header.version == MMTTABLE_VERSION && header.revision == MMSOLVER_REVISION;
+    for (n = 0; rt && n < header.count; n++) { // stored again, so the table may have another size
+        MMCODE guess;
+        uint64_t cost, key;
+        rt = fread(&entry, sizeof(entry), 1, file) == 1;
+        if (rt && (key = nex_ttable_read(&entry, &guess, &cost)))
+            mastermind_ttable_store(ttable, key, guess, cost);
+    }
+    fclose(file);
+    return rt;
+}
+
+bool mastermind_ttable_save(MASTERMIND_TTABLE *ttable, const char *path) {
+    struct mmttableheader header;
+    FILE *file = fopen(path, "wb");
+    size_t n;
+    bool rt; // rt means return value
+    if (!file)
+        return false;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MMTTABLE_MAGIC, 8);
+    header.version = MMTTABLE_VERSION;
+    header.revision = MMSOLVER_REVISION;
+    for (n = 0; n < ttable->entry_count; n++)
+        header.count += ttable->entries[n].check != 0;
+    rt = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (n = 0; rt && n < ttable->entry_count; n++) {
+        if (ttable->entries[n].check)
+            rt = fwrite(&ttable->entries[n], sizeof(struct mmttableentry), 1, file) == 1;
+    }
+    return fclose(file) == 0 && rt;
+}
+
+bool mastermind_ttable_lookup(MASTERMIND_TTABLE *ttable, uint64_t key, MMCODE *guess, uint64_t *cost) {
+    size_t first = nex_ttable_bucket(ttable, key |= 1), n; // 0 marks unused entries
+    mmatomic_add(&ttable->lookups, 1);
+    for (n = first; n < first + MMTTABLE_WAYS; n++) {
+        if (nex_ttable_read(&ttable->entries[n], guess, cost) == key) {
+            nex_ttable_reference(ttable, n, true);
+            mmatomic_add(&ttable->hits, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void mastermind_ttable_store(MASTERMIND_TTABLE *ttable, uint64_t key, MMCODE guess, uint64_t cost) {
+    size_t first = nex_ttable_bucket(ttable, key |= 1), start, n, victim = SIZE_MAX;
+    MMCODE old_guess;
+    uint64_t old_cost, old_key;
+    for (n = first; n < first + MMTTABLE_WAYS; n++) { // the key itself or an unused entry
+        old_key = nex_ttable_read(&ttable->entries[n], &old_guess, &old_cost);
+        if (old_key == key)
+            return;
+        if (!old_key && victim == SIZE_MAX)
+            victim = n;
+    }
+    if (victim == SIZE_MAX) { // clock: the first entry which was not found since the last time, clearing on the way
+        start = (size_t)(mmatomic_add(&ttable->hand, 1) % MMTTABLE_WAYS);
+        for (n = 0; n < MMTTABLE_WAYS && victim == SIZE_MAX; n++) {
+            size_t entry = first + (start + n) % MMTTABLE_WAYS;
+            if (ttable->referenced[entry / 64] >> (entry % 64) & 1)
+                nex_ttable_reference(ttable, entry, false);
+            else
+                victim = entry;
+        }
+        if (victim == SIZE_MAX) // all were found, they have no second chance anymore
+            victim = first + start;
+    }
+    // readers see a torn entry as unused until the check is written
+    mmatomic_store(&ttable->entries[victim].check, 0);
+    mmatomic_store(&ttable->entries[victim].guess, guess);
+    mmatomic_store(&ttable->entries[victim].cost, cost);
+    mmatomic_store(&ttable->entries[victim].check, key ^ guess ^ cost);
+    nex_ttable_reference(ttable, victim, false);
+}
+
+void mastermind_ttable_counts(MASTERMIND_TTABLE *ttable, uint64_t *lookups, uint64_t *hits) {
+    *lookups = mmatomic_load(&ttable->lookups);
+    *hits = mmatomic_load(&ttable->hits);
+}
+
+void mastermind_ttable_destroy(MASTERMIND_TTABLE *ttable) {
+    if (!ttable)
+        return;
+    free(ttable->entries);
+    free((void *)ttable->referenced);
+    free(ttable);
+}
+
+
+
+// End of source file 'mmttable.c'